@@ -2,12 +2,35 @@
 
 #include "glm/glm.hpp"
 
+#include "GameObjectPool.hpp"
+
 #define PAINT_BALL_COMPONENT 0
 #define PAINTABLE_COMPONENT 1
 #define RIGIDBODY_COMPONENT 2
 #define SELFMOVING_COMPONENT 3
+// The number of component types, each stored in its own pool by the ComponentRegistry.
+#define COMPONENT_TYPE_COUNT 4
+
+// The phases of the frame the components can be called in. Each type declares the phases it
+// needs with its PHASES mask: the components of the other types are never visited.
+// OnFixedUpdate, before each physics step, with the duration of the step.
+#define COMPONENT_FIXED_STEP 0
+// OnUpdate, once per frame.
+#define COMPONENT_VARIABLE_STEP 1
+// OnPostPhysics, after the transforms have been synchronized with the physics step.
+#define COMPONENT_POST_PHYSICS 2
+// OnCollision, when the gameobject collides.
+#define COMPONENT_COLLISION 3
+#define COMPONENT_PHASE_COUNT 4
+#define COMPONENT_PHASE(phase) (1u << (phase))
 
-class GameObject;
+// The data the update of a component type accesses, declared by each type with its READS and
+// WRITES masks. The registry updates in parallel the types whose accesses do not conflict; a
+// type always writes its own components.
+// The components of a type, the bullet body included for the rigidbodies.
+#define COMPONENT_ACCESS(type) (1u << (type))
+// The transforms of the gameobjects.
+#define COMPONENT_ACCESS_TRANSFORM (1u << 16)
 
 class AComponent
 {
@@ -21,25 +44,29 @@ public:
 	// Invoked when created.
 	virtual void OnCreate();
 
-	// Invoked at each frame.
+	// Invoked in the phases declared by the type. The components of a type are updated
+	// concurrently on the job system's threads: these methods must only touch their own
+	// gameobject and the data declared by their type, and must neither call OpenGL nor create
+	// or destroy gameobjects.
+	virtual void OnFixedUpdate(float deltaTime);
 	virtual void OnUpdate(float deltaTime);
+	virtual void OnPostPhysics(float deltaTime);
 
 	// Invoked every time a collision is detected.
 	virtual void OnCollision(GameObject *other, glm::vec3 hitPoint);
 
-	// Returns the gameobject that owns the component.
+	// Returns the gameobject that owns the component, or NULL if it has been destroyed.
 	GameObject* GetGameObject();
 
 	// Sets the component's parent.
 	void SetGameObject(GameObject* gameObject);
 
-	// The next component attached to the gameobject.
-	AComponent* nextComponent;
-
 protected:
 	// The unique ID of the component.
 	unsigned int id;
 
-	// The gameobject this component is attached to.
-	GameObject* gameObject = NULL;
+	// The handle of the gameobject this component is attached to, resolved through its pool on
+	// every access, so that a destroyed owner is detected instead of dereferenced.
+	GameObjectHandle owner;
+	GameObjectPool* gameObjects = NULL;
 };
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Model.hpp"
+#include "TextureStreamer.hpp"
+
+// Shares the models and the textures across the whole application: each asset is imported once
+// for a given path and set of import flags, and deleted when its last reference is released.
+class AssetRegistry
+{
+public:
+	// Returns the process-wide registry.
+	static AssetRegistry& Instance();
+
+	// Returns the model imported from the path with the given mesh flags, loading it on first
+	// request. Each call adds a reference.
+	Model* AcquireModel(const std::string& path, unsigned int meshFlags = 0);
+
+	// Acquires a model for each path, loading the missing ones in parallel (see LoadModels).
+	std::vector<Model*> AcquireModels(const std::vector<std::string>& paths, unsigned int meshFlags = 0);
+
+	// Releases a reference to the model, which is deleted when no longer referenced.
+	void ReleaseModel(Model* model);
+
+	// Returns the texture loaded from the path for the given usage (TEXTURE_USAGE_*), streaming
+	// it on first request. Each call adds a reference.
+	GLuint AcquireTexture(const std::string& path, int usage = TEXTURE_USAGE_COLOR);
+
+	// Releases a reference to the texture, which is deleted when no longer referenced.
+	void ReleaseTexture(GLuint texture);
+
+	// Prints the hits, the misses and the memory used by the resident assets.
+	void PrintReport();
+
+private:
+	AssetRegistry();
+
+	struct ModelEntry
+	{
+		Model* model;
+		int references;
+	};
+
+	struct TextureEntry
+	{
+		GLuint texture;
+		int references;
+	};
+
+	// The assets by path and flags, and the keys by asset for the releases.
+	std::unordered_map<std::string, ModelEntry> models;
+	std::unordered_map<std::string, TextureEntry> textures;
+	std::unordered_map<Model*, std::string> modelKeys;
+	std::unordered_map<GLuint, std::string> textureKeys;
+
+	// Statistics for the report.
+	unsigned long modelHits = 0, modelMisses = 0, textureHits = 0, textureMisses = 0;
+
+	// Returns the memory used by the resident levels of a texture.
+	size_t GetTextureBytes(GLuint texture);
+};
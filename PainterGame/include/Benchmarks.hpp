@@ -0,0 +1,112 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "Model.hpp"
+#include "Shader.hpp"
+#include "RenderingEngine.hpp"
+#include "PhysicsModule.h"
+
+// Returns true if the given flag has been passed on the command line.
+bool HasArgument(int argc, char* argv[], const char* flag);
+
+// Returns the value following the given flag on the command line, or nullptr if missing.
+const char* GetArgumentValue(int argc, char* argv[], const char* flag);
+
+// Measures the CPU cost of submitting the draw calls of a model, comparing the per-draw 
+// sampler name building and uniform lookup with the precomputed binding tables.
+void BenchmarkMeshDraw(const std::string& name, Model* model, const Shader& shader, int nDraws);
+
+// Measures the load time of a model imported through Assimp, then from the mesh cache, and
+// checks that both produce the same buffers. Returns whether the check passed.
+bool BenchmarkModelLoad(const std::string& path, unsigned int meshFlags);
+
+// Measures the time to import all the models through Assimp, one after the other on the calling
+// thread, then in parallel on the job system.
+void BenchmarkParallelModelLoad(const std::vector<std::string>& paths, unsigned int meshFlags);
+
+// Measures the frame time of the scene lit by the given number of point lights, randomly placed
+// in the arena with a fixed seed, culled per tile. The lights are removed afterwards.
+void BenchmarkLights(RenderingEngine* engine, glm::mat4 view, glm::mat4 projection, int nLights, 
+	int nFrames);
+
+// Adds, replaces and removes the components of random entities in a pool, checking that each
+// entity finds its last component, that a sweep calls each component once, that the freed slots
+// are reused and that every component constructed is destroyed. Returns whether the checks passed.
+bool BenchmarkComponentPool(int nEntities, int nOperations);
+
+// Creates and destroys gameobjects at random in a pool, checking that the dense array lists
+// exactly the gameobjects alive, that the handles of the destroyed ones find nothing, and that a
+// component stops finding its owner once destroyed. Returns whether the checks passed.
+bool BenchmarkGameObjectPool(int nOperations);
+
+// Gives the given number of entities a stand-in component of each type, registered for different
+// phases, one for none, then dispatches every phase through the sequential, parallel and per-entity
+// updates, and the collisions, and checks that each type is called exactly in its phases. Returns
+// whether the check passed.
+bool BenchmarkPhaseDispatch(int nEntities);
+
+// Measures the update of the components of the given number of moving objects, created for the
+// occasion: each gameobject updating its own components, then the registry sweeping each type.
+// Then measures the destruction of the objects and checks that their handles are invalidated,
+// and the cost of the phases on the same number of static objects. Returns whether the checks passed.
+bool BenchmarkComponentUpdate(RenderingEngine* engine, PhysicsModule* physicsModule, int nObjects, 
+	int nFrames);
+
+// Runs jobs that spawn and wait for nested jobs, then a parallel for over a range, checking that
+// every job runs and that every element of the range is visited once. Returns whether the checks
+// passed.
+bool BenchmarkJobSystem(int nJobs, int nNestedJobs, size_t rangeSize);
+
+// Measures the update of the components of a synthetic scene with the given number of moving
+// objects, sequentially and then on the job system, and checks that the results are identical.
+// Returns whether the check passed.
+bool BenchmarkParallelComponentUpdate(RenderingEngine* engine, PhysicsModule* physicsModule, int nObjects,
+	int nFrames);
+
+// Parses the default scene and checks it against the arena it replaced, checks that its compiled
+// records match the parsed ones and that corrupted records, truncated files and malformed lines are
+// rejected, then measures the compilation and the validation of the arena with extra objects.
+// Returns whether the checks passed.
+bool BenchmarkScene(int nExtraObjects);
+
+// Drops a sphere on a static box for up to the given number of steps, syncing the transforms as the
+// simulation does, and checks that the sphere's transform follows its body and stays clean once
+// the body sleeps, and that a rotated static box gets its rotation when its component is created.
+// Returns whether the checks passed.
+bool BenchmarkPhysicsSync(RenderingEngine* engine, PhysicsModule* physicsModule, int nSteps);
+
+// Creates the given number of gameobjects with dynamic bodies in the physics world, destroys them
+// in random order in two destruction passes of half of them, stepping the world before, between and
+// after, and compares their time with the removal of as many bodies one by one. Checks that the
+// world, the shapes and the pools are back to their state. Returns whether the check passed.
+bool BenchmarkDestruction(RenderingEngine* engine, PhysicsModule* physicsModule, int nObjects);
+
+// Edits random transforms of a random hierarchy in local and world space for the given number of
+// frames, reading them alternately before and after the hierarchy update, and checks the world
+// matrices and positions against a recomputation from the local poses. Returns whether the check
+// passed.
+bool BenchmarkTransformEdits(int nTransforms, int nFrames);
+
+// Removes and adds random nodes of a random hierarchy for the given number of rounds, and checks
+// that the compaction keeps the parents and the world matrices of the nodes alive, the children
+// of the removed nodes becoming roots; then checks the round trip of Euler angles through
+// quaternions. Returns whether the checks passed.
+bool BenchmarkTransformRemoval(int nNodes, int nRounds);
+
+// Runs frames of various durations through fixed timesteps, and checks the number of ticks at
+// several frame and tick rates, after a hitch and with frames slightly shorter than a tick, and
+// that the alphas stay in [0, 1). Returns whether the checks passed.
+bool BenchmarkFixedTimestep();
+
+// Moves a node out of a hundred in a flat hierarchy of the given number of nodes over two ticks,
+// and checks that the interpolated matrices are at the previous poses at alpha 0, at the current
+// ones at 1 and halfway at 0.5; measures the storage of the previous poses against moving all.
+// Returns whether the checks passed.
+bool BenchmarkInterpolation(int nNodes);
+
+// Measures the update of a transform hierarchy of the given number of nodes and depth, with
+// random poses from a fixed seed: all the nodes, then a small part of them moved in each frame.
+// Checks the world matrices and rotations against a straightforward per-node recomputation.
+// Returns whether the check passed.
+bool BenchmarkTransformHierarchy(int nNodes, int depth, int nFrames);
@@ -0,0 +1,249 @@
+#pragma once
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AComponent.hpp"
+
+// The components of a pool are allocated in blocks of this many.
+#define COMPONENT_POOL_BLOCK_SIZE 256
+// The least number of components a job updates: smaller pools are updated on a single thread.
+#define COMPONENT_UPDATE_CHUNK 512
+// Marks the free slots of a pool and the entities without a component of its type.
+#define COMPONENT_NO_ENTITY ((unsigned long)-1)
+#define COMPONENT_NO_SLOT 0xFFFFFFFFu
+
+// The storage of a component type, as seen by the registry.
+class AComponentPool
+{
+public:
+	virtual ~AComponentPool() {}
+
+	// Returns the component of the entity, or NULL.
+	virtual AComponent* Get(unsigned long entity) = 0;
+
+	// Destroys the component of the entity, if any, returning whether it had one.
+	virtual bool Remove(unsigned long entity) = 0;
+
+	// Returns the size of a component, the bytes a slot holds.
+	virtual size_t GetComponentSize() const = 0;
+
+	// Calls the components in the slots in [firstSlot, endSlot) for the phase.
+	virtual void Update(int phase, float deltaTime, size_t firstSlot, size_t endSlot) = 0;
+
+	// Returns the number of slots, free ones included.
+	virtual size_t GetSlotCount() const = 0;
+
+	// Returns the number of components in the pool.
+	virtual size_t GetCount() const = 0;
+};
+
+// Stores the components of type T contiguously, in blocks that never move, so that components
+// can keep pointers to each other. The slot of an entity's component is found in an array
+// indexed by the entity id; the slots freed are reused by the next components.
+template <class T>
+class ComponentPool : public AComponentPool
+{
+public:
+	ComponentPool() {}
+	ComponentPool(const ComponentPool&) = delete;
+	ComponentPool& operator=(const ComponentPool&) = delete;
+
+	~ComponentPool()
+	{
+		for (size_t slot = 0; slot < owners.size(); slot++)
+			if (owners[slot] != COMPONENT_NO_ENTITY)
+				At(slot)->~T();
+		for (size_t i = 0; i < blocks.size(); i++)
+			::operator delete(blocks[i]);
+	}
+
+	// Constructs the component of the entity from the given arguments, replacing the previous one.
+	template <class... Args>
+	T* Add(unsigned long entity, Args&&... args)
+	{
+		Remove(entity);
+		unsigned int slot;
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			slot = (unsigned int)owners.size();
+			owners.push_back(COMPONENT_NO_ENTITY);
+			if (slot % COMPONENT_POOL_BLOCK_SIZE == 0)
+				blocks.push_back(static_cast<T*>(::operator new(sizeof(T) * COMPONENT_POOL_BLOCK_SIZE)));
+		}
+		T* component = new (At(slot)) T(std::forward<Args>(args)...);
+		owners[slot] = entity;
+		if (entity >= slots.size())
+			slots.resize(entity + 1, COMPONENT_NO_SLOT);
+		slots[entity] = slot;
+		count++;
+		return component;
+	}
+
+	// Returns the component of the entity, or NULL.
+	T* Find(unsigned long entity)
+	{
+		if (entity >= slots.size() || slots[entity] == COMPONENT_NO_SLOT)
+			return NULL;
+		return At(slots[entity]);
+	}
+
+	AComponent* Get(unsigned long entity) override { return Find(entity); }
+
+	bool Remove(unsigned long entity) override
+	{
+		T* component = Find(entity);
+		if (component == NULL)
+			return false;
+		unsigned int slot = slots[entity];
+		component->~T();
+		owners[slot] = COMPONENT_NO_ENTITY;
+		slots[entity] = COMPONENT_NO_SLOT;
+		freeSlots.push_back(slot);
+		count--;
+		return true;
+	}
+
+	size_t GetComponentSize() const override { return sizeof(T); }
+
+	void Update(int phase, float deltaTime, size_t firstSlot, size_t endSlot) override
+	{
+		// The methods are called on the concrete type, so that they are resolved (and possibly
+		// inlined) at compile time instead of going through the virtual table.
+		endSlot = endSlot < owners.size() ? endSlot : owners.size();
+		for (size_t slot = firstSlot; slot < endSlot; )
+		{
+			T* components = blocks[slot / COMPONENT_POOL_BLOCK_SIZE];
+			const size_t blockEnd = (slot / COMPONENT_POOL_BLOCK_SIZE + 1) * COMPONENT_POOL_BLOCK_SIZE;
+			for (const size_t end = blockEnd < endSlot ? blockEnd : endSlot; slot < end; slot++)
+				if (owners[slot] != COMPONENT_NO_ENTITY)
+					Call(components[slot % COMPONENT_POOL_BLOCK_SIZE], phase, deltaTime);
+		}
+	}
+
+	size_t GetSlotCount() const override { return owners.size(); }
+
+	size_t GetCount() const override { return count; }
+
+private:
+	// The storage of the components.
+	std::vector<T*> blocks;
+
+	// The entity owning each slot, COMPONENT_NO_ENTITY if the slot is free.
+	std::vector<unsigned long> owners;
+
+	// The slot of each entity's component, indexed by entity id.
+	std::vector<unsigned int> slots;
+
+	// The slots freed by the removed components.
+	std::vector<unsigned int> freeSlots;
+
+	size_t count = 0;
+
+	T* At(size_t slot) { return blocks[slot / COMPONENT_POOL_BLOCK_SIZE] + slot % COMPONENT_POOL_BLOCK_SIZE; }
+
+	static void Call(T& component, int phase, float deltaTime)
+	{
+		switch (phase)
+		{
+		case COMPONENT_FIXED_STEP: component.T::OnFixedUpdate(deltaTime); break;
+		case COMPONENT_VARIABLE_STEP: component.T::OnUpdate(deltaTime); break;
+		case COMPONENT_POST_PHYSICS: component.T::OnPostPhysics(deltaTime); break;
+		}
+	}
+};
+
+// Owns the components of all the gameobjects, each type in its own pool, so that a component is
+// found in constant time and the components of a type are updated by a single sweep over
+// contiguous memory. Each component type declares its pool with a static TYPE_ID, and the phases
+// it is called in with PHASES: each phase only visits the pools of the types registered for it.
+class ComponentRegistry
+{
+public:
+	ComponentRegistry();
+	ComponentRegistry(const ComponentRegistry&) = delete;
+	ComponentRegistry& operator=(const ComponentRegistry&) = delete;
+	~ComponentRegistry();
+
+	/// <summary>
+	/// Constructs a component of type T for the entity from the given arguments, replacing the
+	/// one of the same type it already has.
+	/// </summary>
+	template <class T, class... Args>
+	T* Add(unsigned long entity, Args&&... args)
+	{
+		if (pools[T::TYPE_ID] == NULL)
+		{
+			pools[T::TYPE_ID] = new ComponentPool<T>();
+			phases[T::TYPE_ID] = T::PHASES;
+			reads[T::TYPE_ID] = T::READS;
+			writes[T::TYPE_ID] = T::WRITES | COMPONENT_ACCESS(T::TYPE_ID);
+			BuildUpdateGraph();
+		}
+		return static_cast<ComponentPool<T>*>(pools[T::TYPE_ID])->Add(entity, std::forward<Args>(args)...);
+	}
+
+	// Returns the component of type T of the entity, or NULL.
+	template <class T>
+	T* Get(unsigned long entity)
+	{
+		ComponentPool<T>* pool = static_cast<ComponentPool<T>*>(pools[T::TYPE_ID]);
+		return pool != NULL ? pool->Find(entity) : NULL;
+	}
+
+	// Returns the component of the entity with the given type ID, or NULL.
+	AComponent* Get(unsigned long entity, unsigned int typeId);
+
+	// Destroys all the components of the entity, returning the bytes freed in the pools.
+	size_t RemoveAll(unsigned long entity);
+
+	// Calls the components of the types registered for the phase, type by type, in a fixed order.
+	void Update(int phase, float deltaTime);
+
+	/// <summary>
+	/// Calls the components for the phase on the job system, with the same result as Update. The
+	/// types are updated in stages: the types of a stage do not conflict with each other and only
+	/// depend on the earlier stages, so they run concurrently, each split in chunks across the
+	/// threads.
+	/// </summary>
+	void UpdateParallel(int phase, float deltaTime);
+
+	// Returns the number of stages the types are updated in by UpdateParallel for the phase.
+	int GetStageCount(int phase) const;
+
+	// Calls the components of a single entity for the phase, in the same order as Update.
+	void UpdateEntity(unsigned long entity, int phase, float deltaTime);
+
+	// Informs the components of the entity registered for collisions of a collision.
+	void Collide(unsigned long entity, GameObject* other, glm::vec3 hitPoint);
+
+	// Returns the number of components of the given type.
+	size_t GetCount(unsigned int typeId);
+
+private:
+	// The pools by type ID, created with their first component.
+	AComponentPool* pools[COMPONENT_TYPE_COUNT];
+
+	// The phases and the accesses declared by each type whose pool exists.
+	unsigned int phases[COMPONENT_TYPE_COUNT];
+	unsigned int reads[COMPONENT_TYPE_COUNT], writes[COMPONENT_TYPE_COUNT];
+
+	// The types registered for each phase, in the update order.
+	unsigned int phaseTypes[COMPONENT_PHASE_COUNT][COMPONENT_TYPE_COUNT];
+	int phaseTypeCounts[COMPONENT_PHASE_COUNT];
+
+	// The stage each type is updated in by UpdateParallel, for each phase.
+	int stages[COMPONENT_PHASE_COUNT][COMPONENT_TYPE_COUNT];
+	int stageCounts[COMPONENT_PHASE_COUNT];
+
+	// Lists the types of each phase and assigns each of them to the first stage after all the
+	// earlier types of the phase that write what it accesses, or access what it writes.
+	void BuildUpdateGraph();
+};
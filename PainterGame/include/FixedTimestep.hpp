@@ -0,0 +1,42 @@
+#pragma once
+
+// The default simulation rate, in ticks per second (60 or 120 are the rates the game is tuned for).
+#define FIXED_TIMESTEP_DEFAULT_RATE 60
+// The most ticks run in a frame: the time beyond is dropped, so that the cost of the simulation
+// is bounded and a slow frame does not make the next ones slower.
+#define FIXED_TIMESTEP_MAX_TICKS 8
+
+// Splits the time of the frames in ticks of fixed duration, so that the simulation gives the
+// same results at any frame rate. The time left after the last tick is kept for the next frame,
+// and tells how far the frame is between the last two ticks.
+class FixedTimestep
+{
+public:
+	FixedTimestep(int rate = FIXED_TIMESTEP_DEFAULT_RATE);
+
+	// Sets the number of ticks per second.
+	void SetRate(int rate);
+	int GetRate() const;
+
+	// Returns the duration of a tick, in seconds.
+	float GetStep() const;
+
+	// Adds the time of a frame and returns the number of ticks to run.
+	int Advance(float deltaTime);
+
+	// Returns the time elapsed since the last tick as a fraction of a tick: 0 at the last tick,
+	// approaching 1 as the next one gets close.
+	float GetAlpha() const;
+
+	// Returns the number of ticks run so far.
+	unsigned long GetTickCount() const;
+
+private:
+	int rate;
+	double step;
+
+	// The time not yet simulated, slightly negative after a tick run early.
+	double accumulator = 0.0;
+
+	unsigned long tickCount = 0;
+};
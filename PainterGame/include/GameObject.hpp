@@ -5,6 +5,8 @@
 #include "Material.hpp"
 #include "btBulletDynamicsCommon.h"
 #include "AComponent.hpp"
+#include "ComponentRegistry.hpp"
+#include "GameObjectPool.hpp"
 
 class RenderingEngine;
 
@@ -27,14 +29,41 @@ public:
 	// Sets the engine that renders the gameobject.
 	void SetEngine(RenderingEngine* engine);
 
-	// Retrives the first component found with the provided ID.
-	AComponent* GetComponent(unsigned int componentId);
+	// Retrieves the engine that renders the gameobject.
+	RenderingEngine* GetEngine();
+
+	// Retrieves the unique ID of the gameobject, which indexes its components in the registry.
+	// The ID of a destroyed gameobject is reused.
+	unsigned long GetId();
+
+	// Retrieves the handle of the gameobject, which can be kept to find it while it is alive.
+	GameObjectHandle GetHandle();
+
+	// Retrieves the pool the gameobject is stored in, which resolves its handle.
+	GameObjectPool* GetPool();
 
-	// Adds a new component to the gameobject.
-	void AddComponent(AComponent* newComponent);
+	// Retrieves the component with the provided ID, or NULL.
+	AComponent* GetComponent(unsigned int componentId);
 
-	// Updates all the components.
-	void UpdateComponents(float deltaTime);
+	// Retrieves the component of type T, or NULL.
+	template <class T>
+	T* GetComponent() { return components != NULL ? components->Get<T>(goId) : NULL; }
+
+	/// <summary>
+	/// Creates a component of type T in the engine's registry, passing the gameobject and the
+	/// given arguments to its constructor, replacing the one of the same type already attached.
+	/// </summary>
+	template <class T, class... Args>
+	T* AddComponent(Args&&... args)
+	{
+		T* component = components->Add<T>(goId, this, std::forward<Args>(args)...);
+		component->OnCreate();
+		return component;
+	}
+
+	// Calls the components of this gameobject for the phase. The engine updates the components
+	// of all the gameobjects type by type instead, through the registry.
+	void UpdateComponents(int phase, float deltaTime);
 
 	// Informs all the attached components of the new collision.
 	void EnterCollision(GameObject* other, glm::vec3 hitPoint);
@@ -45,9 +74,6 @@ public:
 	// True if the gameobject will be destroyed at the next frame.
 	bool IsBeingDestroyed();
 
-	// The linked list of the attached components.
-	AComponent* firstComponent;
-
 protected:
 	// The name assigned to the gameobject.
 	std::string name;
@@ -55,6 +81,9 @@ protected:
 	// The rendering engine used to render the GameObject.
 	RenderingEngine* engine;
 
+	// The registry of the engine, which stores the attached components.
+	ComponentRegistry* components = NULL;
+
 	// True if this object has been scheduled to destruction.
 	bool bIsBeingDestroyed = false;
 
@@ -70,5 +99,10 @@ protected:
 private:
 	// The private and unique integer that identifies a gameobject univoquely.
 	unsigned long goId;
+
+	// Set by the pool the gameobject is stored in.
+	GameObjectHandle handle;
+	GameObjectPool* pool = NULL;
+	friend class GameObjectPool;
 };
 
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class GameObject;
+class Model;
+class Material;
+
+// The gameobjects are allocated in blocks of this many.
+#define GAMEOBJECT_POOL_BLOCK_SIZE 64
+
+// Refers to a gameobject without owning it: the slot the gameobject is stored in and the
+// generation of the slot, which changes every time the slot is freed, so that a handle to a
+// destroyed gameobject is recognized even after its slot has been reused.
+struct GameObjectHandle
+{
+	unsigned int index;
+	// Generations start from 1: the default handle refers to no gameobject.
+	unsigned int generation;
+
+	GameObjectHandle() : index(0), generation(0) {}
+	GameObjectHandle(unsigned int index, unsigned int generation) : index(index), generation(generation) {}
+
+	bool operator == (const GameObjectHandle& other) const
+	{
+		return index == other.index && generation == other.generation;
+	}
+	bool operator != (const GameObjectHandle& other) const { return !(*this == other); }
+};
+
+// Stores the gameobjects of the scene in blocks that never move, addressed by generational
+// handles. The gameobjects alive are also listed in a dense array, kept compact by moving the
+// last one in the place of the destroyed one, so that creation, destruction and the handle
+// lookup are O(1) and the scene is iterated without holes.
+class GameObjectPool
+{
+public:
+	GameObjectPool();
+	GameObjectPool(const GameObjectPool&) = delete;
+	GameObjectPool& operator=(const GameObjectPool&) = delete;
+	~GameObjectPool();
+
+	// Constructs a gameobject in a free slot. Its ID is the index of the slot.
+	GameObject* Create(const std::string& name, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale,
+		Model* model, Material* material);
+
+	// Returns the gameobject the handle refers to, or NULL if it has been destroyed.
+	GameObject* Get(GameObjectHandle handle) const;
+
+	// Destroys the gameobject the handle refers to, if still alive.
+	void Destroy(GameObjectHandle handle);
+
+	// Returns the gameobjects alive, in no particular order.
+	const std::vector<GameObject*>& GetObjects() const;
+
+	// Returns the number of gameobjects alive.
+	size_t GetCount() const;
+
+private:
+	// The storage of the gameobjects.
+	std::vector<GameObject*> blocks;
+
+	// The current generation of each slot.
+	std::vector<unsigned int> generations;
+
+	// The position of each slot's gameobject in the dense array, GAMEOBJECT_NO_POSITION if free.
+	std::vector<unsigned int> positions;
+
+	// The gameobjects alive.
+	std::vector<GameObject*> objects;
+
+	// The slots freed by the destroyed gameobjects.
+	std::vector<unsigned int> freeSlots;
+
+	GameObject* At(size_t slot) const;
+};
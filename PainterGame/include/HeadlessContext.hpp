@@ -0,0 +1,36 @@
+#pragma once
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+// Version of the off-screen context: the shaders are written for GLSL 4.40.
+#define HEADLESS_GL_MAJOR 4
+#define HEADLESS_GL_MINOR 4
+
+// Creates an OpenGL context without a visible window, so that the scene can be rendered 
+// in automated tests. The context has no default framebuffer: everything is rendered into 
+// the rendering engine's FBO.
+// On Linux it is an EGL surfaceless context, which needs no display server and runs on 
+// Mesa's llvmpipe on machines without a GPU (GLEW must be built with GLEW_EGL).
+// Elsewhere it is the context of a hidden GLFW window, which also runs on the CPU when 
+// Mesa's opengl32.dll is placed next to the executable.
+class HeadlessContext
+{
+public:
+	// Creates the context and makes it current. Returns false on failure.
+	bool Create();
+
+	// Destroys the context.
+	void Destroy();
+
+private:
+#ifdef __linux__
+	EGLDisplay display = EGL_NO_DISPLAY;
+	EGLContext context = EGL_NO_CONTEXT;
+#else
+	GLFWwindow* window = nullptr;
+#endif
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Maximum number of worker threads.
+#define JOB_MAX_WORKERS 8
+
+// Counts the unfinished jobs of a group: a thread can wait for all of them.
+struct JobCounter
+{
+	std::atomic<int> pending;
+
+	JobCounter() : pending(0) {}
+
+	// Returns true if all the jobs of the group have run.
+	bool IsDone() const { return pending.load() == 0; }
+};
+
+// Runs jobs on a pool of worker threads, one for each core but the main thread's. The jobs
+// must not call OpenGL: only the main thread owns the context.
+// Each worker has its own queue: it runs the last job it queued first, while idle threads
+// steal the oldest jobs of the others, so that nested jobs stay on the thread that spawned
+// them and the workers rarely contend for the same lock. The other threads share a queue.
+class JobSystem
+{
+public:
+	// Returns the process-wide job system.
+	static JobSystem& Instance();
+
+	// Queues a job on the calling thread's queue. If a counter is given, it is incremented now
+	// and decremented when the job has run.
+	void Submit(const std::function<void()>& job, JobCounter* counter = nullptr);
+
+	/// <summary>
+	/// Runs the queued jobs on the calling thread until all the jobs of the counter have run.
+	/// Jobs may wait for the jobs they submit: the waiting thread keeps executing the queues.
+	/// </summary>
+	void Wait(JobCounter& counter);
+
+	/// <summary>
+	/// Calls body(begin, end) over the range [0, count) split in chunks of at least minChunk
+	/// elements, a few per thread, and waits for all of them. The calling thread runs chunks too.
+	/// </summary>
+	void ParallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& body);
+
+	// Runs one queued job on the calling thread, returning false if no queue had any.
+	bool RunPendingJob();
+
+	// Returns the number of worker threads.
+	int GetWorkerCount() const;
+
+	// Returns how many jobs have been taken from the queue of another thread.
+	unsigned long GetStolenJobCount() const;
+
+	~JobSystem();
+
+private:
+	JobSystem();
+
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	// The jobs queued by a thread.
+	struct WorkQueue
+	{
+		std::deque<Job> jobs;
+		std::mutex mutex;
+	};
+
+	// One queue for each worker, then the one shared by the other threads.
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> workers;
+
+	// The idle workers sleep until a job is queued.
+	std::atomic<int> queuedJobs;
+	std::mutex sleepMutex;
+	std::condition_variable jobAvailable;
+	bool stopping = false;
+
+	std::atomic<unsigned long> stolenJobs;
+
+	// Takes the jobs from the queues until stopped.
+	void WorkerLoop(int index);
+
+	// Takes a job from the thread's own queue, or steals one from the others.
+	bool TakeJob(Job& job);
+
+	// Runs a job and signals its counter.
+	void Run(Job& job);
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+
+// Size in pixels of the square screen tiles the lights are binned into.
+#define LIGHT_TILE_SIZE 16
+// Maximum number of lights affecting a tile; the exceeding ones are ignored.
+#define MAX_LIGHTS_PER_TILE 255
+// Maximum number of lights in the scene.
+#define MAX_LIGHTS 1024
+
+// Binding points of the shader storage buffers.
+#define LIGHT_BUFFER_BINDING 0
+#define TILE_BUFFER_BINDING 1
+
+#define SHADER_LIGHT_CULLING 100
+
+// A point light as stored in the shader storage buffer (std430 layout).
+struct GpuPointLight
+{
+	// Position in view coordinates and radius of influence.
+	glm::vec4 positionRadius;
+	// Color premultiplied by the intensity.
+	glm::vec4 color;
+};
+
+// Keeps the point lights of the scene and bins them into screen tiles with a compute pass 
+// (Forward+), so that each fragment only iterates the lights that can reach its tile.
+class LightManager
+{
+public:
+	LightManager();
+
+	/// <summary>
+	/// Adds a point light. Lights with a positive lifetime fade out and are removed when expired.
+	/// </summary>
+	void AddLight(glm::vec3 position, glm::vec3 color, float radius, float lifetime = 0.0f);
+
+	// Removes all the lights.
+	void ClearLights();
+
+	// Ages the temporary lights, removing the expired ones.
+	void Update(float deltaTime);
+
+	// Returns the number of lights in the scene.
+	size_t GetLightCount();
+
+	// Returns the number of tiles in a row of the last culled viewport.
+	int GetTileCountX();
+
+	/// <summary>
+	/// Uploads the lights in view coordinates and bins them into the tiles of the viewport,
+	/// testing them against the depth range of each tile read from the depth prepass.
+	/// </summary>
+	void CullLights(GLuint depthTexture, const glm::mat4& view, const glm::mat4& projection, 
+		int width, int height);
+
+	// Deletes the buffers and the compute shader.
+	void Delete();
+
+private:
+	struct Light
+	{
+		glm::vec3 position;
+		glm::vec3 color;
+		float radius;
+		float lifetime;
+		float age;
+	};
+
+	std::vector<Light> lights;
+
+	// The lights in view coordinates, uploaded at each frame.
+	std::vector<GpuPointLight> gpuLights;
+
+	// The shader storage buffers of the lights and of the per-tile light lists.
+	GLuint lightBuffer, tileBuffer;
+
+	// The number of tiles the tile buffer can hold.
+	size_t tileCapacity = 0;
+
+	int tileCountX = 0;
+
+	// The compute shader that bins the lights.
+	Shader* cullingShader;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+
+// A read-only view of a whole file mapped in memory: the pages are loaded by the OS on access,
+// with no copy into the process' heap.
+class MappedFile
+{
+public:
+	MappedFile();
+
+	// Maps the file, returning false if missing or empty.
+	bool Open(const std::string& path);
+
+	// Unmaps the file: the pointers to its data become invalid.
+	void Close();
+
+	const unsigned char* GetData() const;
+	size_t GetSize() const;
+
+	~MappedFile();
+
+private:
+	const unsigned char* data;
+	size_t size;
+
+	// The OS handles of the file and of its mapping (unused on POSIX systems).
+	void* fileHandle;
+	void* mappingHandle;
+
+	// Mapped files are not copied.
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+// Writes the bytes to the file, returning false on failure. They are written to a temporary file
+// renamed over the target once complete, so that the target is either the previous file or the
+// new one, never a truncated one.
+bool WriteFileAtomically(const std::string& path, const void* data, size_t size);
@@ -18,6 +18,9 @@ class Material
 private:
 	/// <summary> Maps each uniform name to its location in the shader program. </summary>
 	std::map<char*, GLint> uniformLocations;
+
+	/// <summary> The variant of the shader the uniforms are loaded to. </summary>
+	Shader *activeShader;
 public:
 	/// <summary> Pointer to the shader program. </summary>
 	Shader *shader;
@@ -30,6 +33,12 @@ public:
 	/// <summary> Basic constructor. </summary>
 	Material(Shader *shader);
 
+	/// <summary>
+	/// Selects the variant of the shader matching the features used by the parameters,
+	/// compiling it on first use.
+	/// </summary>
+	Shader* SelectVariant(ShaderSet* shaderSet, unsigned int extraFeatures = 0);
+
 	/// <summary> 
 	/// Registers a new uniform parameter for the shader. 
 	/// </summary>
@@ -77,6 +86,11 @@ public:
 struct ShaderParamSet 
 {
 	virtual void LoadUniforms(Material*) = 0;
+
+	/// <summary>
+	/// Returns the SHADER_FEATURE_* bits of the variant these parameters need.
+	/// </summary>
+	virtual unsigned int GetFeatures() { return 0; }
 };
 
 /// <summary>
@@ -136,6 +150,8 @@ struct PaintableShaderParamSet : ShaderParamSet
 	GLint perlinNoise = -1;
 
 	void LoadUniforms(Material*);
+
+	unsigned int GetFeatures();
 };
 
 struct PaintableBlinnPhongTexturingShaderParamSet : PaintableShaderParamSet
@@ -155,5 +171,7 @@ struct PaintableBlinnPhongTexturingShaderParamSet : PaintableShaderParamSet
 
 	void LoadUniforms(Material*);
 
+	unsigned int GetFeatures();
+
 	PaintableBlinnPhongTexturingShaderParamSet Clone();
 };
\ No newline at end of file
@@ -16,6 +16,18 @@
 
 using namespace std;
 
+// Mesh creation flags.
+// Uploads the vertices in the packed format instead of the full-float one.
+#define MESH_PACK_VERTICES 0x1
+// Keeps the vertices and the indices in system memory after the upload.
+#define MESH_KEEP_CPU_DATA 0x2
+// Reorders triangles and vertices for post-transform cache and fetch locality at import time.
+#define MESH_OPTIMIZE_CACHE 0x4
+// Also sorts the triangle clusters to reduce overdraw (requires MESH_OPTIMIZE_CACHE).
+#define MESH_OPTIMIZE_OVERDRAW 0x8
+// Generates simplified levels of detail for the heavy meshes at import time.
+#define MESH_GENERATE_LODS 0x10
+
 struct Vertex
 {
 	// Position in space.
@@ -30,6 +42,20 @@ struct Vertex
 	glm::vec3 bitangent;
 };
 
+// Compact vertex layout uploaded when the mesh is packed (24 bytes instead of 56).
+// The bitangent is not stored: shaders rebuild it as cross(normal, tangent.xyz) * tangent.w.
+struct PackedVertex
+{
+	// Position in space.
+	glm::vec3 position;
+	// Normal as signed normalized 10:10:10:2.
+	GLuint normal;
+	// Tangent as signed normalized 10:10:10:2, the 2-bit w holds the bitangent's sign.
+	GLuint tangent;
+	// UV coordinates as half floats.
+	GLushort uv[2];
+};
+
 struct Texture
 {
 	// The texture's name.
@@ -40,12 +66,60 @@ struct Texture
 	aiString path;
 };
 
+// A level of detail of a mesh: a range of its index buffer drawing a simplified surface over
+// the same vertices, so that the UVs (and the paint maps) match across the levels.
+struct MeshLod
+{
+	// The first index and the amount of indices of the level.
+	GLuint firstIndex;
+	GLsizei indexCount;
+	// Estimated distance from the full surface, in model units.
+	float error;
+};
+
+// The vertex and index data of a mesh in the format of its GPU buffers, as stored by the
+// mesh cache.
+struct MeshBuffers
+{
+	// The vertices: PackedVertex if the mesh is packed, Vertex otherwise.
+	const void* vertexData;
+	size_t vertexBytes;
+	// The indices of all the levels of detail, 16 or 32-bit.
+	const void* indexData;
+	GLsizei indexCount;
+	GLenum indexType;
+	// The axis aligned bounding box of the vertices.
+	glm::vec3 boundsMin, boundsMax;
+	// The levels of detail, the full mesh first.
+	vector<MeshLod> lods;
+};
+
+// Binds one of the mesh's textures to a sampler of a shader program.
+struct TextureBinding
+{
+	// The sampler's location in the program.
+	GLint location;
+	// The texture unit the sampler reads from.
+	GLuint unit;
+	// The texture bound to the unit.
+	GLuint texture;
+};
+
+// The texture bindings of a mesh resolved for a single shader program.
+struct TextureBindingTable
+{
+	// The program the bindings have been resolved for.
+	GLuint program;
+	// One binding for each texture of the mesh.
+	vector<TextureBinding> bindings;
+};
+
 class Mesh
 {
 public:
-	// The mesh's vertices.
+	// The mesh's vertices (empty after the upload unless MESH_KEEP_CPU_DATA is set).
 	vector<Vertex> vertices;
-	// The face indices.
+	// The face indices (empty after the upload unless MESH_KEEP_CPU_DATA is set).
 	vector<GLuint> faceIndices;
 	// The textures.
 	vector<Texture> textures;
@@ -53,10 +127,76 @@ public:
 	// Array buffer objects.
 	GLuint VAO, VBO, EBO;
 
-	Mesh(vector<Vertex> vertices, vector<GLuint> faceIndices, vector<Texture> textures);
+	// The axis aligned bounding box of the vertices in model coordinates.
+	glm::vec3 boundsMin, boundsMax;
+
+	// The indices can hold several levels of detail, described by lods; without them the
+	// indices are a single level.
+	Mesh(vector<Vertex> vertices, vector<GLuint> faceIndices, vector<Texture> textures,
+		unsigned int flags = 0, vector<MeshLod> lods = vector<MeshLod>());
 
-	// Renders the mesh with the provided shader.
-	void Draw(Shader shader);
+	// Creates the mesh from data already in the GPU format, uploaded as is.
+	// MESH_KEEP_CPU_DATA is not supported: there are no vertices in the full format to keep.
+	Mesh(const MeshBuffers& buffers, vector<Texture> textures, unsigned int flags = 0);
+
+	// Renders the mesh (or one of its levels of detail) with the provided shader.
+	void Draw(const Shader& shader, int lod = 0);
+
+	// Renders the given number of instances of the mesh without binding its textures.
+	void DrawInstanced(GLsizei instanceCount, int lod = 0);
 
 	void Delete();
+
+	// Returns the amount of indices drawn at full detail.
+	GLsizei GetIndexCount() const;
+
+	// Returns the number of levels of detail, the full mesh included.
+	int GetLodCount() const;
+
+	// Returns the simplification error of a level of detail, in model units.
+	float GetLodError(int lod) const;
+
+	// Returns the type of the indices (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT).
+	GLenum GetIndexType() const;
+
+	// Returns the size in bytes of the vertex and index buffers.
+	size_t GetGpuBytes() const;
+
+	// Reads the buffers back from the GPU into the given storage.
+	MeshBuffers ReadBuffers(vector<unsigned char>& vertexStorage, vector<unsigned char>& indexStorage) const;
+
+private:
+	// The amount of indices in the EBO, all the levels of detail included.
+	GLsizei indexCount;
+
+	// The ranges of the EBO drawn by each level of detail.
+	vector<MeshLod> lods;
+
+	// The type of the indices stored in the EBO.
+	GLenum indexType;
+
+	// The size of the vertex and index buffers.
+	size_t gpuBytes;
+
+	// Size of the vertex buffer.
+	size_t vertexBytes;
+
+	// Loads the vertices in the VBO and sets the attribute pointers of the full format.
+	void UploadFullVertices();
+
+	// Loads the vertices in the VBO and sets the attribute pointers of the packed format.
+	void UploadPackedVertices();
+
+	// Sets the attribute pointers of the full and of the packed format.
+	void SetFullAttributes();
+	void SetPackedAttributes();
+
+	// Loads the indices in the EBO, using 16 bits when the vertices are few enough.
+	void UploadIndices();
+
+	// The binding tables resolved so far, one for each program the mesh has been drawn with.
+	vector<TextureBindingTable> bindingTables;
+
+	// Retrieves the binding table of the program, resolving it on first use.
+	const TextureBindingTable& GetBindingTable(GLuint program);
 };
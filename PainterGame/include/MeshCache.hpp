@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+
+// The directory the processed meshes are stored in.
+#define MESH_CACHE_DIRECTORY "meshcache"
+// Bump when the file layout or the mesh processing changes.
+#define MESH_CACHE_VERSION 2
+
+// A mesh as stored in the cache: the buffers in their GPU format, with the ranges of the levels
+// of detail, and the textures' references.
+struct CachedMesh
+{
+	MeshBuffers buffers;
+	// The type and the path of each texture, as declared by the model's materials.
+	std::vector<std::string> textureTypes, texturePaths;
+};
+
+// Returns the path of the cache file of a model imported with the given mesh flags.
+std::string GetMeshCachePath(const std::string& modelPath, unsigned int meshFlags);
+
+/// <summary>
+/// Maps the cache file and reads its meshes, returning false if missing, corrupted or stored for
+/// another source hash. The buffers point into the mapped file: they are valid until it is closed.
+/// </summary>
+bool ReadMeshCache(MappedFile& file, const std::string& cachePath, unsigned long long sourceHash,
+	std::vector<CachedMesh>& meshes);
+
+// Writes the meshes to the cache file, tagged with the hash of their source. A file that cannot be
+// written is reported, and the model is imported again on the next run.
+void WriteMeshCache(const std::string& cachePath, unsigned long long sourceHash,
+	const std::vector<CachedMesh>& meshes);
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "Mesh.hpp"
+
+// The size of the FIFO cache used to measure the average cache miss ratio.
+#define ACMR_CACHE_SIZE 16
+
+// Meshes with fewer triangles get no level of detail.
+#define LOD_MIN_TRIANGLES 256
+// Maximum number of levels, the full mesh included.
+#define LOD_MAX_LEVELS 4
+// Fraction of the triangles of the previous level each level aims for.
+#define LOD_REDUCTION 0.5f
+
+// Computes the average cache miss ratio (transformed vertices per triangle) of a triangle 
+// list rendered through a FIFO post-transform cache of the given size.
+float ComputeACMR(const std::vector<GLuint>& indices, size_t nVertices,
+	unsigned int cacheSize = ACMR_CACHE_SIZE);
+
+// Reorders the triangles for post-transform vertex cache locality (Forsyth's linear-speed 
+// algorithm, simulated on a 32 entries LRU cache).
+void OptimizeVertexCache(std::vector<GLuint>& indices, size_t nVertices);
+
+// Sorts the clusters of an already cache-optimized triangle list so that the outermost 
+// clusters are drawn first. Clusters are cut where the cache gets flushed and are merged
+// back while the ACMR does not grow more than the given threshold (e.g. 1.05).
+void OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices,
+	float threshold);
+
+// Reorders the vertices in the order they are first referenced by the indices, which are
+// remapped accordingly. Unreferenced vertices are dropped.
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+/// <summary>
+/// Simplifies a triangle list by quadric edge collapse down to the target number of indices,
+/// or as close as possible. Vertices are collapsed onto their neighbours (half-edge collapses):
+/// the result only references existing vertices, so the attributes stay exact. The vertices on
+/// the borders and on the UV seams (vertices sharing a position) are never moved. Returns the
+/// new indices and, in error, the largest distance of a collapsed vertex from its planes.
+/// </summary>
+std::vector<GLuint> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices,
+	size_t targetIndexCount, float& error);
+
+// Appends the levels of detail of a heavy mesh to its indices, each simplified from the
+// previous one and cache-optimized, and describes all the levels (the full mesh first) in lods.
+void GenerateLods(const std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+	std::vector<MeshLod>& lods);
@@ -13,36 +13,103 @@
 #include <assimp/postprocess.h>
 
 #include "Mesh.hpp"
+#include "MeshCache.hpp"
 
 class Model
 {
 public:
 	// The meshes of the model.
 	std::vector<Mesh> meshes;
-	// The textures loaded by the model.
+	// The textures referenced by the model's materials, acquired from the AssetRegistry.
 	std::vector<Texture> loadedTextures;
 	// The model's directory.
 	std::string directory;
+	// The axis aligned bounding box of all the meshes in model coordinates.
+	glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
 
-	// Constructor: sets model file path.
-	Model(const std::string& path);
+	// Constructor: sets model file path and the flags the meshes are created with.
+	// A deferred model is not loaded: Import() and Upload() load it in two steps.
+	Model(const std::string& path, unsigned int meshFlags = 0, bool deferred = false);
 
-	// Renders the model.
-	void Draw(Shader shader);
+	/// <summary>
+	/// Reads the model, from the mesh cache if it holds the processed meshes of the current file
+	/// or through Assimp otherwise, and prepares the meshes in system memory. Does not call
+	/// OpenGL: it can run on a worker thread.
+	/// </summary>
+	void Import();
+
+	// Creates the meshes' buffers and acquires their textures. Called on the thread owning the
+	// context, after Import().
+	void Upload();
+
+	// Renders the model, or one of its levels of detail.
+	void Draw(const Shader& shader, int lod = 0);
+
+	// Renders the given number of instances of the model, with no textures bound (depth-only passes).
+	void DrawInstanced(GLsizei instanceCount, int lod = 0);
+
+	// Returns the number of levels of detail of the most detailed mesh.
+	int GetLodCount() const;
+
+	// Returns the largest simplification error of the meshes at a level of detail, in model units.
+	float GetLodError(int lod) const;
+
+	// Returns the size of the vertex and index data on the GPU.
+	size_t GetGpuBytes() const;
 
 	// Destructor.
 	virtual ~Model();
 
 private:
-	// Loads the model from the given path.
-	void Load(std::string path);
+	// A mesh processed by Import() and waiting for the upload.
+	struct ImportedMesh
+	{
+		vector<Vertex> vertices;
+		vector<GLuint> faceIndices;
+		vector<MeshLod> lods;
+		// The type and the path of each texture of the mesh's material.
+		vector<string> textureTypes, texturePaths;
+	};
+
+	std::string path;
+
+	// The flags the meshes are created with (see MESH_PACK_VERTICES, MESH_KEEP_CPU_DATA).
+	unsigned int meshFlags;
+
+	// Size of the vertex and index data on the GPU, and in the full-float format with 32-bit indices.
+	size_t gpuBytes = 0, unpackedBytes = 0;
+
+	// The state passed from Import() to Upload(): the meshes imported through Assimp, or the ones
+	// read from the mapped cache file.
+	vector<ImportedMesh> importedMeshes;
+	MappedFile cacheFile;
+	vector<CachedMesh> cachedMeshes;
+	bool fromCache = false, cacheable = false;
+	unsigned long long sourceHash = 0;
+	double importMilliseconds = 0.0;
+
+	// Computes the bounds and the GPU size of the model from its meshes.
+	void UpdateBounds();
+
+	// Stores the processed meshes in the cache file.
+	void StoreCache();
+
+	// Lists the meshes of the Assimp's node hierarchy, in depth-first order.
+	void CollectAssimpMeshes(aiNode* node, const aiScene* scene, vector<aiMesh*>& meshes);
+
+	// Converts the attributes and the faces of a mesh loaded by the Assimp importer.
+	void ProcessAssimpMesh(aiMesh* mesh, const aiScene* scene, ImportedMesh& imported);
 
-	// Processes the loaded Assimp's data struct.
-	void ProcessAssimpNode(aiNode* node, const aiScene* scene);
+	// Lists the textures defined by the model's materials.
+	void CollectMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName, ImportedMesh& imported);
 
-	// Processes the mesh loaded by the Assimp importer.
-	Mesh ProcessAssimpMesh(aiMesh* mesh, const aiScene* scene);
+	// Acquires a texture of the materials from the registry.
+	Texture AcquireTexture(const std::string& path, const std::string& typeName);
+};
 
-	// Loads textures defined by the model's materials.
-	vector<Texture> LoadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName);
-};
\ No newline at end of file
+/// <summary>
+/// Loads the models in parallel: the imports and the meshes' processing run on the JobSystem's
+/// workers, while the calling thread, which owns the context, uploads each model as soon as it
+/// is imported. The models are returned in the order of the paths.
+/// </summary>
+std::vector<Model*> LoadModels(const std::vector<std::string>& paths, unsigned int meshFlags);
@@ -4,15 +4,30 @@
 #include "AComponent.hpp"
 #include "PhysicsModule.h"
 
+// The point light left by the explosion of a paint ball: intensity, radius and seconds it takes
+// to fade out.
+#define SPLASH_LIGHT_INTENSITY 2.0f
+#define SPLASH_LIGHT_RADIUS 3.0f
+#define SPLASH_LIGHT_LIFETIME 0.5f
+
 class PaintBallComponent : public AComponent
 {
 public:
+	// The pool the component is stored in.
+	static const unsigned int TYPE_ID = PAINT_BALL_COMPONENT;
+	// Follows the velocity of the body and explodes on collision.
+	static const unsigned int PHASES = COMPONENT_PHASE(COMPONENT_POST_PHYSICS) | COMPONENT_PHASE(COMPONENT_COLLISION);
+	// Reads the velocity of the paint ball's rigidbody.
+	static const unsigned int READS = COMPONENT_ACCESS(RIGIDBODY_COMPONENT);
+	static const unsigned int WRITES = 0;
+
 	PaintBallComponent(GameObject* gameObject, PhysicsModule* physicsModule);
 
 
 	void OnCreate() override;
 
-	void OnUpdate(float deltaTime) override;
+	// Stores the direction of the body after the step.
+	void OnPostPhysics(float deltaTime) override;
 
 	// Spreads paint on the other collider.
 	void OnCollision(GameObject* other, glm::vec3 hitPoint) override;
@@ -15,6 +15,14 @@
 class PaintableComponent : public AComponent
 {
 public:
+	// The pool the component is stored in.
+	static const unsigned int TYPE_ID = PAINTABLE_COMPONENT;
+	// Not called in any phase.
+	static const unsigned int PHASES = 0;
+	// The paint is applied by the paint balls, on the main thread.
+	static const unsigned int READS = 0;
+	static const unsigned int WRITES = 0;
+
 	PaintableComponent(GameObject* gameObject, Shader* paintMapShader,
 		StainSet* stainSet, unsigned int paintMapSize);
 	~PaintableComponent();
@@ -25,12 +33,13 @@ public:
 	// Creates the texture used for the object's paint map.
 	void OnCreate() override;
 
-	void OnUpdate(float deltaTime) override;
-
 	void RenderPaintMap(glm::mat4 paintSpaceMatrix, glm::vec3 paintDirection);
 
 	GLuint GetPaintMap();
 
+	// Reads the paint map back and returns the fraction of its texels covered by paint.
+	float ComputePaintCoverage();
+
 private:
 	// The shader used to compute paint stains projection.
 	Shader* depthMapShader;
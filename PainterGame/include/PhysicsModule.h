@@ -1,14 +1,39 @@
 #pragma once
+#include <algorithm>
+#include <vector>
 
 #include <glm\glm.hpp>
 
 #include <btBulletDynamicsCommon.h>
 #include "GameObject.hpp"
 
+// The dynamics world, giving access to the bodies it simulates.
+class DynamicsWorld : public btDiscreteDynamicsWorld
+{
+public:
+	DynamicsWorld(btDispatcher* dispatcher, btBroadphaseInterface* pairCache, btConstraintSolver* solver,
+		btCollisionConfiguration* collisionConfiguration) 
+		: btDiscreteDynamicsWorld(dispatcher, pairCache, solver, collisionConfiguration) {}
+
+	// Returns the bodies which are not static: the dynamic and the kinematic ones.
+	const btAlignedObjectArray<btRigidBody*>& GetNonStaticRigidBodies() const { return m_nonStaticRigidBodies; }
+
+	// Removes from the non-static bodies, in a single pass, the ones no longer in the world: the
+	// ones taken out by btCollisionWorld::removeCollisionObject, which only updates its own array.
+	void CompactNonStaticRigidBodies()
+	{
+		int kept = 0;
+		for (int i = 0; i < m_nonStaticRigidBodies.size(); i++)
+			if (m_nonStaticRigidBodies[i]->getWorldArrayIndex() >= 0)
+				m_nonStaticRigidBodies[kept++] = m_nonStaticRigidBodies[i];
+		m_nonStaticRigidBodies.resize(kept);
+	}
+};
+
 class PhysicsModule
 {
 public:
-	btDiscreteDynamicsWorld* dynamicsWorld;
+	DynamicsWorld* dynamicsWorld;
 	btAlignedObjectArray<btCollisionShape*> collisionShapes;
 	btDefaultCollisionConfiguration* collisionConfiguration;
 	btCollisionDispatcher* dispatcher;
@@ -16,6 +41,12 @@ public:
 	btSequentialImpulseConstraintSolver* solver;
 	btCollisionWorld* collisionWorld;
 
+	// The gameobjects the bodies belong to, found through the handles stored in the bodies.
+	GameObjectPool* gameObjects = NULL;
+
+	// The bodies of the destroyed gameobjects, removed together by RemoveQueuedBodies.
+	btAlignedObjectArray<btRigidBody*> queuedRemovals;
+
 	double sceneSize = 100;
 	unsigned int maxColliders = 500;
 
@@ -41,7 +72,7 @@ public:
 		this->solver = new btSequentialImpulseConstraintSolver;
 
 		//  DynamicsWorld is the main class of physics simulation.
-		this->dynamicsWorld = new btDiscreteDynamicsWorld(dispatcher, overlappingPairCache, solver, collisionConfiguration);
+		this->dynamicsWorld = new DynamicsWorld(dispatcher, overlappingPairCache, solver, collisionConfiguration);
 
 		// Sets gravity.
 		this->dynamicsWorld->setGravity(btVector3(0, -9.82f, 0));
@@ -129,6 +160,72 @@ public:
 		this->collisionWorld->removeCollisionObject(toRemove);
 	}
 
+	// Queues the body for removal: it is deleted, with its motion state and its shape, by the next
+	// RemoveQueuedBodies.
+	void QueueRemoval(btRigidBody* body)
+	{
+		queuedRemovals.push_back(body);
+	}
+
+	/// <summary>
+	/// Removes the queued bodies from the worlds and deletes them, returning the bytes released.
+	/// Each body leaves the broadphase and the array of collision objects in constant time, then the
+	/// arrays of non-static bodies and of shapes are compacted once for the whole batch, instead of
+	/// being searched for each body.
+	/// </summary>
+	size_t RemoveQueuedBodies()
+	{
+		const int nBodies = queuedRemovals.size();
+		if (nBodies == 0)
+			return 0;
+
+		std::vector<btCollisionShape*> shapes(nBodies);
+		for (int i = 0; i < nBodies; i++)
+		{
+			btRigidBody* body = queuedRemovals[i];
+			shapes[i] = body->getCollisionShape();
+			// Some bodies are created without ever being added to the world. The bodies are only
+			// ever added to the dynamics world, whose broadphase the collision world shares.
+			if (body->getWorldArrayIndex() >= 0)
+				dynamicsWorld->btCollisionWorld::removeCollisionObject(body);
+		}
+		dynamicsWorld->CompactNonStaticRigidBodies();
+
+		std::sort(shapes.begin(), shapes.end());
+		int kept = 0;
+		for (int i = 0; i < collisionShapes.size(); i++)
+			if (!std::binary_search(shapes.begin(), shapes.end(), collisionShapes[i]))
+				collisionShapes[kept++] = collisionShapes[i];
+		collisionShapes.resize(kept);
+
+		size_t bytes = 0;
+		for (int i = 0; i < nBodies; i++)
+		{
+			btRigidBody* body = queuedRemovals[i];
+			bytes += sizeof(btRigidBody) + GetShapeSize(body->getCollisionShape());
+			if (body->getMotionState() != NULL)
+				bytes += sizeof(btDefaultMotionState);
+			delete body->getMotionState();
+			delete body->getCollisionShape();
+			delete body;
+		}
+		queuedRemovals.clear();
+		return bytes;
+	}
+
+	// Returns the size of the shapes created by createRigidBody.
+	static size_t GetShapeSize(const btCollisionShape* shape)
+	{
+		switch (shape->getShapeType())
+		{
+		case BOX_SHAPE_PROXYTYPE: return sizeof(btBoxShape);
+		case SPHERE_SHAPE_PROXYTYPE: return sizeof(btSphereShape);
+		case STATIC_PLANE_PROXYTYPE: return sizeof(btStaticPlaneShape);
+		case CYLINDER_SHAPE_PROXYTYPE: return sizeof(btCylinderShape);
+		default: return sizeof(btCollisionShape);
+		}
+	}
+
 	void Clear()
 	{
 		//remove the rigidbodies from the dynamics world and delete them
@@ -185,8 +282,8 @@ public:
 			{
 				//std::cout << "Collision between shapes " << obA->getCollisionShape()
 				//	<< " and " << obB->getCollisionShape() << std::endl;
-				GameObject* goA = static_cast<GameObject*>(obA->getCollisionShape()->getUserPointer());
-				GameObject* goB = static_cast<GameObject*>(obB->getCollisionShape()->getUserPointer());
+				GameObject* goA = GetGameObject(obA);
+				GameObject* goB = GetGameObject(obB);
 				if (goA != NULL && goB != NULL)
 				{
 					btManifoldPoint& pt = contactManifold->getContactPoint(j);
@@ -202,6 +299,49 @@ public:
 		}
 	}
 
+	// Copies the pose of the bodies moved by the last step into the transforms of their gameobjects.
+	// Only the bodies awake are visited: the static and the sleeping ones have not moved.
+	void SyncTransforms()
+	{
+		const btAlignedObjectArray<btRigidBody*>& bodies = dynamicsWorld->GetNonStaticRigidBodies();
+		for (int i = 0; i < bodies.size(); i++)
+		{
+			btRigidBody* body = bodies[i];
+			if (!body->isActive())
+				continue;
+			GameObject* go = GetGameObject(body);
+			if (go != NULL)
+				CopyPose(body, go->GetTransform());
+		}
+	}
+
+	// Copies the pose of the body, interpolated by the motion state, into the transform.
+	static void CopyPose(btRigidBody* body, Transform* transform)
+	{
+		btTransform pose;
+		body->getMotionState()->getWorldTransform(pose);
+		const btVector3& origin = pose.getOrigin();
+		const btQuaternion rotation = pose.getRotation();
+		transform->SetAbsolutePosition(glm::vec3(origin.getX(), origin.getY(), origin.getZ()));
+		transform->SetAbsoluteRotation(glm::fquat(rotation.getW(), rotation.getX(), rotation.getY(), rotation.getZ()));
+	}
+
+	// Stores the handle of the gameobject in the body's user indices.
+	static void SetGameObject(btCollisionObject* body, GameObjectHandle handle)
+	{
+		body->setUserIndex((int)handle.index);
+		body->setUserIndex2((int)handle.generation);
+	}
+
+	// Retrieves the gameobject of the body, or NULL if it has none or it has been destroyed.
+	GameObject* GetGameObject(const btCollisionObject* body)
+	{
+		if (gameObjects == NULL || body->getUserIndex() < 0)
+			return NULL;
+		return gameObjects->Get(GameObjectHandle((unsigned int)body->getUserIndex(), 
+			(unsigned int)body->getUserIndex2()));
+	}
+
 	// Retrieves a vector of gameobjects colliding with the given collider.
 	std::vector<GameObject*> GetGameObjectsCollidingWith(GameObject* collider)
 	{
@@ -214,10 +354,8 @@ public:
 			const btCollisionObject* obA = contactManifold->getBody0();
 			const btCollisionObject* obB = contactManifold->getBody1();
 
-			GameObject* goA = static_cast<GameObject*>(obA->getCollisionShape()->getUserPointer());
-			GameObject* goB = static_cast<GameObject*>(obB->getCollisionShape()->getUserPointer());
-			if (goA != NULL && goB != NULL)
-				std::cout << "Collision between " << goA->GetName() << " and " << goB->GetName() << std::endl;
+			GameObject* goA = GetGameObject(obA);
+			GameObject* goB = GetGameObject(obB);
 			if (goA == collider && goB != NULL && std::find(collisions.begin(), collisions.end(), goB) == collisions.end())
 				collisions.push_back(goB);
 			if (goB == collider && goA != NULL && std::find(collisions.begin(), collisions.end(), goA) == collisions.end())
@@ -68,6 +68,9 @@ public:
 	// Processes camera movement command.
 	void ProcessMouseMovement(GLfloat xOffset, GLfloat yOffset, GLboolean constrainPitch = false);
 
+	// Places the camera, as done by scripted sequences.
+	void SetPose(vec3 position, GLfloat yaw, GLfloat pitch);
+
 	vec3 GetPosition();
 
 	// Shoots a paintball from the current position.
@@ -0,0 +1,140 @@
+#pragma once
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Frames a GPU query waits before being read, so that reading never stalls the pipeline.
+#define PROFILER_QUERY_RING_SIZE 4
+// Frames the rolling averages are computed on.
+#define PROFILER_HISTORY_SIZE 120
+// Maximum number of events recorded for the trace.
+#define PROFILER_MAX_TRACE_EVENTS 200000
+
+// Measures where the frame time goes: CPU scopes with a high resolution clock, GPU passes
+// with GL_TIME_ELAPSED queries. Each timer is exposed as the rolling average of its total 
+// per frame, and every measure can be exported as a Chrome trace (chrome://tracing).
+// GPU timers cannot be nested: a GPU scope opened inside another one is ignored.
+class Profiler
+{
+public:
+	// Returns the process-wide profiler.
+	static Profiler& Instance();
+
+	// If false all the timers are ignored.
+	bool enabled = false;
+
+	// If true the measures are recorded for the trace export.
+	bool recordTrace = false;
+
+	// Starts a frame, reading the GPU timers of the frame issued PROFILER_QUERY_RING_SIZE frames ago.
+	void BeginFrame();
+
+	// Ends the frame, adding the CPU totals to the rolling averages.
+	void EndFrame();
+
+	// Opens and closes a CPU timer.
+	void BeginCpu(const char* name);
+	void EndCpu();
+
+	// Opens and closes a GPU timer. Returns false if the timer could not be opened.
+	bool BeginGpu(const char* name);
+	void EndGpu();
+
+	// Returns the GPU time of the last frame whose queries have been read, in milliseconds.
+	double GetLastGpuFrameTime();
+
+	// Returns the rolling average of the time spent in the timer per frame, in milliseconds.
+	double GetAverage(const std::string& name);
+
+	// Prints the rolling averages of all the timers.
+	void PrintAverages();
+
+	// Writes the recorded measures as a Chrome trace JSON file.
+	bool ExportChromeTrace(const std::string& path);
+
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	Profiler();
+
+	// Rolling statistics of a timer.
+	struct TimerStats
+	{
+		bool gpu = false;
+		// The total of the current frame.
+		double frameTotal = 0.0;
+		double history[PROFILER_HISTORY_SIZE];
+		int historyCount = 0;
+		int historyNext = 0;
+	};
+
+	// A scope measured by a GPU query, read when its ring slot is reused.
+	struct GpuScope
+	{
+		const char* name;
+		GLuint query;
+		// When the scope has been issued by the CPU, used to place it in the trace.
+		double cpuStart;
+	};
+
+	// A measure of the trace.
+	struct TraceEvent
+	{
+		const char* name;
+		bool gpu;
+		double start, duration;
+	};
+
+	// The CPU timers currently open.
+	struct OpenScope
+	{
+		const char* name;
+		double start;
+	};
+
+	Clock::time_point origin;
+	unsigned long long frameIndex = 0;
+
+	std::map<std::string, TimerStats> timers;
+	std::vector<OpenScope> openScopes;
+
+	// The GPU scopes issued by the last frames, one slot per frame.
+	std::vector<GpuScope> queryRing[PROFILER_QUERY_RING_SIZE];
+	std::vector<GLuint> freeQueries;
+	bool gpuScopeOpen = false;
+	double lastGpuFrameTime = 0.0;
+
+	std::vector<TraceEvent> traceEvents;
+
+	// Milliseconds elapsed since the profiler has been created.
+	double Now();
+
+	// Adds a frame total to the rolling history of a timer.
+	void PushHistory(TimerStats& stats, double total);
+
+	// Reads the GPU scopes of a ring slot and adds them to the timers.
+	void ResolveQueries(std::vector<GpuScope>& scopes);
+
+	void Record(const char* name, bool gpu, double start, double duration);
+};
+
+// Measures the CPU time spent until the end of the enclosing scope.
+class ScopedCpuTimer
+{
+public:
+	ScopedCpuTimer(const char* name);
+	~ScopedCpuTimer();
+};
+
+// Measures the GPU time spent by the commands issued until the end of the enclosing scope.
+class ScopedGpuTimer
+{
+public:
+	ScopedGpuTimer(const char* name);
+	~ScopedGpuTimer();
+private:
+	bool started;
+};
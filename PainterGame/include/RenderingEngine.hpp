@@ -1,5 +1,5 @@
 #pragma once
-#include <list>
+#include <vector>
 
 #include <glm\glm.hpp>
 #include <glm\gtc\matrix_inverse.hpp>
@@ -11,18 +11,47 @@
 #include "Transform.hpp"
 #include "GameObject.hpp"
 #include "PlayerController.hpp"
+#include "LightManager.hpp"
+#include "ShadowSystem.hpp"
 
 #define CUBE_OBJ_PATH "Models/Cube.obj"
 #define CYLINDER_OBJ_PATH "Models/Cylinder.obj"
 #define SPHERE_OBJ_PATH "Models/Sphere.obj"
 #define BUNNY_OBJ_PATH "Models/bunny_lp.obj"
 
+// Default resolution the scene is rendered at.
+#define SCR_WIDTH 1920
+#define SCR_HEIGHT 1080
+
+// The lowest fraction of the resolution the scene is rendered at with dynamic resolution.
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.5f
+// How much the scale decreases per frame when over budget, and increases when well under it.
+#define DYNAMIC_RESOLUTION_STEP_DOWN 0.02f
+#define DYNAMIC_RESOLUTION_STEP_UP 0.01f
+
+// The simplification error allowed on screen when picking the level of detail of a model,
+// in pixels.
+#define LOD_MAX_PIXEL_ERROR 1.0f
+
 /// <summary>
 /// Rotates a 4x4 matrix with a vector3 of Euler angles.
 /// </summary>
 glm::mat4 rotateEuler(glm::mat4, glm::vec3);
 
 class PlayerController;
+class PhysicsModule;
+
+// What a destruction pass released.
+struct DestructionStats
+{
+	size_t objects = 0;
+	size_t bodies = 0;
+	// The bytes returned to the pools, kept for reuse: the gameobjects, their components and
+	// their transform nodes.
+	size_t pooledBytes = 0;
+	// The bytes freed: the transforms and the bodies with their shapes and motion states.
+	size_t freedBytes = 0;
+};
 
 class RenderingEngine
 {
@@ -30,27 +59,81 @@ private:
 	/// <summary>The player used to retrieve the view matrix.</summary>
 	PlayerController* player;
 
-	///<summary> Contains the game objects that must be rendered.</summary>
-	std::list<GameObject*> renderableObjects;
-
-	/// <summary> Contains the paintable game objects.</summary>
-	std::list<GameObject*> paintableObjects;
-
 	// The objects that needs to be destroyed.
-	vector<GameObject*> objectsToDestroy;
+	vector<GameObjectHandle> objectsToDestroy;
 
-	// Keeps count of all the gameObjects added to the engine.
-	unsigned long gameObjectCounter = 0;
+	// The results of the last destruction pass, their sum since the start and the most bytes
+	// freed by a single pass.
+	DestructionStats lastDestruction, totalDestruction;
+	size_t peakFreedBytes = 0;
 	
 	// The FBO used to render the scene without UI.
 	GLuint hdrFBO;
 
+	// The depth buffer of the FBO, sampled by the light culling pass.
+	GLuint depthTexture;
+
+	// The resolution of the FBO, which matches the framebuffer the scene is presented on.
+	int width, height;
+
+	// The fraction of the FBO resolution the scene is rendered at.
+	float renderScale = 1.0f;
+
+	// The GPU frame time smoothed over the last frames, in milliseconds.
+	double gpuFrameTime = 0.0;
+
+	// Allocates the storage of the FBO attachments at the current resolution.
+	void AllocateRenderTargets();
+
+	// Adapts the render scale to the GPU frame time, if dynamic resolution is enabled.
+	void UpdateRenderScale();
+
+	// How far the frame is between the last two simulation ticks.
+	float interpolationAlpha = 1.0f;
+
+	// The model matrix of each object in the current frame, in list order, interpolated between
+	// the last two ticks: all the passes draw the objects at the same pose.
+	std::vector<glm::mat4> modelMatrices;
+
+	// Computes the model matrices of the frame.
+	void InterpolateModelMatrices();
+
+	// The level of detail of each renderable object in the current frame, in list order: the
+	// depth prepass and the scene pass must draw the same triangles.
+	std::vector<int> objectLods;
+
+	// Picks the coarsest level of detail of each object whose error, projected on the screen,
+	// stays within lodPixelError.
+	void SelectLods(const glm::mat4& viewMat, const glm::mat4& projection, int sceneHeight);
+
+	// Renders the depth of the scene only, before the light culling pass.
+	void RenderDepthPrepass(glm::mat4 viewMat, glm::mat4 projection);
+
 public:
-	RenderingEngine(PlayerController* pc);
+	RenderingEngine(PlayerController* pc, int width = SCR_WIDTH, int height = SCR_HEIGHT);
 
 	// The shader that renders the UI layer.
 	Shader* uiShader;
 
+	// The set the materials pick their shader variants from.
+	ShaderSet* shaders;
+
+	// The point lights of the scene, culled per screen tile before the scene pass.
+	LightManager* lights;
+
+	// The shadows of the main light, none until a light is set.
+	ShadowSystem* shadows;
+
+	// The physics the bodies of the destroyed gameobjects are removed from.
+	PhysicsModule* physics = NULL;
+
+	// The components of all the gameobjects, stored and updated type by type.
+	ComponentRegistry components;
+
+	// The gameobjects of the scene, all rendered. Declared after the components, which are
+	// released by the gameobjects' destructors.
+	GameObjectPool gameObjects;
+
 	// The texture the scene is rendered on.
 	GLuint renderedTexture;
 
@@ -59,6 +142,34 @@ public:
 
 	bool hdrFboSnapshot = false;
 
+	// If false the scene is only rendered into the FBO, as in headless mode where there is
+	// no default framebuffer to compose the UI on.
+	bool presentToScreen = true;
+
+	// Returns all the game objects in the scene.
+	const std::vector<GameObject*>& GetGameObjects();
+
+	// Returns the gameobject the handle refers to, or NULL if it has been destroyed.
+	GameObject* GetGameObject(GameObjectHandle handle);
+
+	// If true the scene is rendered at a lower resolution, down to DYNAMIC_RESOLUTION_MIN_SCALE,
+	// when the GPU frame time measured by the profiler exceeds the target.
+	bool dynamicResolution = false;
+
+	// The GPU frame time dynamic resolution aims at, in milliseconds.
+	double targetFrameTime = 1000.0 / 60.0;
+
+	// The error allowed on screen by the levels of detail, in pixels: 0 draws the full meshes.
+	float lodPixelError = LOD_MAX_PIXEL_ERROR;
+
+	/// <summary>
+	/// Recreates the render targets for a new framebuffer size.
+	/// </summary>
+	void Resize(int width, int height);
+
+	// Returns the fraction of the resolution the scene is currently rendered at.
+	float GetRenderScale();
+
 	/// <summary>
 	/// Renders all the objects in the scene.
 	/// </summary>
@@ -78,16 +189,35 @@ public:
 	// Marks an existing gameobject as ready to be destroyed.
 	void MarkGameObjectForDestruction(GameObject* go);
 
-	// Destryes the objects marked as destroyable.
+	/// <summary>
+	/// Destroys the objects marked as destroyable, at the end of the frame: their slots and their
+	/// components' return to the pools, then their bodies leave the physics worlds in one batch.
+	/// </summary>
 	void DestroyGameObjects();
 
+	// Returns what the last destruction pass released.
+	const DestructionStats& GetLastDestruction();
+
+	// Prints the gameobjects destroyed and the memory returned to the pools and freed since the start.
+	void PrintDestructionReport();
+
 	/// <summary>
-	/// Calls the OnUpdate method on all the gameobjects.
+	/// Calls the components registered for the phase, in parallel on the job system.
 	/// </summary>
-	void UpdateComponents(float deltaTime);
+	void UpdateComponents(int phase, float deltaTime);
+
+	// Recomputes the world matrices of the transforms changed during the frame, in a single pass.
+	void UpdateTransforms();
+
+	// Stores the current poses of the transforms as the ones of the previous simulation tick.
+	void StorePreviousTransforms();
+
+	// Sets how far the frame is between the previous simulation tick (0) and the current one (1):
+	// the objects are rendered at the interpolated poses.
+	void SetInterpolation(float alpha);
 
 	/// <summary>
-	/// Sets the gameobject's rendering list.
+	/// Enables or disables the paint on the gameobject's material.
 	/// </summary>
 	void SetPaintable(GameObject* go, bool paintable);
 };
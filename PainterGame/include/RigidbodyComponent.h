@@ -8,15 +8,19 @@
 class RigidbodyComponent : public AComponent
 {
 public:
+	// The pool the component is stored in.
+	static const unsigned int TYPE_ID = RIGIDBODY_COMPONENT;
+	// The transform follows the body through PhysicsModule::SyncTransforms, not the component.
+	static const unsigned int PHASES = 0;
+	static const unsigned int READS = 0;
+	static const unsigned int WRITES = 0;
+
 	RigidbodyComponent(GameObject* go, PhysicsModule* physicsWorld, btRigidBody* rb);
 	~RigidbodyComponent();
 
-	// Sets the Transform's field.
+	// Sets the Transform's field and copies the initial pose of the body into it.
 	void OnCreate() override;
 
-	// Updates the Transform's data with the state of the physics simulation.
-	void OnUpdate(float deltaTime) override;
-
 	// Returns the linear velocity of the rigidbody.
 	glm::vec3 GetLinearVelocity();
 
@@ -32,8 +36,5 @@ public:
 protected:
 	// The physics world this component belongs to.
 	PhysicsModule* physicsWorld;
-
-	// The Transform object associated to the gameobject.
-	Transform* goTransform;
 };
 
@@ -0,0 +1,144 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Material.hpp"
+
+// The scene loaded when none is given on the command line.
+#define SCENE_DEFAULT_PATH "Scenes/Arena.scene"
+// Appended to the path of a scene to name its compiled file.
+#define SCENE_BINARY_EXTENSION ".bin"
+// Bump when the layout of the compiled files changes.
+#define SCENE_BINARY_VERSION 1
+
+// The collision shapes of the bodies, as numbered by PhysicsModule::createRigidBody.
+#define SCENE_BODY_NONE -1
+#define SCENE_BODY_BOX 0
+#define SCENE_BODY_SPHERE 1
+#define SCENE_BODY_PLANE 2
+#define SCENE_BODY_CYLINDER 3
+
+class GameObject;
+class PhysicsModule;
+class RenderingEngine;
+class StainSet;
+
+// The records of a compiled scene. They only hold 4-byte fields, so that the arrays are read in
+// place from the mapped file; the names and the paths are offsets in the string table, the
+// models, the textures and the materials indices in their arrays.
+struct SceneAssetRecord
+{
+	GLuint path;
+	// The TEXTURE_USAGE_* of a texture.
+	GLint usage;
+};
+
+struct SceneMaterialRecord
+{
+	// The indices of the textures, -1 for none.
+	GLint diffuseTexture, normalMap;
+	glm::vec3 diffuseColor, ambientColor, specularColor;
+	GLfloat Kd, Ka, Ks, shininess;
+	glm::vec2 repeat;
+	glm::vec3 lightPosition;
+};
+
+struct SceneObjectRecord
+{
+	GLuint name, model, material;
+	glm::vec3 position, rotation, scale;
+	// A SCENE_BODY_* shape, its pose in world space and its size as passed to createRigidBody.
+	GLint bodyShape;
+	glm::vec3 bodyPosition, bodyRotation, bodySize;
+	GLfloat mass, friction, restitution;
+	// The resolution of the paint map, 0 if the object cannot be painted.
+	GLint paintMapSize;
+	// The motion of a SelfMovingComponent, if the speed is not 0.
+	glm::vec3 moveDisplacement;
+	GLfloat moveSpeed;
+};
+
+// A scene description: the models, the textures and the materials it uses, and its gameobjects
+// with their transforms, rigid bodies, paint maps and motions. The text format has one command
+// per line; the declarations open an entity, which the following properties apply to:
+//   light <x> <y> <z>
+//   model <name> <path>
+//   texture <name> <path> [color|normal|data]
+//   material <name>
+//     diffuse_texture|normal_map <texture>
+//     diffuse_color|ambient_color|specular_color <r> <g> <b>
+//     kd|ka|ks|shininess <value>
+//     repeat <u> <v>
+//     light_position <x> <y> <z>
+//   object <name> <model> <material>
+//     position|rotation|scale <x> <y> <z>
+//     body box|sphere|plane|cylinder
+//     body_offset|body_rotation|body_size <x> <y> <z>
+//     mass|friction|restitution <value>
+//     paintable <resolution>
+//     moves <x> <y> <z> <speed>
+// Lines starting with # are comments. The rotations are Euler angles in radians; the body is
+// placed at the object's position plus the offset, and sized by default as the object's scale.
+// The materials are Blinn-Phong, lit by the light declared before them unless they set their own.
+class SceneDescription
+{
+public:
+	glm::vec3 lightPosition;
+	// The names and the paths, each followed by a null character.
+	std::string strings;
+	std::vector<SceneAssetRecord> models, textures;
+	std::vector<SceneMaterialRecord> materials;
+	std::vector<SceneObjectRecord> objects;
+
+	// Parses the text format, returning false and printing the line of the first error.
+	bool Parse(const std::string& text);
+
+	// Serializes the description in the compiled format, tagged with the hash of its source.
+	void Compile(unsigned long long sourceHash, std::vector<unsigned char>& blob) const;
+};
+
+// The gameobjects of a scene, with the materials it created for them. Each object has its own
+// material, as the paintable ones store their paint map in it.
+// The materials are released with the scene, which must outlive its gameobjects.
+class Scene
+{
+public:
+	Scene();
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
+	~Scene();
+
+	/// <summary>
+	/// Loads the scene from the compiled file next to the text one, compiling it first if missing
+	/// or older than the text: the compiled file is mapped and its objects created in a single pass,
+	/// after importing their models in parallel. Without the text, the compiled file is loaded as is.
+	/// Returns false if neither can be read. A scene is loaded once.
+	/// </summary>
+	bool Load(const std::string& path, RenderingEngine* engine, PhysicsModule* physics, ShaderSet* shaders,
+		StainSet* stainSet, GLint perlinNoise, unsigned int meshFlags);
+
+	// Returns the position of the light the materials are lit by.
+	glm::vec3 GetLightPosition() const;
+
+	// Returns the gameobjects created by the scene, in declaration order.
+	const std::vector<GameObject*>& GetObjects() const;
+
+	// Returns the gameobject with the given name, or NULL.
+	GameObject* Find(const std::string& name) const;
+
+	// Checks that the arrays of a compiled scene lie within its size, and that its records only
+	// refer to valid entries and hold valid shapes, masses and paint map sizes up to the given one.
+	static bool Validate(const unsigned char* data, size_t size, GLint maxTextureSize);
+
+private:
+	glm::vec3 lightPosition;
+	std::vector<GameObject*> objects;
+	std::vector<Material> materials;
+	std::vector<PaintableBlinnPhongTexturingShaderParamSet> materialParams;
+
+	// Creates the objects of a compiled scene, returning false if it does not validate.
+	bool Instantiate(const unsigned char* data, size_t size, RenderingEngine* engine, PhysicsModule* physics,
+		ShaderSet* shaders, StainSet* stainSet, GLint perlinNoise, unsigned int meshFlags);
+};
@@ -5,17 +5,23 @@
 class SelfMovingComponent : public AComponent
 {
 public:
+	// The pool the component is stored in.
+	static const unsigned int TYPE_ID = SELFMOVING_COMPONENT;
+	// Drives its body before the physics step.
+	static const unsigned int PHASES = COMPONENT_PHASE(COMPONENT_FIXED_STEP);
+	// Moves both the rigidbody and the transform.
+	static const unsigned int READS = 0;
+	static const unsigned int WRITES = COMPONENT_ACCESS(RIGIDBODY_COMPONENT) | COMPONENT_ACCESS_TRANSFORM;
+
 	SelfMovingComponent(GameObject* gameObject, glm::vec3 displacement, float speed);
 	~SelfMovingComponent();
 
-	void OnUpdate(float deltaTime) override;
+	void OnFixedUpdate(float deltaTime) override;
 
 private:
 
 	glm::vec3 beginPosition, endPosition, currentDestination;
 
 	float speed, t;
-
-	RigidbodyComponent* rb;
 };
 
@@ -10,19 +10,22 @@ public:
 	// The shader program.
 	GLuint program;
 
-	// The unique id of the shader.
+	// The unique id of the shader, shared by all its variants.
 	int id;
 
+	// The source paths and the defines the program has been compiled with.
+	std::string vertexPath, fragmentPath, computePath, defines;
+
 	// Constructor based on vertex shader and fragment shader paths.
-	Shader(const GLchar* vertexPath, const GLchar* fragmentPath, int id);
+	// The defines are a space-separated list of macros selecting a variant of the sources.
+	Shader(const GLchar* vertexPath, const GLchar* fragmentPath, int id, const std::string& defines = "");
+
+	// Constructor of a compute shader.
+	Shader(const GLchar* computePath, int id, const std::string& defines = "");
 
 	// Activates the shader in the current rendering process.
-	void Use();
+	void Use() const;
 
 	// Deletes the shader at the application quit.
 	void Delete();
-
-private:
-	// Checks GLSL syntax errors.
-	void CheckCompileErrors(GLuint shader, std::string type);
 };
\ No newline at end of file
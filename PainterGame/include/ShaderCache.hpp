@@ -0,0 +1,98 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gl\glew.h>
+
+// The directory the linked program binaries are stored in.
+#define SHADER_CACHE_DIRECTORY "shadercache"
+
+// How a program requested to the cache has been obtained.
+enum ProgramOrigin
+{
+	// Compiled and linked from the GLSL sources.
+	PROGRAM_COMPILED,
+	// Loaded from a binary stored by a previous run.
+	PROGRAM_BINARY,
+	// Already created in this run for the same pair of sources.
+	PROGRAM_SHARED
+};
+
+// Creates the shader programs, sharing identical (vertex, fragment) pairs and storing the 
+// linked binaries on disk so that the next launches skip compilation.
+class ShaderCache
+{
+public:
+	// Returns the process-wide cache.
+	static ShaderCache& Instance();
+
+	// Returns the program linked from the given sources, creating it on first request.
+	// The defines are a space-separated list of macros, declared in all the sources;
+	// NAME=VALUE defines a macro with a value.
+	GLuint GetProgram(const std::string& vertexPath, const std::string& fragmentPath,
+		const std::string& defines = "");
+
+	// Returns the compute program built from the given source, creating it on first request.
+	GLuint GetComputeProgram(const std::string& computePath, const std::string& defines = "");
+
+	// Releases a reference to the program, which is deleted when no longer referenced.
+	void ReleaseProgram(GLuint program);
+
+	// Prints how long each program took to be created and where it came from.
+	void PrintReport();
+
+private:
+	ShaderCache();
+
+	// A stage of a program and the path of its source.
+	struct ShaderStage
+	{
+		GLenum type;
+		std::string path;
+	};
+
+	struct ProgramEntry
+	{
+		GLuint program;
+		int references;
+		std::string name;
+		// Time spent to create the program.
+		double milliseconds;
+		ProgramOrigin origin;
+	};
+
+	// Maps each pair of source paths to its program.
+	std::map<std::string, ProgramEntry> programs;
+
+	// One line for each request, in request order, for the startup report.
+	std::vector<ProgramEntry> requests;
+
+	// Identifies the driver: binaries produced by another driver are not reused.
+	std::string driverString;
+
+	// True if the driver supports at least one program binary format.
+	bool binariesSupported;
+
+	// Reads a source file, inserting the directives after the #version one.
+	std::string ReadSource(const std::string& path, const std::string& directives);
+
+	// Returns the program made of the given stages, creating it on first request.
+	GLuint GetProgram(const std::vector<ShaderStage>& stages, const std::string& defines);
+
+	// Compiles and links the program from the sources of its stages.
+	GLuint CompileProgram(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources);
+
+	// Loads the binary stored for the key; returns 0 if missing or rejected by the driver.
+	GLuint LoadBinary(const std::string& key);
+
+	// Stores the binary of a linked program under the key.
+	void StoreBinary(const std::string& key, GLuint program);
+
+	// Checks GLSL syntax errors.
+	void CheckCompileErrors(GLuint shader, std::string type);
+};
+
+// Hashes a buffer with 64-bit FNV-1a, chaining from a previous hash.
+unsigned long long HashFNV1a(const void* data, size_t size, 
+	unsigned long long hash = 14695981039346656037ULL);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <vector>
 
 #include "Shader.hpp"
@@ -11,11 +12,40 @@
 #define SHADER_BLINN_PHONG 4
 #define SHADER_LAMBERT 5
 #define SHADER_UI 6
+#define SHADER_DEPTH 7
+
+// Feature bits selecting the compile-time variants of a shader.
+// Samples the diffuse texture instead of using the diffuse color (USE_TEXTURE).
+#define SHADER_FEATURE_TEXTURE 0x1
+// Samples the normal map instead of using the vertex normal (USE_NORMAL_MAP).
+#define SHADER_FEATURE_NORMAL_MAP 0x2
+// Blends the paint map over the surface (PAINTABLE).
+#define SHADER_FEATURE_PAINTABLE 0x4
+// Adds the point lights binned into the fragment's screen tile (TILED_LIGHTS).
+#define SHADER_FEATURE_TILED_LIGHTS 0x8
+// Shadows of a point light, from the six views around it (POINT_SHADOWS).
+#define SHADER_FEATURE_POINT_SHADOWS 0x10
+// Shadows of a directional light, from cascades selected by distance (CASCADED_SHADOWS).
+#define SHADER_FEATURE_CASCADED_SHADOWS 0x20
 
 class ShaderSet
 {
 public:
+	// The shaders compiled without features.
 	std::vector<Shader> availableShaders;
 
 	ShaderSet();
+
+	// Returns the variant of the shader compiled with the given features, compiling it on first use.
+	Shader* GetVariant(int shaderId, unsigned int features);
+
+	// Deletes all the shaders and their variants.
+	void Delete();
+
+private:
+	// The features supported by the sources of each shader; the others are ignored.
+	std::vector<unsigned int> supportedFeatures;
+
+	// The variants compiled so far, keyed by shader id and features.
+	std::map<std::pair<int, unsigned int>, Shader*> variants;
 };
\ No newline at end of file
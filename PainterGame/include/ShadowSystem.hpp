@@ -0,0 +1,142 @@
+#pragma once
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "GameObject.hpp"
+#include "Shader.hpp"
+
+// Resolution of each shadow map layer.
+#define SHADOW_MAP_SIZE 1024
+// Number of cascades the view frustum is split into for a directional light.
+#define SHADOW_CASCADE_COUNT 3
+// Distance from the camera covered by the cascades.
+#define SHADOW_DISTANCE 30.0f
+// Blend between the logarithmic (1) and the uniform (0) split scheme.
+#define SHADOW_SPLIT_LAMBDA 0.75f
+// The cascades move by multiples of this many texels, so that their static content stays valid
+// while the camera moves within a cell.
+#define SHADOW_CACHE_SNAP_TEXELS 64
+// Depth range of the cascades around their center, large enough to include the casters
+// outside the view frustum.
+#define SHADOW_DEPTH_RANGE 50.0f
+// Near and far planes of the six views of a point light.
+#define SHADOW_POINT_NEAR 0.1f
+#define SHADOW_POINT_FAR 40.0f
+// Texture unit the shadow map is bound to (units 10 and 11 are used by the paint).
+#define SHADOW_MAP_UNIT 12
+// Binding point of the shader storage buffer with the model matrices of the casters.
+#define SHADOW_INSTANCE_BINDING 2
+
+#define SHADER_SHADOW_DEPTH 101
+
+// The light casting the shadows.
+#define SHADOW_LIGHT_NONE 0
+#define SHADOW_LIGHT_POINT 1
+#define SHADOW_LIGHT_DIRECTIONAL 2
+
+// Renders the shadow maps of the main light: six views for a point light, or cascades fitted to
+// the view frustum for a directional light, stored as the layers of a depth texture array.
+// The static casters of each view are rendered into a cached layer, again only when the view or
+// its static casters change; at each frame only
+// the views containing moving objects are refreshed, by copying the cached layer and rendering
+// the moving casters over it.
+class ShadowSystem
+{
+public:
+	ShadowSystem();
+
+	// Casts the shadows of a point light, rendered in all the directions.
+	void SetPointLight(glm::vec3 position);
+
+	// Casts the shadows of a directional light with cascaded shadow maps.
+	void SetDirectionalLight(glm::vec3 direction);
+
+	// Returns the type of the light casting the shadows (SHADOW_LIGHT_*).
+	int GetLightType();
+
+	// Returns the shader feature that samples the shadow maps of the current light, or 0.
+	unsigned int GetShaderFeature();
+
+	/// <summary>
+	/// Updates the shadow maps: renders the static casters of the views that moved, and
+	/// refreshes the views that contain (or contained in the last frame) moving casters.
+	/// The objects are drawn with the model matrices at the same positions in the list.
+	/// </summary>
+	void Render(const std::vector<GameObject*>& objects, const std::vector<glm::mat4>& modelMatrices,
+		const glm::mat4& view, const glm::mat4& projection);
+
+	// Binds the shadow maps and loads the light's uniforms in the given program.
+	void LoadUniforms(GLuint program);
+
+	// Prints how many views have been rendered since the creation.
+	void PrintReport();
+
+	// Deletes the textures, the buffers and the depth shader.
+	void Delete();
+
+private:
+	// A view of the light rendered in a layer of the shadow maps.
+	struct ShadowView
+	{
+		// Transforms world coordinates to the light's clip coordinates.
+		glm::mat4 viewProjection;
+		// True if the cached layer holds the static casters for the current matrix.
+		bool staticValid;
+		// Identifies the static casters rendered in the cached layer and their poses, so that
+		// the layer is rendered again when one is added, removed or moved.
+		unsigned long long staticSignature;
+		// True if moving casters have been rendered in the layer in the last frame.
+		bool hadMovingCasters;
+		// The batches drawn in the view, as indices in the list of draws.
+		std::vector<size_t> staticDraws, movingDraws;
+	};
+
+	// A batch of instances of the same model.
+	struct ShadowDraw
+	{
+		Model* model;
+		GLint offset;
+		GLsizei count;
+	};
+
+	int lightType = SHADOW_LIGHT_NONE;
+	glm::vec3 lightPosition, lightDirection;
+
+	std::vector<ShadowView> views;
+
+	// The far distance of each cascade from the camera.
+	float cascadeSplits[SHADOW_CASCADE_COUNT];
+
+	// The depth arrays: the static casters only, and the complete maps sampled by the scene.
+	GLuint staticMaps, shadowMaps;
+	GLuint shadowFBO;
+
+	// The model matrices of the casters, uploaded once per frame for all the views.
+	GLuint instanceBuffer;
+	size_t instanceCapacity = 0;
+	std::vector<glm::mat4> instances;
+	std::vector<ShadowDraw> draws;
+
+	// Renders the instanced casters.
+	Shader* depthShader;
+
+	// Statistics for the report.
+	unsigned long frames = 0, staticRenders = 0, movingRenders = 0;
+
+	// Allocates the layers for the given number of views.
+	void AllocateViews(size_t nViews);
+
+	// Computes the cascades from the camera, invalidating the cached layers of the moved ones.
+	void UpdateCascades(const glm::mat4& view, const glm::mat4& projection);
+
+	// Sorts the casters visible in each view into batches of static and moving instances,
+	// invalidating the cached layers whose static casters changed.
+	void BuildDraws(const std::vector<GameObject*>& objects, const std::vector<glm::mat4>& modelMatrices);
+
+	// Renders the given batches in a layer.
+	void RenderDraws(GLuint texture, int layer, const glm::mat4& viewProjection,
+		const std::vector<size_t>& drawIndices);
+};
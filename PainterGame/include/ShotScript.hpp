@@ -0,0 +1,50 @@
+#pragma once
+#include <set>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// A pose the scripted camera passes through.
+struct CameraKey
+{
+	int frame;
+	glm::vec3 position;
+	float yaw, pitch;
+};
+
+// A scripted sequence of camera movements and shots, used to render the arena 
+// reproducibly in headless mode. The text format has one command per line:
+//   frames <count>
+//   camera <frame> <x> <y> <z> <yaw> <pitch>
+//   shoot <frame>
+// Lines starting with # are comments. The camera is interpolated between keys.
+class ShotScript
+{
+public:
+	// The number of frames to render.
+	int frameCount = 0;
+
+	// Loads the script from a file. Returns false if the file cannot be read.
+	bool Load(const std::string& path);
+
+	// Creates the default script: a full turn around the center of the arena, 
+	// shooting at regular intervals.
+	void CreateDefault(int frameCount);
+
+	// Computes the camera pose at the given frame.
+	void GetCameraPose(int frame, glm::vec3& position, float& yaw, float& pitch) const;
+
+	// Returns true if a shot is fired at the given frame.
+	bool IsShotFrame(int frame) const;
+
+	// Returns the number of shots fired by the script.
+	size_t GetShotCount() const;
+
+private:
+	// The camera keys, sorted by frame.
+	std::vector<CameraKey> cameraKeys;
+
+	// The frames shots are fired at.
+	std::set<int> shotFrames;
+};
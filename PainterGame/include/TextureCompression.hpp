@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+
+#include <GL/glew.h>
+
+// Bytes of a compressed 4x4 block.
+#define BC1_BLOCK_BYTES 8
+#define BC3_BLOCK_BYTES 16
+#define BC5_BLOCK_BYTES 16
+
+// Compresses an RGBA8 image to BC1 (opaque color, 4 bits per pixel).
+std::vector<unsigned char> CompressBC1(const unsigned char* rgba, int width, int height);
+
+// Compresses an RGBA8 image to BC3 (color with alpha, 8 bits per pixel).
+std::vector<unsigned char> CompressBC3(const unsigned char* rgba, int width, int height);
+
+// Compresses the red and green channels of an RGBA8 image to BC5 (8 bits per pixel), as
+// used by the normal maps whose third component is rebuilt by the shaders.
+std::vector<unsigned char> CompressBC5(const unsigned char* rgba, int width, int height);
+
+// Halves an RGBA8 image with a box filter. Normal maps are renormalized after the filtering.
+std::vector<unsigned char> DownsampleRGBA(const unsigned char* rgba, int width, int height, 
+	bool normalMap);
+
+// Returns the size in bytes of an image of the given format (compressed or GL_RGBA8).
+size_t GetImageSize(GLenum format, int width, int height);
@@ -0,0 +1,142 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Directory of the transcoded textures, relative to the working directory.
+#define TEXTURE_CACHE_DIRECTORY "texturecache"
+// Bump when the cache file layout or the encoders change.
+#define TEXTURE_CACHE_VERSION 1
+// Mips up to this size are uploaded as soon as a texture is decoded, so that it can be sampled.
+#define STREAMING_INITIAL_SIZE 64
+// Mip levels uploaded per frame once the smallest ones are resident.
+#define STREAMING_LEVELS_PER_FRAME 2
+// Pixel buffer objects the uploads rotate through.
+#define STREAMING_PBO_COUNT 4
+
+// How the texture is sampled, which selects its GPU format.
+// Color: BC1, or BC3 if the image has an alpha channel.
+#define TEXTURE_USAGE_COLOR 0
+// Tangent space normal map: BC5, the shaders rebuild the third component.
+#define TEXTURE_USAGE_NORMAL_MAP 1
+// Data read by the shaders, such as noise or the color keyed UI: uncompressed RGBA8.
+#define TEXTURE_USAGE_DATA 2
+
+// A mip level of a texture in its GPU format.
+struct TextureLevel
+{
+	int width, height;
+	std::vector<unsigned char> data;
+};
+
+// Loads the textures asynchronously. Worker threads decode the images, build their mips and
+// transcode them to compressed formats, storing the result in a cache file; the main thread
+// then uploads them through pixel buffer objects, the smallest mips first, a few per frame.
+// The texture names are returned immediately and sampled as a flat placeholder until the
+// first mips are resident.
+class TextureStreamer
+{
+public:
+	// The instance shared by the whole application.
+	static TextureStreamer& Instance();
+
+	/// <summary>
+	/// Starts loading a texture, returning its name. The textures are shared through the
+	/// AssetRegistry, which requests each path once.
+	/// </summary>
+	GLuint Request(const std::string& path, int usage = TEXTURE_USAGE_COLOR);
+
+	// Deletes a texture; one still loading is deleted once its data is received.
+	void Delete(GLuint texture);
+
+	/// <summary>
+	/// Receives the decoded textures and uploads the next mips. Called once per frame on the
+	/// thread owning the context.
+	/// </summary>
+	void Update(int maxLevels = STREAMING_LEVELS_PER_FRAME);
+
+	// Blocks until all the requested textures are fully resident.
+	void Finish();
+
+	// Returns true if no texture is being loaded or uploaded.
+	bool IsIdle();
+
+	// Prints the memory used by the textures and the loading time.
+	void PrintReport();
+
+	// Stops the workers and deletes the pixel buffers.
+	void Shutdown();
+
+	~TextureStreamer();
+
+private:
+	TextureStreamer();
+
+	// A texture being loaded.
+	struct StreamedTexture
+	{
+		GLuint id;
+		std::string path;
+		int usage;
+		// The GPU format (a compressed format or GL_RGBA8) and the mip chain, largest first.
+		GLenum format;
+		std::vector<TextureLevel> levels;
+		// The smallest level not yet uploaded: levels above it are resident.
+		int nextLevel;
+		bool fromCache;
+		// True if deleted while loading.
+		bool released;
+	};
+
+	// The textures not fully resident yet, by name.
+	std::map<GLuint, StreamedTexture*> inFlight;
+
+	// The textures waiting for a worker, and the ones decoded and waiting for the upload.
+	std::deque<StreamedTexture*> jobs, decoded;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::vector<std::thread> workers;
+	bool stopping = false;
+
+	// The textures whose mips are being uploaded.
+	std::vector<StreamedTexture*> uploading;
+
+	// Textures requested and not fully resident yet.
+	int pending = 0;
+
+	GLuint pbos[STREAMING_PBO_COUNT];
+	int nextPbo = 0;
+
+	// True if the driver supports the S3TC formats; otherwise colors are stored uncompressed.
+	bool s3tcSupported;
+
+	// Statistics for the report.
+	std::chrono::high_resolution_clock::time_point firstRequest;
+	int loadedTextures = 0, cacheHits = 0;
+	size_t residentBytes = 0, uncompressedBytes = 0;
+
+	// Takes the jobs from the queue until stopped.
+	void WorkerLoop();
+
+	// Fills the mip chain of the texture, from the cache or by transcoding the image.
+	void Load(StreamedTexture* texture);
+
+	// Reads the mip chain from the cache file, returning false if missing or outdated.
+	bool LoadCache(const std::string& key, StreamedTexture* texture);
+
+	// Writes the mip chain to the cache file.
+	void StoreCache(const std::string& key, const StreamedTexture* texture);
+
+	// Forgets a texture received or fully uploaded, deleting it if released.
+	void Complete(StreamedTexture* texture);
+
+	// Uploads a level of the texture through the next pixel buffer.
+	void UploadLevel(StreamedTexture* texture, int level);
+};
@@ -7,23 +7,27 @@
 
 #include "btBulletDynamicsCommon.h"
 
+// The position, rotation and scale of an object relative to its parent, stored as a node of the
+// scene's TransformHierarchy: the world matrices of all the transforms changed during a frame
+// are recomputed together by TransformHierarchy::Update. The rotations are composed as
+// quaternions; the Euler angles taken and returned by the methods are in degrees.
 class Transform
 {
 private:
-	glm::vec3 position;
-	glm::vec3 rotation;
-	glm::vec3 scale;
-
-	std::vector<Transform> children;
-	Transform *parent = nullptr;
+	// The node of the transform in the hierarchy.
+	unsigned int node;
 
 	glm::mat4 rotateEuler(glm::mat4 mat, glm::vec3 eulerAngles);
 
 	// The attached RB, if any.
 	btRigidBody* rb = NULL;
+
 public:
 	Transform();
 	Transform(const glm::vec3, const glm::vec3, const glm::vec3, Transform*);
+	Transform(const Transform&) = delete;
+	Transform& operator=(const Transform&) = delete;
+	~Transform();
 
 	glm::vec3 GetAbsolutePosition();
 	glm::vec3 GetLocalPosition();
@@ -34,15 +38,26 @@ public:
 	glm::fquat GetAbsoluteRotationQuaternion();
 	glm::vec3 GetLocalRotation();
 	void SetLocalRotation(const glm::vec3 newRotation);
+	void SetLocalRotation(const glm::fquat newRotation);
 	void SetAbsoluteRotation(const glm::vec3 newRotation);
+	void SetAbsoluteRotation(const glm::fquat newRotation);
 
+	// The absolute scale is the product of the scales up the hierarchy.
 	glm::vec3 GetAbsoluteScale();
 	glm::vec3 GetLocalScale();
 	void SetLocalScale(const glm::vec3 newScale);
 
+	// Returns the world matrix.
 	glm::mat4 GetTransformMatrix();
 
+	// Returns the world matrix between the pose stored by the last tick (alpha 0) and the current one.
+	glm::mat4 GetInterpolatedMatrix(float alpha);
+
+	// Attaches the RB. The transform becomes a root, as the body is simulated in world space.
 	void SetRigidbody(btRigidBody* rb);
+
+	// True if the transform or one of its parents changed since the last hierarchy update.
+	bool IsDirty() const;
 };
 
 glm::fquat euler2quat(glm::vec3 euler);
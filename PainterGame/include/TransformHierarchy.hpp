@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Marks the roots, and the IDs of the removed nodes.
+#define TRANSFORM_NO_NODE 0xFFFFFFFFu
+
+// Stores the local poses and the world matrices of a forest of transforms in parallel arrays,
+// sorted so that every node comes after its parent: the world matrices are computed by a single
+// sweep over the arrays, in which the parent of a node has always been computed already.
+// The nodes are addressed by IDs which stay valid while they are alive, mapped to their index
+// in the arrays; the removed nodes are compacted away by the next Update.
+// The local and world values of different nodes can be set and read from several threads, as
+// long as no node is added or removed meanwhile and no thread moves a node another one reads.
+class TransformHierarchy
+{
+public:
+	TransformHierarchy();
+	TransformHierarchy(const TransformHierarchy&) = delete;
+	TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+	// Returns the hierarchy of the scene's transforms.
+	static TransformHierarchy& Instance();
+
+	// Adds a node after all the others, so after its parent, and returns its ID.
+	unsigned int Add(unsigned int parent, glm::vec3 position, glm::fquat rotation, glm::vec3 scale);
+
+	// Removes the node. Its children become roots, keeping their local poses.
+	void Remove(unsigned int node);
+
+	// Makes the node a root, keeping its local pose.
+	void Detach(unsigned int node);
+
+	// Returns the parent of the node, or TRANSFORM_NO_NODE.
+	unsigned int GetParent(unsigned int node) const;
+
+	// The pose of the node relative to its parent.
+	glm::vec3 GetLocalPosition(unsigned int node) const;
+	glm::fquat GetLocalRotation(unsigned int node) const;
+	glm::vec3 GetLocalScale(unsigned int node) const;
+	void SetLocalPosition(unsigned int node, glm::vec3 position);
+	void SetLocalRotation(unsigned int node, glm::fquat rotation);
+	void SetLocalScale(unsigned int node, glm::vec3 scale);
+
+	// The pose of the node in world space: the values computed by the last Update, or, for the
+	// nodes changed since, computed from the chain of ancestors. The world scale is the product
+	// of the local scales, exact only when the rotated ancestors are scaled uniformly.
+	glm::mat4 GetWorldMatrix(unsigned int node) const;
+	glm::vec3 GetWorldPosition(unsigned int node) const;
+	glm::fquat GetWorldRotation(unsigned int node) const;
+	glm::vec3 GetWorldScale(unsigned int node) const;
+
+	// Moves or rotates the node to the given world position or rotation.
+	void SetWorldPosition(unsigned int node, glm::vec3 position);
+	void SetWorldRotation(unsigned int node, glm::fquat rotation);
+
+	// True if the node or one of its ancestors changed since the last Update.
+	bool IsDirty(unsigned int node) const;
+
+	/// <summary>
+	/// Recomputes the world values of the nodes changed since the last Update and of their
+	/// descendants, in a single sweep parents first, after compacting away the removed nodes.
+	/// </summary>
+	void Update();
+
+	// Stores the world poses computed by the last Update as the previous poses of the nodes,
+	// visiting only the nodes recomputed since the last call.
+	void StorePreviousPoses();
+
+	/// <summary>
+	/// Returns the world matrix of the node between its previous pose (alpha 0) and its current
+	/// one (alpha 1): the position is interpolated linearly, the rotation spherically. The nodes
+	/// without a previous pose are at their current one.
+	/// </summary>
+	glm::mat4 GetInterpolatedMatrix(unsigned int node, float alpha) const;
+
+	// Returns the number of nodes alive.
+	size_t GetCount() const;
+
+	// Returns the number of nodes recomputed by the last Update.
+	size_t GetUpdatedCount() const;
+
+	// Returns the bytes a node takes in the arrays. The arrays keep their capacity when nodes are
+	// removed: the bytes are reused by the next nodes, not freed.
+	static size_t GetNodeSize();
+
+private:
+	// The parallel arrays, sorted parents first. The parents are indices in the arrays. The arrays
+	// with an entry per node are counted by GetNodeSize.
+	std::vector<unsigned int> parents;
+	std::vector<glm::vec3> localPositions;
+	std::vector<glm::fquat> localRotations;
+	std::vector<glm::vec3> localScales;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<glm::fquat> worldRotations;
+	std::vector<glm::vec3> worldScales;
+	// The world poses stored by StorePreviousPoses.
+	std::vector<glm::vec3> previousPositions;
+	std::vector<glm::fquat> previousRotations;
+	std::vector<unsigned char> flags;
+	// The ID of the node at each index, TRANSFORM_NO_NODE if removed.
+	std::vector<unsigned int> ids;
+
+	// The index of each ID's node, and the IDs free for reuse.
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> freeIds;
+
+	// Whether each node has been recomputed by the current Update, reused from pass to pass.
+	std::vector<unsigned char> updated;
+
+	// The IDs of the nodes recomputed since the previous poses were stored.
+	std::vector<unsigned int> movedNodes;
+
+	size_t removedCount = 0;
+	size_t updatedCount = 0;
+	// The number of nodes flagged as changed: Update skips the sweep when there are none.
+	size_t dirtyCount = 0;
+
+	// Returns the index of the parent of the node at the index, TRANSFORM_NO_NODE for the roots
+	// and the children of a removed node.
+	unsigned int ParentOf(unsigned int index) const;
+
+	// True if the node at the index or one of its ancestors changed since the last Update.
+	bool IsStale(unsigned int index) const;
+
+	// Return the world values of the node at the index, computed from its chain of ancestors
+	// if stale.
+	glm::mat4 WorldMatrixAt(unsigned int index) const;
+	glm::fquat WorldRotationAt(unsigned int index) const;
+	glm::vec3 WorldScaleAt(unsigned int index) const;
+
+	// Flags the node at the index as changed.
+	void MarkDirty(unsigned int index);
+
+	// Removes the removed nodes from the arrays, keeping the others in order.
+	void Compact();
+};
@@ -0,0 +1,6 @@
+#version 440 core
+
+// Depth prepass: the depth is written by the fixed pipeline.
+void main()
+{
+}
@@ -0,0 +1,18 @@
+#version 440 core
+
+// Depth prepass: only the position is needed.
+layout (location = 0) in vec3 position;
+
+uniform mat4 modelMatrix;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+// The lit pass tests its depth for equality against the prepass: both compute the position 
+// with the same operations.
+invariant gl_Position;
+
+void main()
+{
+    vec4 mvPosition = viewMatrix * modelMatrix * vec4(position, 1.0);
+    gl_Position = projectionMatrix * mvPosition;
+}
@@ -28,6 +28,9 @@ out vec3 lightDir;
 out vec3 vNormal;
 out vec2 interp_UV;
 
+// Must match the depth prepass.
+invariant gl_Position;
+
 void main()
 {
 	interp_UV = UV;
@@ -37,17 +37,17 @@ void main()
 
 	// Computes the texture color.
 	vec2 repeated_UV = mod(interp_UV * repeat, 1.0);
-	vec4 colorTex = texture2D(tex, repeated_UV);
+	vec4 colorTex = texture(tex, repeated_UV);
 
 	// Computes final color.
 	vec3 color = vec3(Kd * lambertian * colorTex);
     
-	//float paintAlpha = 1.0 - texture2D(paintMap, interp_UV).r;
+	//float paintAlpha = 1.0 - texture(paintMap, interp_UV).r;
 	float paintAlpha = 0.0;
 	float texelSize = 1.0 / textureSize(paintMap, 0).x;
 	for (int x = -1; x < 2; x++)
 		for (int y = -1; y < 2; y++)
-			paintAlpha += 1.0 - texture2D(paintMap, vec2(interp_UV.x + texelSize * x, interp_UV.y + texelSize * y)).r;
+			paintAlpha += 1.0 - texture(paintMap, vec2(interp_UV.x + texelSize * x, interp_UV.y + texelSize * y)).r;
 	paintAlpha /= 9.0;
 
 	colorFrag = vec4(color, 1.0) * (1.0 - paintAlpha) + vec4(paintColor * Kd * lambertian, 1.0) * paintAlpha;
@@ -38,7 +38,7 @@ void main()
     uint addedColor = uint(max_ubyte * gl_FragDepth);
 
     // Computes incidence angle between paint ball direction and face normal.
-    float paintLevel = 1.0 - texture2D(stainTex, projCoords.xy).r;
+    float paintLevel = 1.0 - texture(stainTex, projCoords.xy).r;
     float incidence = dot(paintDir, vNormal);
 
     // If dot product < 0 then the face got hit by the paint.
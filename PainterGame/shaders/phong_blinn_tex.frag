@@ -1,5 +1,12 @@
 #version 440 core
 
+// Variants are selected by the material at compile time:
+// USE_TEXTURE samples the diffuse texture instead of using the diffuse color,
+// USE_NORMAL_MAP samples the normal map instead of using the vertex normal,
+// PAINTABLE blends the paint map over the surface,
+// TILED_LIGHTS adds the point lights binned into the fragment's screen tile,
+// POINT_SHADOWS and CASCADED_SHADOWS shadow the main light.
+
 // Output color of the shader.
 out vec4 colorFrag;
 
@@ -16,16 +23,24 @@ in vec2 interp_UV;
 // Amount of repetitions of the texture.
 uniform vec2 repeat;
 
+#ifdef USE_TEXTURE
 // The texture to use.
 uniform sampler2D tex;
+#else
+// The color used instead of the texture.
+uniform vec3 diffuseColor;
+#endif
+
+#ifdef USE_NORMAL_MAP
 uniform sampler2D normalMap;
-uniform float usesNormalMap = 0.0;
+// Tangent frame in view coordinates.
+in vec3 vTangent;
+in vec3 vBitangent;
+#endif
 
 // Ambient and specular components.
-uniform vec3 diffuseColor;
 uniform vec3 ambientColor; 
 uniform vec3 specularColor;
-uniform float usesTexture = 0.0;
 
 // Weights of components.
 uniform float Kd;
@@ -40,28 +55,104 @@ uniform float quadratic;
 // Shininess coefficient.
 uniform float shininess;
 
+#ifdef PAINTABLE
 // Paint parameters
 // The paintmap of the model.
 uniform usampler2D paintMap;
 // The color of the paint.
 uniform vec3 paintColor;
-// 1 if the model is paintable, 0 otherwise.
-uniform float isPaintable = 0.0;
 // The texture that contains the noise.
 uniform sampler2D perlinNoise;
 // Tha maximum unsigned byte (used for normalization).
 const uint max_ubyte = 255;
+#endif
+
+#ifdef TILED_LIGHTS
+struct PointLight
+{
+    // Position in view coordinates and radius of influence.
+    vec4 positionRadius;
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer LightBuffer
+{
+    PointLight lights[];
+};
+
+// For each tile: the number of lights, followed by their indices.
+layout (std430, binding = 1) readonly buffer TileBuffer
+{
+    uint tileData[];
+};
+
+// The number of tiles in a row of the viewport.
+uniform int tileCountX;
+#endif
+
+#if defined(POINT_SHADOWS) || defined(CASCADED_SHADOWS)
+in vec3 worldPosition;
+// One layer for each view of the light.
+uniform sampler2DArrayShadow shadowMap;
+#ifdef POINT_SHADOWS
+// The six views around the light, ordered as +X, -X, +Y, -Y, +Z, -Z.
+uniform mat4 shadowMatrices[6];
+uniform vec3 shadowLightPosition;
+#else
+uniform mat4 shadowMatrices[SHADOW_CASCADE_COUNT];
+// The far distance of each cascade from the camera.
+uniform float cascadeSplits[SHADOW_CASCADE_COUNT];
+#endif
+
+// Returns the fraction of the main light reaching the fragment.
+float ComputeShadow()
+{
+#ifdef POINT_SHADOWS
+    // The view is the one facing the major axis of the light's direction.
+    vec3 d = worldPosition - shadowLightPosition;
+    vec3 a = abs(d);
+    int layer;
+    if (a.x >= a.y && a.x >= a.z)
+        layer = d.x > 0.0 ? 0 : 1;
+    else if (a.y >= a.z)
+        layer = d.y > 0.0 ? 2 : 3;
+    else
+        layer = d.z > 0.0 ? 4 : 5;
+#else
+    // The first cascade containing the fragment; beyond the last one there are no shadows.
+    float distanceV = vViewPosition.z;
+    if (distanceV > cascadeSplits[SHADOW_CASCADE_COUNT - 1])
+        return 1.0;
+    int layer = 0;
+    while (distanceV > cascadeSplits[layer])
+        layer++;
+#endif
+    vec4 lightPosition = shadowMatrices[layer] * vec4(worldPosition, 1.0);
+    vec3 coords = lightPosition.xyz / lightPosition.w * 0.5 + 0.5;
+
+    // 3x3 percentage closer filtering.
+    float texelSize = 1.0 / textureSize(shadowMap, 0).x;
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++)
+        for (int y = -1; y <= 1; y++)
+            lit += texture(shadowMap, vec4(coords.xy + texelSize * vec2(x, y), layer, coords.z));
+    return lit / 9.0;
+}
+#endif
 
 void main()
 {
     // applico la ripetizione delle UV e campiono la texture
     vec2 repeated_Uv = mod(interp_UV*repeat, 1.0);
+#ifdef USE_TEXTURE
     vec4 surfaceColor = texture(tex, repeated_Uv);
+#else
+    vec4 surfaceColor = vec4(diffuseColor, 1.0); 
+#endif
     float s = shininess;
-    if (usesTexture < 1.0)
-        // If not using a texture, replace texture color with diffuse color.
-        surfaceColor = vec4(diffuseColor, 1.0); 
+    float kSpec = Ks;
 
+#ifdef PAINTABLE
     float paintAlpha = 0.0;
     float texelSize = 1.0 / textureSize(paintMap, 0).x;
     for (int x = -1; x <= 1; x++)
@@ -69,13 +160,8 @@ void main()
             paintAlpha += float(texture(paintMap, interp_UV + texelSize * vec2(x, y)).r)/max_ubyte; 
     paintAlpha = (9.0 - paintAlpha) / 9.0;
     
-    // Consider paint alpha only if the material is paintable.
-	paintAlpha *= isPaintable;
-    
     // Applies noise.
-    float kSpec = Ks;
-    
-	paintAlpha = clamp(paintAlpha - texture2D(perlinNoise, repeated_Uv).r, 0.0, 1.0);
+	paintAlpha = clamp(paintAlpha - texture(perlinNoise, repeated_Uv).r, 0.0, 1.0);
     if (paintAlpha > 0.21)
     {
         paintAlpha = 1.0;
@@ -88,14 +174,22 @@ void main()
 
     // Blends surface color with paint color.
     surfaceColor = surfaceColor * (1.0 - paintAlpha) + paintAlpha * vec4(paintColor, 1.0);
+#endif
 
     // Computes ambiental component.
     vec4 color = vec4(Ka*ambientColor,1.0);
 
     // If found, uses a normal map instead of vertex normal.
+#ifdef USE_NORMAL_MAP
+    // Normal maps are stored as two channels (BC5): the third component is rebuilt.
+    vec3 N;
+    N.xy = texture(normalMap, repeated_Uv).rg * 2.0 - 1.0;
+    N.z = sqrt(max(1.0 - dot(N.xy, N.xy), 0.0));
+    // From tangent space to view space.
+    N = normalize(mat3(normalize(vTangent), normalize(vBitangent), normalize(vNormal)) * N);
+#else
     vec3 N = normalize(vNormal);
-    if (usesNormalMap > 0.0)
-        N = normalize(texture2D(normalMap, repeated_Uv).rgb * 2.0 - 1.0);
+#endif
 
     vec3 L = normalize(lightDir.xyz);
     float distanceL = length(L);
@@ -118,11 +212,41 @@ void main()
         // Applies shininess.
         float specular = pow(specAngle, s);
 
+        float shadow = 1.0;
+#if defined(POINT_SHADOWS) || defined(CASCADED_SHADOWS)
+        shadow = ComputeShadow();
+#endif
+
         // Adds diffusive and specular components.
-        color += Kd * lambertian * surfaceColor +
-                        vec4(kSpec * specular * specularColor,1.0);
+        color += shadow * (Kd * lambertian * surfaceColor +
+                        vec4(kSpec * specular * specularColor,1.0));
         color*=attenuation;
     }
 
+#ifdef TILED_LIGHTS
+    // Only the lights that can reach the tile are iterated.
+    ivec2 tile = ivec2(gl_FragCoord.xy) / LIGHT_TILE_SIZE;
+    uint base = uint(tile.y * tileCountX + tile.x) * (MAX_LIGHTS_PER_TILE + 1);
+    uint tileLightCount = tileData[base];
+    vec3 V = normalize(vViewPosition);
+    for (uint i = 0; i < tileLightCount; i++)
+    {
+        PointLight light = lights[tileData[base + 1 + i]];
+        vec3 toLight = light.positionRadius.xyz + vViewPosition;
+        float d = length(toLight);
+        // Smooth falloff reaching zero at the radius.
+        float falloff = clamp(1.0 - d / light.positionRadius.w, 0.0, 1.0);
+        falloff *= falloff;
+        vec3 Lp = toLight / max(d, 0.0001);
+        float lambertianP = max(dot(Lp, N), 0.0);
+        if (lambertianP > 0.0)
+        {
+            float specularP = pow(max(dot(normalize(Lp + V), N), 0.0), s);
+            color.rgb += falloff * light.color.rgb * 
+                (Kd * lambertianP * surfaceColor.rgb + kSpec * specularP * specularColor);
+        }
+    }
+#endif
+
     colorFrag  = color;
-}
\ No newline at end of file
+}
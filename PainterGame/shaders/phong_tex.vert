@@ -6,6 +6,11 @@ layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 // coordinate texture
 layout (location = 2) in vec2 UV;
+#ifdef USE_NORMAL_MAP
+// Tangent, with the handedness of the tangent frame in w (1 for the full vertex format, which
+// only stores xyz).
+layout (location = 3) in vec4 tangent;
+#endif
 
 // matrice di modellazione
 uniform mat4 modelMatrix;
@@ -34,6 +39,20 @@ out vec3 vViewPosition;
 
 out vec2 interp_UV;
 
+#ifdef USE_NORMAL_MAP
+// Tangent and bitangent in view coordinates, to bring the normal map in view space.
+out vec3 vTangent;
+out vec3 vBitangent;
+#endif
+
+#if defined(POINT_SHADOWS) || defined(CASCADED_SHADOWS)
+// Position in world coordinates, projected on the shadow maps.
+out vec3 worldPosition;
+#endif
+
+
+// Must match the depth prepass.
+invariant gl_Position;
 
 void main()
 {
@@ -44,6 +63,11 @@ void main()
     vViewPosition = -mvPosition.xyz;
     // trasformazione coordinate normali in coordinate vista 
     vNormal = normalize( normalMatrix * normal );
+#ifdef USE_NORMAL_MAP
+    // The bitangent is not stored: it is rebuilt from the normal and the tangent's handedness.
+    vTangent = normalize( normalMatrix * tangent.xyz );
+    vBitangent = cross( vNormal, vTangent ) * tangent.w;
+#endif
 
     // calcolo del vettore di incidenza della luce.
     vec4 lightPos = viewMatrix  * vec4(pointLightPosition, 1.0);
@@ -56,4 +80,8 @@ void main()
     // i valori verranno interpolati su tutti i frammenti generati in fase
     // di rasterizzazione tra un vertice e l'altro.
     interp_UV = UV;
+
+#if defined(POINT_SHADOWS) || defined(CASCADED_SHADOWS)
+    worldPosition = vec3(modelMatrix * vec4(position, 1.0));
+#endif
 }
\ No newline at end of file
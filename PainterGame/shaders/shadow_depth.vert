@@ -0,0 +1,20 @@
+#version 440 core
+
+// Shadow pass: the instances of a model are drawn with a single call, reading their model
+// matrices from the instance buffer.
+layout (location = 0) in vec3 position;
+
+layout (std430, binding = 2) readonly buffer InstanceBuffer
+{
+    mat4 modelMatrices[];
+};
+
+// The first matrix of the batch in the instance buffer.
+uniform int instanceOffset;
+// Transforms world coordinates to the light's clip coordinates.
+uniform mat4 lightMatrix;
+
+void main()
+{
+    gl_Position = lightMatrix * modelMatrices[instanceOffset + gl_InstanceID] * vec4(position, 1.0);
+}
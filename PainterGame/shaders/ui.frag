@@ -4,13 +4,18 @@ out vec4 fragColor;
 
 uniform sampler2D scene;
 uniform sampler2D ui;
+// The fraction of the scene texture covered by the scene, rendered at a lower resolution
+// when dynamic resolution is enabled.
+uniform vec2 sceneScale = vec2(1.0);
 
 in vec2 TexCoords;
 
 void main()
 {
-    vec4 uiColor = texture2D(ui, TexCoords);
-    vec4 sceneColor = texture2D(scene, TexCoords);
+    vec4 uiColor = texture(ui, TexCoords);
+    // Upscales the scene, never sampling beyond the rendered area.
+    vec2 sceneUV = min(TexCoords * sceneScale, sceneScale - 0.5 / textureSize(scene, 0));
+    vec4 sceneColor = texture(scene, sceneUV);
     if (uiColor.r > 0 && uiColor.g > 0 && uiColor.b > 0)
         fragColor = uiColor;
     else
@@ -9,7 +9,7 @@ AComponent::AComponent()
 
 AComponent::AComponent(GameObject* go, unsigned int id)
 {
-	this->gameObject = go;
+	SetGameObject(go);
 	this->id = id;
 }
 
@@ -19,21 +19,35 @@ void AComponent::OnCreate()
 	// do nothing.
 }
 
+void AComponent::OnFixedUpdate(float deltaTime)
+{
+	// do nothing.
+}
+
 void AComponent::OnUpdate(float deltaTime)
 {
 	// do nothing.
 }
 
+void AComponent::OnPostPhysics(float deltaTime)
+{
+	// do nothing.
+}
+
 void AComponent::OnCollision(GameObject* other, glm::vec3 hitPoint)
 {
 	// do nothing.
 }
 
-GameObject* AComponent::GetGameObject() { return gameObject; }
+GameObject* AComponent::GetGameObject() 
+{ 
+	return gameObjects != NULL ? gameObjects->Get(owner) : NULL; 
+}
 
 void AComponent::SetGameObject(GameObject* gameObject)
 {
-	this->gameObject = gameObject;
+	owner = gameObject != NULL ? gameObject->GetHandle() : GameObjectHandle();
+	gameObjects = gameObject != NULL ? gameObject->GetPool() : NULL;
 }
 
 unsigned int AComponent::GetID() { return id; }
\ No newline at end of file
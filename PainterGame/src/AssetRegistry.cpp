@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <iostream>
+
+#include "AssetRegistry.hpp"
+#include "TextureCompression.hpp"
+
+AssetRegistry& AssetRegistry::Instance()
+{
+	static AssetRegistry instance;
+	return instance;
+}
+
+AssetRegistry::AssetRegistry() {}
+
+Model* AssetRegistry::AcquireModel(const std::string& path, unsigned int meshFlags)
+{
+	// The flags change the imported data: the same file with different flags is another asset.
+	const std::string key = path + "|" + std::to_string(meshFlags);
+	std::unordered_map<std::string, ModelEntry>::iterator it = models.find(key);
+	if (it != models.end())
+	{
+		modelHits++;
+		it->second.references++;
+		return it->second.model;
+	}
+
+	modelMisses++;
+	ModelEntry entry;
+	entry.model = new Model(path, meshFlags);
+	entry.references = 1;
+	models[key] = entry;
+	modelKeys[entry.model] = key;
+	return entry.model;
+}
+
+std::vector<Model*> AssetRegistry::AcquireModels(const std::vector<std::string>& paths, unsigned int meshFlags)
+{
+	// Lists the models not loaded yet, each once.
+	std::vector<std::string> missing;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		const std::string key = paths[i] + "|" + std::to_string(meshFlags);
+		if (models.find(key) == models.end() && std::find(missing.begin(), missing.end(), paths[i]) == missing.end())
+			missing.push_back(paths[i]);
+	}
+
+	std::vector<Model*> loaded = LoadModels(missing, meshFlags);
+	for (size_t i = 0; i < missing.size(); i++)
+	{
+		const std::string key = missing[i] + "|" + std::to_string(meshFlags);
+		ModelEntry entry;
+		entry.model = loaded[i];
+		entry.references = 0;
+		models[key] = entry;
+		modelKeys[entry.model] = key;
+	}
+
+	// The first reference to each loaded model is a miss, as if acquired alone.
+	std::vector<Model*> acquired(paths.size());
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		ModelEntry& entry = models[paths[i] + "|" + std::to_string(meshFlags)];
+		if (entry.references == 0)
+			modelMisses++;
+		else
+			modelHits++;
+		entry.references++;
+		acquired[i] = entry.model;
+	}
+	return acquired;
+}
+
+void AssetRegistry::ReleaseModel(Model* model)
+{
+	std::unordered_map<Model*, std::string>::iterator key = modelKeys.find(model);
+	if (key == modelKeys.end())
+	{
+		std::cout << "ERROR::ASSETS:: Releasing a model not acquired from the registry" << std::endl;
+		return;
+	}
+
+	std::unordered_map<std::string, ModelEntry>::iterator it = models.find(key->second);
+	if (--it->second.references > 0)
+		return;
+	delete model;
+	models.erase(it);
+	modelKeys.erase(key);
+}
+
+GLuint AssetRegistry::AcquireTexture(const std::string& path, int usage)
+{
+	const std::string key = path + "|" + std::to_string(usage);
+	std::unordered_map<std::string, TextureEntry>::iterator it = textures.find(key);
+	if (it != textures.end())
+	{
+		textureHits++;
+		it->second.references++;
+		return it->second.texture;
+	}
+
+	textureMisses++;
+	TextureEntry entry;
+	entry.texture = TextureStreamer::Instance().Request(path, usage);
+	entry.references = 1;
+	textures[key] = entry;
+	textureKeys[entry.texture] = key;
+	return entry.texture;
+}
+
+void AssetRegistry::ReleaseTexture(GLuint texture)
+{
+	std::unordered_map<GLuint, std::string>::iterator key = textureKeys.find(texture);
+	if (key == textureKeys.end())
+	{
+		std::cout << "ERROR::ASSETS:: Releasing a texture not acquired from the registry" << std::endl;
+		return;
+	}
+
+	std::unordered_map<std::string, TextureEntry>::iterator it = textures.find(key->second);
+	if (--it->second.references > 0)
+		return;
+	TextureStreamer::Instance().Delete(texture);
+	textures.erase(it);
+	textureKeys.erase(key);
+}
+
+size_t AssetRegistry::GetTextureBytes(GLuint texture)
+{
+	GLint baseLevel = 0, maxLevel = 0;
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+	size_t bytes = 0;
+	for (GLint level = baseLevel; level <= maxLevel; level++)
+	{
+		GLint width = 0, height = 0, format = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_INTERNAL_FORMAT, &format);
+		if (width == 0 || height == 0)
+			break;
+		bytes += GetImageSize((GLenum)format, width, height);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return bytes;
+}
+
+void AssetRegistry::PrintReport()
+{
+	size_t modelBytes = 0, textureBytes = 0;
+	for (std::unordered_map<std::string, ModelEntry>::iterator it = models.begin(); it != models.end(); it++)
+		modelBytes += it->second.model->GetGpuBytes();
+	for (std::unordered_map<std::string, TextureEntry>::iterator it = textures.begin(); it != textures.end(); it++)
+		textureBytes += GetTextureBytes(it->second.texture);
+
+	std::cout << "INFO::ASSETS:: " << models.size() << " models (" << modelHits << " hits, "
+		<< modelMisses << " misses), " << modelBytes / 1024 << " KB resident" << std::endl;
+	std::cout << "INFO::ASSETS:: " << textures.size() << " textures (" << textureHits << " hits, "
+		<< textureMisses << " misses), " << textureBytes / 1024 << " KB resident" << std::endl;
+}
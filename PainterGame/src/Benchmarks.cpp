@@ -0,0 +1,1312 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "Benchmarks.hpp"
+#include "FixedTimestep.hpp"
+#include "JobSystem.hpp"
+#include "MeshCache.hpp"
+#include "PaintBallComponent.hpp"
+#include "RigidbodyComponent.h"
+#include "Scene.hpp"
+#include "SelfMovingComponent.h"
+#include "TransformHierarchy.hpp"
+
+bool HasArgument(int argc, char* argv[], const char* flag)
+{
+	for (int i = 1; i < argc; i++)
+		if (strcmp(argv[i], flag) == 0)
+			return true;
+	return false;
+}
+
+const char* GetArgumentValue(int argc, char* argv[], const char* flag)
+{
+	for (int i = 1; i < argc - 1; i++)
+		if (strcmp(argv[i], flag) == 0)
+			return argv[i + 1];
+	return nullptr;
+}
+
+// Prints the outcome of a check made by a benchmark, and returns whether it passed.
+static bool ReportCheck(const std::string& name, bool passed)
+{
+	std::cout << "[CHECK] " << name << (passed ? ": passed" : ": FAILED") << std::endl;
+	return passed;
+}
+
+// The draw routine the meshes used before binding tables were introduced: it receives
+// the shader by value, builds the sampler names and looks their location up at every
+// draw, then unbinds all the textures.
+static void LegacyDraw(Mesh& mesh, Shader shader)
+{
+	GLuint diffuseNr = 1;
+	GLuint specularNr = 1;
+	GLuint normalNr = 1;
+	GLuint heightNr = 1;
+
+	const size_t nTextures = mesh.textures.size();
+	for (GLuint i = 0; i < nTextures; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		std::stringstream ss;
+		std::string name = mesh.textures[i].type;
+		if (name == "texture_diffuse")
+			ss << diffuseNr++;
+		else if (name == "texture_specular")
+			ss << specularNr++;
+		else if (name == "texture_normal")
+			ss << normalNr++;
+		else if (name == "texture_height")
+			ss << heightNr++;
+		glUniform1i(glGetUniformLocation(shader.program, (name + ss.str()).c_str()), i);
+		glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
+	}
+
+	glBindVertexArray(mesh.VAO);
+	glDrawElements(GL_TRIANGLES, mesh.GetIndexCount(), mesh.GetIndexType(), 0);
+	glBindVertexArray(0);
+
+	for (GLuint i = 0; i < mesh.textures.size(); i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
+static void LegacyDraw(Model* model, Shader shader)
+{
+	for (GLuint i = 0; i < model->meshes.size(); i++)
+		LegacyDraw(model->meshes[i], shader);
+}
+
+void BenchmarkMeshDraw(const std::string& name, Model* model, const Shader& shader, int nDraws)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	shader.Use();
+
+	// Warm-up: resolves the binding tables and lets the driver settle.
+	model->Draw(shader);
+	LegacyDraw(model, shader);
+	glFinish();
+
+	// Only the submission is timed: the GPU is drained before each run.
+	Clock::time_point begin = Clock::now();
+	for (int i = 0; i < nDraws; i++)
+		LegacyDraw(model, shader);
+	double legacyTime = std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+	glFinish();
+
+	begin = Clock::now();
+	for (int i = 0; i < nDraws; i++)
+		model->Draw(shader);
+	double tableTime = std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+	glFinish();
+
+	std::cout << "[BENCHMARK] Draw " << name << " (" << model->meshes.size() << " meshes, " 
+		<< nDraws << " draws): per-draw lookup " << legacyTime / nDraws << " us, binding table " 
+		<< tableTime / nDraws << " us" << std::endl;
+}
+
+// Returns true if the two models have the same buffers.
+static bool HaveSameBuffers(const Model& a, const Model& b)
+{
+	if (a.meshes.size() != b.meshes.size())
+		return false;
+	for (size_t i = 0; i < a.meshes.size(); i++)
+	{
+		std::vector<unsigned char> verticesA, indicesA, verticesB, indicesB;
+		a.meshes[i].ReadBuffers(verticesA, indicesA);
+		b.meshes[i].ReadBuffers(verticesB, indicesB);
+		if (verticesA != verticesB || indicesA != indicesB 
+			|| a.meshes[i].GetIndexType() != b.meshes[i].GetIndexType())
+			return false;
+	}
+	return true;
+}
+
+bool BenchmarkModelLoad(const std::string& path, unsigned int meshFlags)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// Cold start: the cache file is removed, Assimp imports the model and stores it again.
+	std::remove(GetMeshCachePath(path, meshFlags).c_str());
+	Clock::time_point begin = Clock::now();
+	Model* imported = new Model(path, meshFlags);
+	double importTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	// Warm start: the meshes are mapped from the cache.
+	begin = Clock::now();
+	Model* cached = new Model(path, meshFlags);
+	double cacheTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	bool identical = HaveSameBuffers(*imported, *cached);
+	delete imported;
+	delete cached;
+
+	std::cout << "[BENCHMARK] Load " << path << ": Assimp " << importTime << " ms, cache " << cacheTime
+		<< " ms (" << importTime / cacheTime << "x)" << std::endl;
+	return ReportCheck("Mesh cache of " + path + " gives the imported buffers", identical);
+}
+
+void BenchmarkParallelModelLoad(const std::vector<std::string>& paths, unsigned int meshFlags)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// Both runs import the models from their source: the cache files are removed before each.
+	for (size_t i = 0; i < paths.size(); i++)
+		std::remove(GetMeshCachePath(paths[i], meshFlags).c_str());
+	Clock::time_point begin = Clock::now();
+	std::vector<Model*> sequential;
+	for (size_t i = 0; i < paths.size(); i++)
+		sequential.push_back(new Model(paths[i], meshFlags));
+	double sequentialTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	for (size_t i = 0; i < paths.size(); i++)
+		std::remove(GetMeshCachePath(paths[i], meshFlags).c_str());
+	begin = Clock::now();
+	std::vector<Model*> parallel = LoadModels(paths, meshFlags);
+	double parallelTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	bool identical = true;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		identical = identical && HaveSameBuffers(*sequential[i], *parallel[i]);
+		delete sequential[i];
+		delete parallel[i];
+	}
+
+	std::cout << "[BENCHMARK] Import " << paths.size() << " models: sequential " << sequentialTime 
+		<< " ms, parallel " << parallelTime << " ms (" << sequentialTime / parallelTime << "x), buffers "
+		<< (identical ? "identical" : "DIFFERENT") << std::endl;
+}
+
+void BenchmarkLights(RenderingEngine* engine, glm::mat4 view, glm::mat4 projection, int nLights, 
+	int nFrames)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> horizontal(-8.0f, 8.0f), vertical(0.5f, 9.5f), 
+		channel(0.2f, 1.0f), radius(1.5f, 4.0f);
+	engine->lights->ClearLights();
+	for (int i = 0; i < nLights; i++)
+		engine->lights->AddLight(glm::vec3(horizontal(random), vertical(random), horizontal(random)),
+			glm::vec3(channel(random), channel(random), channel(random)), radius(random));
+
+	// Warm-up: compiles the tiled variants and allocates the tile buffer.
+	engine->RenderAll(view, projection);
+	glFinish();
+
+	Clock::time_point begin = Clock::now();
+	for (int i = 0; i < nFrames; i++)
+	{
+		engine->RenderAll(view, projection);
+		glFinish();
+	}
+	double frameTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / nFrames;
+	engine->lights->ClearLights();
+
+	std::cout << "[BENCHMARK] Lights " << nLights << " (" << nFrames << " frames): " << frameTime 
+		<< " ms per frame" << std::endl;
+}
+
+// A component standing in for the types of the given ID and phases, counting its instances and
+// the calls it receives.
+template <unsigned int ID, unsigned int CALLED_PHASES>
+class StandInComponent : public AComponent
+{
+public:
+	static const unsigned int TYPE_ID = ID;
+	static const unsigned int PHASES = CALLED_PHASES;
+	static const unsigned int READS = 0;
+	static const unsigned int WRITES = 0;
+
+	// The instances alive.
+	static int alive;
+
+	// The calls received in each phase, and the value given at the construction.
+	int calls[COMPONENT_PHASE_COUNT];
+	int value;
+
+	StandInComponent(GameObject* gameObject, int value) : AComponent(gameObject, ID), value(value)
+	{
+		for (int phase = 0; phase < COMPONENT_PHASE_COUNT; phase++)
+			calls[phase] = 0;
+		alive++;
+	}
+	~StandInComponent() { alive--; }
+
+	void OnFixedUpdate(float) override { calls[COMPONENT_FIXED_STEP]++; }
+	void OnUpdate(float) override { calls[COMPONENT_VARIABLE_STEP]++; }
+	void OnPostPhysics(float) override { calls[COMPONENT_POST_PHYSICS]++; }
+	void OnCollision(GameObject*, glm::vec3) override { calls[COMPONENT_COLLISION]++; }
+};
+
+template <unsigned int ID, unsigned int CALLED_PHASES> int StandInComponent<ID, CALLED_PHASES>::alive = 0;
+
+bool BenchmarkComponentPool(int nEntities, int nOperations)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	typedef StandInComponent<PAINT_BALL_COMPONENT, COMPONENT_PHASE(COMPONENT_VARIABLE_STEP)> PooledComponent;
+	bool consistent = true, reused = true;
+	double operationTime;
+	{
+		// The value of each entity's component, -1 if it has none.
+		ComponentPool<PooledComponent> pool;
+		std::vector<int> reference(nEntities, -1);
+		std::mt19937 random(42);
+		int nAlive = 0, peakAlive = 0;
+		Clock::time_point begin = Clock::now();
+		for (int i = 0; i < nOperations; i++)
+		{
+			// Adds, replaces or removes the component of a random entity.
+			const int entity = random() % nEntities;
+			if (random() % 3 == 0)
+			{
+				consistent = consistent && pool.Remove(entity) == (reference[entity] >= 0);
+				nAlive -= reference[entity] >= 0 ? 1 : 0;
+				reference[entity] = -1;
+			}
+			else
+			{
+				pool.Add(entity, nullptr, i);
+				nAlive += reference[entity] < 0 ? 1 : 0;
+				reference[entity] = i;
+			}
+			peakAlive = std::max(peakAlive, nAlive);
+		}
+		operationTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+		// A sweep calls each component once.
+		pool.Update(COMPONENT_VARIABLE_STEP, 0.0f, 0, pool.GetSlotCount());
+		consistent = consistent && (int)pool.GetCount() == nAlive && PooledComponent::alive == nAlive;
+		for (int entity = 0; entity < nEntities; entity++)
+		{
+			PooledComponent* component = pool.Find(entity);
+			consistent = consistent && (reference[entity] < 0 ? component == NULL : 
+				component != NULL && component->value == reference[entity] && 
+				component->calls[COMPONENT_VARIABLE_STEP] == 1);
+		}
+		// The freed slots are taken first: the pool never holds more slots than components at once.
+		reused = (int)pool.GetSlotCount() <= peakAlive;
+	}
+	const bool balanced = PooledComponent::alive == 0;
+
+	std::cout << "[BENCHMARK] Component pool " << nOperations << " operations on " << nEntities << " entities: "
+		<< operationTime << " ms" << std::endl;
+	bool passed = ReportCheck("Component pool finds the last component of each entity", consistent);
+	passed = ReportCheck("Component pool reuses the freed slots", reused) && passed;
+	return ReportCheck("Component pool destroys every component", balanced) && passed;
+}
+
+// Counts, in the stand-ins of every entity, the phases whose calls differ from the expected ones.
+template <class T>
+static int CountUnexpectedCalls(ComponentRegistry& registry, int nEntities, int callsPerPhase)
+{
+	int unexpected = 0;
+	for (int entity = 0; entity < nEntities; entity++)
+	{
+		const T* component = registry.Get<T>(entity);
+		for (int phase = 0; phase < COMPONENT_PHASE_COUNT; phase++)
+		{
+			// The collisions are dispatched once per entity, the other phases by each update.
+			const int expected = (T::PHASES & COMPONENT_PHASE(phase)) == 0 ? 0 : 
+				phase == COMPONENT_COLLISION ? 1 : callsPerPhase;
+			unexpected += component->calls[phase] != expected ? 1 : 0;
+		}
+	}
+	return unexpected;
+}
+
+bool BenchmarkPhaseDispatch(int nEntities)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	typedef StandInComponent<PAINT_BALL_COMPONENT, COMPONENT_PHASE(COMPONENT_FIXED_STEP) | 
+		COMPONENT_PHASE(COMPONENT_COLLISION)> FixedStandIn;
+	typedef StandInComponent<PAINTABLE_COMPONENT, 0> UnregisteredStandIn;
+	typedef StandInComponent<RIGIDBODY_COMPONENT, COMPONENT_PHASE(COMPONENT_VARIABLE_STEP) | 
+		COMPONENT_PHASE(COMPONENT_POST_PHYSICS)> VariableStandIn;
+	typedef StandInComponent<SELFMOVING_COMPONENT, COMPONENT_PHASE(COMPONENT_FIXED_STEP) | 
+		COMPONENT_PHASE(COMPONENT_VARIABLE_STEP) | COMPONENT_PHASE(COMPONENT_POST_PHYSICS) | 
+		COMPONENT_PHASE(COMPONENT_COLLISION)> EveryPhaseStandIn;
+
+	// Every entity has a component of each type.
+	ComponentRegistry registry;
+	for (int entity = 0; entity < nEntities; entity++)
+	{
+		registry.Add<FixedStandIn>(entity, nullptr, entity);
+		registry.Add<UnregisteredStandIn>(entity, nullptr, entity);
+		registry.Add<VariableStandIn>(entity, nullptr, entity);
+		registry.Add<EveryPhaseStandIn>(entity, nullptr, entity);
+	}
+
+	// Each phase is dispatched by the sequential, the parallel and the per-entity updates.
+	Clock::time_point begin = Clock::now();
+	for (int phase = 0; phase < COMPONENT_PHASE_COUNT; phase++)
+	{
+		if (phase == COMPONENT_COLLISION)
+			continue;
+		registry.Update(phase, 0.0f);
+		registry.UpdateParallel(phase, 0.0f);
+		for (int entity = 0; entity < nEntities; entity++)
+			registry.UpdateEntity(entity, phase, 0.0f);
+	}
+	for (int entity = 0; entity < nEntities; entity++)
+		registry.Collide(entity, nullptr, glm::vec3(0, 0, 0));
+	const double dispatchTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	const int unexpected = CountUnexpectedCalls<FixedStandIn>(registry, nEntities, 3) + 
+		CountUnexpectedCalls<UnregisteredStandIn>(registry, nEntities, 3) +
+		CountUnexpectedCalls<VariableStandIn>(registry, nEntities, 3) + 
+		CountUnexpectedCalls<EveryPhaseStandIn>(registry, nEntities, 3);
+
+	std::cout << "[BENCHMARK] Phase dispatch " << nEntities << " entities of 4 types: every phase 3 ways and "
+		<< "the collisions " << dispatchTime << " ms, " << unexpected << " unexpected call counts" << std::endl;
+	return ReportCheck("Components are called exactly in the phases of their type", unexpected == 0);
+}
+
+bool BenchmarkGameObjectPool(int nOperations)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	typedef StandInComponent<PAINT_BALL_COMPONENT, 0> OwnedComponent;
+	GameObjectPool pool;
+	std::vector<GameObjectHandle> alive, destroyed;
+	std::mt19937 random(42);
+	Clock::time_point begin = Clock::now();
+	for (int i = 0; i < nOperations; i++)
+	{
+		// Creates two gameobjects for each one destroyed, in random order.
+		if (alive.empty() || random() % 3 != 0)
+			alive.push_back(pool.Create("Benchmark", glm::vec3((float)i, 0, 0), glm::vec3(0, 0, 0), 
+				glm::vec3(1, 1, 1), nullptr, nullptr)->GetHandle());
+		else
+		{
+			const size_t victim = random() % alive.size();
+			pool.Destroy(alive[victim]);
+			destroyed.push_back(alive[victim]);
+			alive[victim] = alive.back();
+			alive.pop_back();
+		}
+	}
+	const double operationTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	// The dense array lists exactly the gameobjects alive, and every handle finds its own.
+	bool consistent = pool.GetCount() == alive.size() && pool.GetObjects().size() == alive.size();
+	const std::vector<GameObject*>& objects = pool.GetObjects();
+	for (size_t i = 0; i < objects.size(); i++)
+		consistent = consistent && pool.Get(objects[i]->GetHandle()) == objects[i];
+	for (size_t i = 0; i < alive.size(); i++)
+		consistent = consistent && pool.Get(alive[i]) != NULL && pool.Get(alive[i])->GetHandle() == alive[i];
+	bool handlesRejected = true;
+	for (size_t i = 0; i < destroyed.size(); i++)
+		handlesRejected = handlesRejected && pool.Get(destroyed[i]) == NULL;
+
+	// A component finds its owner through the handle, and nothing once the owner is destroyed,
+	// even if another gameobject took its slot.
+	GameObject* owner = pool.Get(alive.back());
+	OwnedComponent component(owner, 0);
+	bool ownerResolved = component.GetGameObject() == owner;
+	pool.Destroy(alive.back());
+	alive.pop_back();
+	pool.Create("Benchmark", glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), nullptr, nullptr);
+	ownerResolved = ownerResolved && component.GetGameObject() == NULL;
+
+	std::cout << "[BENCHMARK] Gameobject pool " << nOperations << " operations: " << operationTime << " ms, "
+		<< pool.GetCount() << " alive" << std::endl;
+	bool passed = ReportCheck("Gameobject pool lists exactly the gameobjects alive", consistent);
+	passed = ReportCheck("Gameobject pool rejects the stale handles", handlesRejected) && passed;
+	return ReportCheck("Components lose their destroyed owner", ownerResolved) && passed;
+}
+
+// Creates a static box. The body is kept out of the physics world, whose broadphase is sized for
+// the arena.
+static GameObject* CreateStaticObject(RenderingEngine* engine, PhysicsModule* physicsModule, 
+	glm::vec3 position)
+{
+	btTransform bodyTransform(btQuaternion::getIdentity(), btVector3(position.x, position.y, position.z));
+	btRigidBody* rb = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(0, 
+		new btDefaultMotionState(bodyTransform), new btBoxShape(btVector3(0.5f, 0.5f, 0.5f))));
+	GameObject* object = engine->AddGameObject("Benchmark", nullptr, position, glm::vec3(0, 0, 0),
+		glm::vec3(1, 1, 1), nullptr, nullptr);
+	object->AddComponent<RigidbodyComponent>(physicsModule, rb);
+	return object;
+}
+
+// Creates a static box moving back and forth like the sphere of the arena.
+static GameObject* CreateMovingObject(RenderingEngine* engine, PhysicsModule* physicsModule, 
+	glm::vec3 position)
+{
+	GameObject* object = CreateStaticObject(engine, physicsModule, position);
+	object->AddComponent<SelfMovingComponent>(glm::vec3(0, 0, 4), 0.25f);
+	return object;
+}
+
+bool BenchmarkComponentUpdate(RenderingEngine* engine, PhysicsModule* physicsModule, int nObjects, 
+	int nFrames)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	const float deltaTime = 1.0f / 60.0f;
+	const size_t sceneComponents = engine->components.GetCount(RIGIDBODY_COMPONENT) + 
+		engine->components.GetCount(SELFMOVING_COMPONENT);
+
+	// A grid of moving boxes.
+	std::vector<GameObject*> objects(nObjects);
+	std::vector<glm::vec3> startPositions(nObjects);
+	const int side = (int)ceil(sqrt((double)nObjects));
+	for (int i = 0; i < nObjects; i++)
+	{
+		startPositions[i] = glm::vec3((float)(i % side - side / 2), 1.0f, (float)(i / side - side / 2));
+		objects[i] = CreateMovingObject(engine, physicsModule, startPositions[i]);
+	}
+
+	// Each gameobject updating its own components, as the engine used to.
+	Clock::time_point begin = Clock::now();
+	for (int frame = 0; frame < nFrames; frame++)
+		for (int i = 0; i < nObjects; i++)
+			objects[i]->UpdateComponents(COMPONENT_FIXED_STEP, deltaTime);
+	double perObjectTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / nFrames;
+
+	// The registry sweeping each pool.
+	begin = Clock::now();
+	for (int frame = 0; frame < nFrames; frame++)
+		engine->components.Update(COMPONENT_FIXED_STEP, deltaTime);
+	double perTypeTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / nFrames;
+
+	// All the objects moved in lockstep if no component has been skipped or updated twice.
+	bool consistent = true;
+	const glm::vec3 offset = objects[0]->GetTransform()->GetAbsolutePosition() - startPositions[0];
+	for (int i = 0; i < nObjects; i++)
+	{
+		glm::vec3 difference = objects[i]->GetTransform()->GetAbsolutePosition() - startPositions[i] - offset;
+		consistent = consistent && glm::dot(difference, difference) < 1e-6f;
+	}
+
+	// Destroys the objects in random order, so that most removals move another object.
+	std::vector<GameObjectHandle> handles(nObjects);
+	for (int i = 0; i < nObjects; i++)
+		handles[i] = objects[i]->GetHandle();
+	std::shuffle(objects.begin(), objects.end(), std::mt19937(42));
+	begin = Clock::now();
+	for (int i = 0; i < nObjects; i++)
+		objects[i]->Destroy();
+	engine->DestroyGameObjects();
+	double destroyTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+	const bool released = engine->components.GetCount(RIGIDBODY_COMPONENT) + 
+		engine->components.GetCount(SELFMOVING_COMPONENT) == sceneComponents;
+
+	// The handles of the destroyed objects must not find the objects reusing their slots.
+	GameObject* reused = engine->AddGameObject("Benchmark", nullptr, glm::vec3(0, 0, 0), glm::vec3(0, 0, 0),
+		glm::vec3(1, 1, 1), nullptr, nullptr);
+	bool handlesRejected = engine->GetGameObject(reused->GetHandle()) == reused;
+	for (int i = 0; i < nObjects; i++)
+		handlesRejected = handlesRejected && engine->GetGameObject(handles[i]) == NULL;
+	reused->Destroy();
+	engine->DestroyGameObjects();
+
+	// A scene of static boxes, whose rigidbodies are registered for no phase.
+	for (int i = 0; i < nObjects; i++)
+		objects[i] = CreateStaticObject(engine, physicsModule, startPositions[i]);
+	begin = Clock::now();
+	for (int frame = 0; frame < nFrames; frame++)
+		for (int phase = 0; phase < COMPONENT_PHASE_COUNT; phase++)
+			engine->components.Update(phase, deltaTime);
+	double staticTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / nFrames;
+	for (int i = 0; i < nObjects; i++)
+		objects[i]->Destroy();
+	engine->DestroyGameObjects();
+
+	std::cout << "[BENCHMARK] Component update " << nObjects << " objects (" << nFrames << " frames): per object "
+		<< perObjectTime << " ms, per type " << perTypeTime << " ms (" << perObjectTime / perTypeTime 
+		<< "x)" << std::endl;
+	std::cout << "[BENCHMARK] Destroy " << nObjects << " objects: " << destroyTime << " ms" << std::endl;
+	std::cout << "[BENCHMARK] Static scene " << nObjects << " objects: all the phases " << staticTime 
+		<< " ms per frame" << std::endl;
+	bool passed = ReportCheck("Component update moves every object once per frame", consistent);
+	passed = ReportCheck("Component update releases the destroyed objects' components", released) && passed;
+	return ReportCheck("Component update rejects the stale handles", handlesRejected) && passed;
+}
+
+bool BenchmarkDestruction(RenderingEngine* engine, PhysicsModule* physicsModule, int nObjects)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	const int sceneBodies = physicsModule->dynamicsWorld->getNumCollisionObjects();
+	const int sceneNonStaticBodies = physicsModule->dynamicsWorld->GetNonStaticRigidBodies().size();
+	const int sceneShapes = physicsModule->collisionShapes.size();
+	const size_t sceneObjects = engine->gameObjects.GetCount();
+	const size_t sceneComponents = engine->components.GetCount(RIGIDBODY_COMPONENT);
+
+	// Small spheres high above the arena, within the broadphase bounds, like the paint balls.
+	std::vector<glm::vec3> positions(nObjects);
+	const int side = (int)ceil(sqrt((double)nObjects));
+	for (int i = 0; i < nObjects; i++)
+		positions[i] = glm::vec3((float)(i % side - side / 2), 50.0f, (float)(i / side - side / 2));
+
+	// The bodies removed one by one, as the rigidbody components used to.
+	std::vector<btRigidBody*> bodies(nObjects);
+	for (int i = 0; i < nObjects; i++)
+		bodies[i] = physicsModule->createRigidBody(1, positions[i], glm::vec3(0.1f), glm::vec3(0, 0, 0), 1, 0.3f, 0.3f);
+	std::shuffle(bodies.begin(), bodies.end(), std::mt19937(42));
+	Clock::time_point begin = Clock::now();
+	for (int i = 0; i < nObjects; i++)
+	{
+		physicsModule->removeRigidBody(bodies[i]);
+		physicsModule->collisionWorld->removeCollisionObject(bodies[i]);
+		delete bodies[i]->getMotionState();
+		delete bodies[i]->getCollisionShape();
+		delete bodies[i];
+	}
+	double oneByOneTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	// The gameobjects destroyed by the end-of-frame pass.
+	std::vector<GameObject*> objects(nObjects);
+	for (int i = 0; i < nObjects; i++)
+	{
+		objects[i] = engine->AddGameObject("Benchmark", nullptr, positions[i], glm::vec3(0, 0, 0),
+			glm::vec3(1, 1, 1), nullptr, nullptr);
+		objects[i]->AddComponent<RigidbodyComponent>(physicsModule, physicsModule->createRigidBody(1, 
+			positions[i], glm::vec3(0.1f), glm::vec3(0, 0, 0), 1, 0.3f, 0.3f));
+	}
+	std::shuffle(objects.begin(), objects.end(), std::mt19937(42));
+
+	// Half of them are destroyed after a few steps, the rest after a few more, so that the world
+	// is simulated with the bodies removed in between.
+	double batchTime = 0.0;
+	size_t destroyedObjects = 0, destroyedBodies = 0, pooledBytes = 0, freedBytes = 0;
+	for (int half = 0; half < 2; half++)
+	{
+		for (int step = 0; step < 10; step++)
+			physicsModule->dynamicsWorld->stepSimulation(1.0f / 60, 0);
+		const int first = half == 0 ? 0 : nObjects / 2, end = half == 0 ? nObjects / 2 : nObjects;
+		for (int i = first; i < end; i++)
+			objects[i]->Destroy();
+		begin = Clock::now();
+		engine->DestroyGameObjects();
+		batchTime += std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+		const DestructionStats& stats = engine->GetLastDestruction();
+		destroyedObjects += stats.objects;
+		destroyedBodies += stats.bodies;
+		pooledBytes += stats.pooledBytes;
+		freedBytes += stats.freedBytes;
+	}
+	for (int step = 0; step < 10; step++)
+		physicsModule->dynamicsWorld->stepSimulation(1.0f / 60, 0);
+
+	const bool restored = physicsModule->dynamicsWorld->getNumCollisionObjects() == sceneBodies &&
+		physicsModule->dynamicsWorld->GetNonStaticRigidBodies().size() == sceneNonStaticBodies &&
+		physicsModule->collisionShapes.size() == sceneShapes && physicsModule->queuedRemovals.size() == 0 &&
+		engine->gameObjects.GetCount() == sceneObjects &&
+		engine->components.GetCount(RIGIDBODY_COMPONENT) == sceneComponents &&
+		destroyedObjects == (size_t)nObjects && destroyedBodies == (size_t)nObjects;
+
+	std::cout << "[BENCHMARK] Destruction " << nObjects << " objects with bodies: bodies one by one " 
+		<< oneByOneTime << " ms, batched passes of half " << batchTime << " ms (gameobjects included), " 
+		<< pooledBytes / 1024 << " KB returned to the pools, " << freedBytes / 1024 << " KB freed" << std::endl;
+	return ReportCheck("Destruction restores the world, the shapes and the pools", restored);
+}
+
+bool BenchmarkPhysicsSync(RenderingEngine* engine, PhysicsModule* physicsModule, int nSteps)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	const int sceneBodies = physicsModule->dynamicsWorld->getNumCollisionObjects();
+	const size_t sceneObjects = engine->gameObjects.GetCount();
+
+	// A sphere dropped on a static box, and a static box rotated about z, far from the arena but
+	// within the broadphase bounds. The gameobjects start unrotated, at the bodies' positions.
+	const glm::vec3 groundPosition(60, 0, 60), spherePosition(60, 5, 60), rotatedPosition(-60, 0, 60);
+	GameObject* ground = engine->AddGameObject("Benchmark", nullptr, groundPosition, glm::vec3(0, 0, 0),
+		glm::vec3(2, 0.5f, 2), nullptr, nullptr);
+	ground->AddComponent<RigidbodyComponent>(physicsModule, physicsModule->createRigidBody(SCENE_BODY_BOX,
+		groundPosition, glm::vec3(2, 0.5f, 2), glm::vec3(0, 0, 0), 0, 0.5f, 0));
+	GameObject* sphere = engine->AddGameObject("Benchmark", nullptr, spherePosition, glm::vec3(0, 0, 0),
+		glm::vec3(0.5f), nullptr, nullptr);
+	btRigidBody* sphereBody = physicsModule->createRigidBody(SCENE_BODY_SPHERE, spherePosition, 
+		glm::vec3(0.5f), glm::vec3(0, 0, 0), 1, 0.5f, 0);
+	sphere->AddComponent<RigidbodyComponent>(physicsModule, sphereBody);
+	GameObject* rotated = engine->AddGameObject("Benchmark", nullptr, rotatedPosition, glm::vec3(0, 0, 0),
+		glm::vec3(1, 1, 1), nullptr, nullptr);
+	btRigidBody* rotatedBody = physicsModule->createRigidBody(SCENE_BODY_BOX, rotatedPosition, 
+		glm::vec3(1, 1, 1), glm::vec3(0, 0, 1.57f), 0, 0.5f, 0);
+	rotated->AddComponent<RigidbodyComponent>(physicsModule, rotatedBody);
+
+	// The static body never reaches the sync: its pose is copied once, by the component's creation.
+	const btQuaternion bodyRotation = rotatedBody->getWorldTransform().getRotation();
+	const glm::fquat rotation = rotated->GetTransform()->GetAbsoluteRotationQuaternion();
+	const float rotationError = 1.0f - fabs(glm::dot(rotation, 
+		glm::fquat(bodyRotation.getW(), bodyRotation.getX(), bodyRotation.getY(), bodyRotation.getZ())));
+	TransformHierarchy::Instance().Update();
+
+	// Steps the world as the simulation ticks do, until the sphere falls asleep.
+	float positionError = 0.0f;
+	int sleepStep = -1;
+	Clock::time_point begin = Clock::now();
+	for (int step = 0; step < nSteps && sleepStep < 0; step++)
+	{
+		physicsModule->dynamicsWorld->stepSimulation(1.0f / 60, 0);
+		physicsModule->SyncTransforms();
+		btTransform pose;
+		sphereBody->getMotionState()->getWorldTransform(pose);
+		const btVector3& origin = pose.getOrigin();
+		positionError = std::max(positionError, glm::length(sphere->GetTransform()->GetAbsolutePosition() - 
+			glm::vec3(origin.getX(), origin.getY(), origin.getZ())));
+		TransformHierarchy::Instance().Update();
+		if (!sphereBody->isActive())
+			sleepStep = step;
+	}
+	const double stepTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+	const float fall = spherePosition.y - sphere->GetTransform()->GetAbsolutePosition().y;
+
+	// Once asleep, the sphere is skipped by the sync and its node stays clean.
+	physicsModule->dynamicsWorld->stepSimulation(1.0f / 60, 0);
+	physicsModule->SyncTransforms();
+	const bool sleepingClean = sleepStep >= 0 && !sphere->GetTransform()->IsDirty();
+
+	ground->Destroy();
+	sphere->Destroy();
+	rotated->Destroy();
+	engine->DestroyGameObjects();
+	const bool restored = physicsModule->dynamicsWorld->getNumCollisionObjects() == sceneBodies &&
+		engine->gameObjects.GetCount() == sceneObjects;
+
+	std::cout << "[BENCHMARK] Physics sync: sphere fell " << fall << " m and slept after " << sleepStep + 1 
+		<< " steps (" << stepTime << " ms), max transform error " << positionError << ", static rotation error " 
+		<< rotationError << std::endl;
+	bool passed = ReportCheck("Transforms follow the falling body", positionError < 1e-4f && fall > 3.5f);
+	passed = ReportCheck("Sleeping bodies leave their transforms clean", sleepingClean) && passed;
+	passed = ReportCheck("Static bodies give their rotation at creation", rotationError < 1e-4f) && passed;
+	return ReportCheck("Physics sync leaves the world restored", restored) && passed;
+}
+
+// The values of an object of the arena as it was built in code, before being described in a scene.
+struct ArenaObject
+{
+	const char* name;
+	glm::vec3 position, rotation, scale;
+	int bodyShape;
+	glm::vec3 bodyPosition, bodySize;
+	int paintMapSize;
+	glm::vec3 moveDisplacement;
+	float moveSpeed;
+	glm::vec2 repeat;
+	glm::vec3 lightPosition;
+};
+
+static const ArenaObject arenaObjects[] =
+{
+	{ "Floor", glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec3(10, 0.01f, 10), SCENE_BODY_PLANE, 
+		glm::vec3(0, -0.01f, 0), glm::vec3(10, 0.01f, 10), 1024, glm::vec3(0, 0, 0), 0, glm::vec2(50, 50), glm::vec3(0, 5, 5) },
+	{ "Wall1", glm::vec3(0, 5, 9), glm::vec3(0, 0, 0), glm::vec3(10, 5, 1), SCENE_BODY_BOX, 
+		glm::vec3(0, 5, 9), glm::vec3(10, 5, 1), 600, glm::vec3(0, 0, 0), 0, glm::vec2(50, 50), glm::vec3(0, 5, 5) },
+	{ "Wall2", glm::vec3(-9, 5, 0), glm::vec3(0, 0, 0), glm::vec3(1, 5, 10), SCENE_BODY_BOX, 
+		glm::vec3(-9, 5, 0), glm::vec3(1, 5, 10), 600, glm::vec3(0, 0, 0), 0, glm::vec2(50, 50), glm::vec3(0, 5, 5) },
+	{ "Wall3", glm::vec3(9, 5, 0), glm::vec3(0, 0, 0), glm::vec3(1, 5, 10), SCENE_BODY_BOX, 
+		glm::vec3(9, 5, 0), glm::vec3(1, 5, 10), 600, glm::vec3(0, 0, 0), 0, glm::vec2(50, 50), glm::vec3(0, 5, 5) },
+	{ "Wall4", glm::vec3(0, 5, -9), glm::vec3(0, 0, 3.14f / 2.0f), glm::vec3(5, 9, 1), SCENE_BODY_BOX, 
+		glm::vec3(0, 5, -9), glm::vec3(5, 9, 1), 600, glm::vec3(0, 0, 0), 0, glm::vec2(50, 50), glm::vec3(0, 5, 5) },
+	{ "Sphere", glm::vec3(-4, 1.5f, -6), glm::vec3(0, 0, 0), glm::vec3(2, 2, 2), SCENE_BODY_SPHERE, 
+		glm::vec3(-4, 1.5f, -6), glm::vec3(2, 2, 2), 256, glm::vec3(0, 0, 4), 0.25f, glm::vec2(10, 10), glm::vec3(0, 5, -5) },
+	{ "Tower", glm::vec3(0, 4.5f, -6), glm::vec3(0, 0, 0), glm::vec3(2, 10, 2), SCENE_BODY_CYLINDER, 
+		glm::vec3(0, 4.5f, -6), glm::vec3(2, 10, 2), 256, glm::vec3(0, 0, 0), 0, glm::vec2(5, 20), glm::vec3(0, 5, 5) },
+	{ "Box1", glm::vec3(5, 1, 5), glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), SCENE_BODY_BOX, 
+		glm::vec3(5, 1, 5), glm::vec3(1, 1, 1), 150, glm::vec3(0, 0, 0), 0, glm::vec2(3, 3), glm::vec3(0, 5, 5) },
+	{ "Box2", glm::vec3(5, 3, 6), glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), SCENE_BODY_BOX, 
+		glm::vec3(5, 3, 6), glm::vec3(1, 1, 1), 150, glm::vec3(0, 0, 0), 0, glm::vec2(3, 3), glm::vec3(0, 5, 5) },
+	{ "Box3", glm::vec3(5, 1, 7), glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), SCENE_BODY_BOX, 
+		glm::vec3(5, 1, 7), glm::vec3(1, 1, 1), 150, glm::vec3(0, 0, 0), 0, glm::vec2(3, 3), glm::vec3(0, 5, 5) },
+	{ "Up", glm::vec3(0, 10, 0), glm::vec3(0, 0, 0), glm::vec3(10, 0.01f, 10), SCENE_BODY_BOX, 
+		glm::vec3(0, 10, 0), glm::vec3(20, 0.5f, 20), 800, glm::vec3(0, 0, 0), 0, glm::vec2(50, 50), glm::vec3(0, 5, 5) },
+	{ "Bunny", glm::vec3(4, 1.5f, -6), glm::vec3(0, 0, 0), glm::vec3(0.5f, 0.5f, 0.5f), SCENE_BODY_BOX, 
+		glm::vec3(4, 1.5f, -6), glm::vec3(2.5f, 1.5f, 1), 200, glm::vec3(0, 0, 0), 0, glm::vec2(10, 10), glm::vec3(0, 5, 5) },
+};
+
+// Returns the largest difference between the components of the vectors.
+static float MaxDifference(glm::vec3 a, glm::vec3 b)
+{
+	const glm::vec3 difference = glm::abs(a - b);
+	return std::max(difference.x, std::max(difference.y, difference.z));
+}
+
+bool BenchmarkScene(int nExtraObjects)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	std::ifstream file(SCENE_DEFAULT_PATH, std::ios::binary);
+	const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// The arena matches the values it was built with in code, the bodies static and the rotations
+	// in radians.
+	SceneDescription arena;
+	const int nArenaObjects = sizeof(arenaObjects) / sizeof(arenaObjects[0]);
+	bool matches = !text.empty() && arena.Parse(text) && (int)arena.objects.size() == nArenaObjects;
+	float error = 0.0f;
+	for (int i = 0; matches && i < nArenaObjects; i++)
+	{
+		const ArenaObject& expected = arenaObjects[i];
+		const SceneObjectRecord& object = arena.objects[i];
+		const SceneMaterialRecord& material = arena.materials[object.material];
+		matches = strcmp(arena.strings.c_str() + object.name, expected.name) == 0 && 
+			object.bodyShape == expected.bodyShape && object.paintMapSize == expected.paintMapSize &&
+			object.mass == 0.0f && object.friction == 0.3f && object.restitution == 0.3f;
+		error = std::max(error, std::max(MaxDifference(object.position, expected.position), 
+			MaxDifference(object.rotation, expected.rotation)));
+		error = std::max(error, std::max(MaxDifference(object.scale, expected.scale), 
+			MaxDifference(object.bodyPosition, expected.bodyPosition)));
+		error = std::max(error, std::max(MaxDifference(object.bodyRotation, expected.rotation), 
+			MaxDifference(object.bodySize, expected.bodySize)));
+		error = std::max(error, std::max(MaxDifference(object.moveDisplacement, expected.moveDisplacement), 
+			std::abs(object.moveSpeed - expected.moveSpeed)));
+		error = std::max(error, std::max(MaxDifference(glm::vec3(material.repeat, 0), glm::vec3(expected.repeat, 0)), 
+			MaxDifference(material.lightPosition, expected.lightPosition)));
+	}
+	matches = matches && error < 1e-5f;
+
+	// The objects are the last array of the compiled scene, stored as parsed.
+	std::vector<unsigned char> blob;
+	arena.Compile(0, blob);
+	const size_t objectBytes = arena.objects.size() * sizeof(SceneObjectRecord);
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	const bool roundTrip = Scene::Validate(&blob[0], blob.size(), maxTextureSize) && blob.size() >= objectBytes &&
+		memcmp(&blob[blob.size() - objectBytes], &arena.objects[0], objectBytes) == 0;
+
+	// The corrupted values and the truncated files are rejected, as are the malformed lines and the
+	// names declared twice.
+	SceneObjectRecord& last = *reinterpret_cast<SceneObjectRecord*>(&blob[blob.size() - sizeof(SceneObjectRecord)]);
+	bool rejected = !Scene::Validate(&blob[0], blob.size() - 4, maxTextureSize);
+	const SceneObjectRecord saved = last;
+	last.bodyShape = SCENE_BODY_CYLINDER + 1;
+	rejected = rejected && !Scene::Validate(&blob[0], blob.size(), maxTextureSize);
+	last = saved;
+	last.mass = -1.0f;
+	rejected = rejected && !Scene::Validate(&blob[0], blob.size(), maxTextureSize);
+	last = saved;
+	last.paintMapSize = maxTextureSize + 1;
+	rejected = rejected && !Scene::Validate(&blob[0], blob.size(), maxTextureSize);
+	last = saved;
+	last.model = (GLuint)arena.models.size();
+	rejected = rejected && !Scene::Validate(&blob[0], blob.size(), maxTextureSize);
+	SceneDescription missingValue, unknownCommand, duplicateModel, duplicateMaterial;
+	rejected = rejected && !missingValue.Parse(text + "\tposition 1 2\n") && 
+		!unknownCommand.Parse(text + "\tcolour 1 0 0\n") && !duplicateModel.Parse(text + "model cube Models/Sphere.obj\n") &&
+		!duplicateMaterial.Parse(text + "material wall\n");
+
+	// The arena with a grid of extra boxes, parsed and compiled as by a first load.
+	std::stringstream large;
+	large << text;
+	for (int i = 0; i < nExtraObjects; i++)
+		large << "object Box cube woodBox\n\tposition " << i % 100 - 50 << " 1 " << i / 100 % 100 - 50 
+			<< "\n\tbody box\n\tpaintable 150\n";
+	const std::string largeText = large.str();
+	Clock::time_point begin = Clock::now();
+	SceneDescription largeScene;
+	const bool largeParsed = largeScene.Parse(largeText);
+	largeScene.Compile(0, blob);
+	const double compileTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+	begin = Clock::now();
+	const bool largeValid = largeParsed && Scene::Validate(&blob[0], blob.size(), maxTextureSize);
+	const double validateTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	std::cout << "[BENCHMARK] Scene " << SCENE_DEFAULT_PATH << ": " << arena.objects.size() << " objects, max error " 
+		<< error << " against the arena built in code; " << largeScene.objects.size() << " objects parsed and "
+		<< "compiled in " << compileTime << " ms, " << blob.size() / 1024 << " KB validated in " << validateTime 
+		<< " ms" << std::endl;
+	bool passed = ReportCheck("Scene describes the arena built in code", matches);
+	passed = ReportCheck("Scene compiles to the parsed records", roundTrip) && passed;
+	passed = ReportCheck("Scene rejects corrupted records, truncated files and malformed lines", rejected) && passed;
+	return ReportCheck("Scene validates a large compiled scene", largeValid) && passed;
+}
+
+bool BenchmarkJobSystem(int nJobs, int nNestedJobs, size_t rangeSize)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	JobSystem& jobs = JobSystem::Instance();
+	const unsigned long stolenBefore = jobs.GetStolenJobCount();
+
+	// Each job spawns nested jobs and waits for them, so that the waiting threads run the queues.
+	std::atomic<int> outerRuns(0), nestedRuns(0);
+	JobCounter counter;
+	Clock::time_point begin = Clock::now();
+	for (int i = 0; i < nJobs; i++)
+		jobs.Submit([&jobs, &outerRuns, &nestedRuns, nNestedJobs]()
+		{
+			JobCounter nested;
+			for (int j = 0; j < nNestedJobs; j++)
+				jobs.Submit([&nestedRuns]() { nestedRuns++; }, &nested);
+			jobs.Wait(nested);
+			outerRuns++;
+		}, &counter);
+	jobs.Wait(counter);
+	const double nestedTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+	const bool nestedComplete = outerRuns == nJobs && nestedRuns == nJobs * nNestedJobs;
+
+	// Each index of the range is visited once, by the chunk that contains it.
+	std::vector<unsigned char> visits(rangeSize, 0);
+	std::atomic<unsigned long long> sum(0);
+	begin = Clock::now();
+	jobs.ParallelFor(rangeSize, 1024, [&visits, &sum](size_t first, size_t end)
+	{
+		unsigned long long chunkSum = 0;
+		for (size_t i = first; i < end; i++)
+		{
+			visits[i]++;
+			chunkSum += i;
+		}
+		sum += chunkSum;
+	});
+	const double rangeTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+	bool rangeCovered = sum == (unsigned long long)rangeSize * (rangeSize - 1) / 2;
+	for (size_t i = 0; i < rangeSize; i++)
+		rangeCovered = rangeCovered && visits[i] == 1;
+
+	std::cout << "[BENCHMARK] Job system " << jobs.GetWorkerCount() << " workers: " << nJobs << " jobs with " 
+		<< nNestedJobs << " nested each " << nestedTime << " ms, parallel for over " << rangeSize << " elements " 
+		<< rangeTime << " ms, " << jobs.GetStolenJobCount() - stolenBefore << " jobs stolen" << std::endl;
+	const bool passed = ReportCheck("Job system runs every nested job", nestedComplete);
+	return ReportCheck("Parallel for visits every element once", rangeCovered) && passed;
+}
+
+bool BenchmarkParallelComponentUpdate(RenderingEngine* engine, PhysicsModule* physicsModule, int nObjects,
+	int nFrames)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	const float deltaTime = 1.0f / 60.0f;
+	const int side = (int)ceil(sqrt((double)nObjects));
+	std::vector<glm::vec3> positions[2];
+	double updateTimes[2];
+	int nStages = 0;
+	const unsigned long stolenBefore = JobSystem::Instance().GetStolenJobCount();
+
+	// The same scene is created twice and updated sequentially, then on the job system. Half of
+	// the boxes are also paint balls, which read their rigidbody after it moved.
+	for (int run = 0; run < 2; run++)
+	{
+		std::vector<GameObject*> objects(nObjects);
+		for (int i = 0; i < nObjects; i++)
+		{
+			objects[i] = CreateMovingObject(engine, physicsModule, 
+				glm::vec3((float)(i % side - side / 2), 1.0f, (float)(i / side - side / 2)));
+			if (i % 2 == 0)
+				objects[i]->AddComponent<PaintBallComponent>(physicsModule);
+		}
+		nStages = 0;
+		for (int phase = 0; phase < COMPONENT_PHASE_COUNT; phase++)
+			nStages += engine->components.GetStageCount(phase);
+
+		Clock::time_point begin = Clock::now();
+		for (int frame = 0; frame < nFrames; frame++)
+		{
+			for (int phase = 0; phase < COMPONENT_PHASE_COUNT; phase++)
+			{
+				if (run == 0)
+					engine->components.Update(phase, deltaTime);
+				else
+					engine->components.UpdateParallel(phase, deltaTime);
+			}
+		}
+		updateTimes[run] = std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / nFrames;
+
+		positions[run].resize(nObjects);
+		for (int i = 0; i < nObjects; i++)
+		{
+			positions[run][i] = objects[i]->GetTransform()->GetAbsolutePosition();
+			objects[i]->Destroy();
+		}
+		engine->DestroyGameObjects();
+	}
+
+	// The updates of each object are the same in both runs, so the results must match exactly.
+	bool identical = true;
+	for (int i = 0; i < nObjects; i++)
+		identical = identical && positions[0][i] == positions[1][i];
+
+	std::cout << "[BENCHMARK] Component update " << nObjects << " objects (" << nFrames << " frames, " 
+		<< nStages << " stages, " << JobSystem::Instance().GetWorkerCount() << " workers): sequential " 
+		<< updateTimes[0] << " ms, parallel " << updateTimes[1] << " ms (" << updateTimes[0] / updateTimes[1] 
+		<< "x), " << JobSystem::Instance().GetStolenJobCount() - stolenBefore << " jobs stolen" << std::endl;
+	return ReportCheck("Parallel component update matches the sequential one", identical);
+}
+
+// Composes the reference world matrices from the local poses, parents first.
+static void ComposeReferenceWorlds(const std::vector<int>& parents, const std::vector<glm::vec3>& positions,
+	const std::vector<glm::fquat>& rotations, const std::vector<glm::vec3>& scales, std::vector<glm::mat4>& worlds)
+{
+	for (size_t i = 0; i < parents.size(); i++)
+	{
+		const glm::mat4 local = glm::translate(glm::mat4(), positions[i]) * glm::mat4_cast(rotations[i]) * 
+			glm::scale(glm::mat4(), scales[i]);
+		worlds[i] = parents[i] >= 0 ? worlds[parents[i]] * local : local;
+	}
+}
+
+bool BenchmarkTransformEdits(int nTransforms, int nFrames)
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> offset(-5.0f, 5.0f), angle(-180.0f, 180.0f), scale(0.8f, 1.25f);
+
+	// Each transform is parented to a random earlier one, or is a root.
+	std::vector<Transform*> transforms(nTransforms);
+	std::vector<int> parents(nTransforms);
+	std::vector<glm::vec3> positions(nTransforms), scales(nTransforms);
+	std::vector<glm::fquat> rotations(nTransforms);
+	std::vector<glm::mat4> worlds(nTransforms);
+	for (int i = 0; i < nTransforms; i++)
+	{
+		parents[i] = i == 0 || random() % 4 == 0 ? -1 : (int)(random() % i);
+		positions[i] = glm::vec3(offset(random), offset(random), offset(random));
+		const glm::vec3 eulerAngles(angle(random), angle(random), angle(random));
+		rotations[i] = euler2quat(glm::radians(eulerAngles));
+		scales[i] = glm::vec3(scale(random));
+		transforms[i] = new Transform(positions[i], eulerAngles, scales[i], 
+			parents[i] >= 0 ? transforms[parents[i]] : nullptr);
+	}
+	TransformHierarchy::Instance().Update();
+
+	// Edits a twentieth of the transforms in each frame, half of them in world space. The even
+	// frames are read before the hierarchy update, composing the stale values along the parents.
+	float matrixError = 0.0f, positionError = 0.0f;
+	const int nEdits = std::max(nTransforms / 20, 1);
+	for (int frame = 0; frame < nFrames; frame++)
+	{
+		for (int e = 0; e < nEdits; e++)
+		{
+			const int i = random() % nTransforms;
+			const glm::vec3 position(offset(random), offset(random), offset(random));
+			const glm::fquat rotation = euler2quat(glm::radians(glm::vec3(angle(random), angle(random), angle(random))));
+			if (e % 2 == 0)
+			{
+				transforms[i]->SetLocalPosition(position);
+				transforms[i]->SetLocalRotation(rotation);
+				positions[i] = position;
+				rotations[i] = rotation;
+			}
+			else
+			{
+				ComposeReferenceWorlds(parents, positions, rotations, scales, worlds);
+				transforms[i]->SetAbsolutePosition(position);
+				positions[i] = parents[i] >= 0 ? glm::vec3(glm::inverse(worlds[parents[i]]) * glm::vec4(position, 1.0f)) 
+					: position;
+			}
+		}
+		if (frame % 2 == 1)
+			TransformHierarchy::Instance().Update();
+
+		ComposeReferenceWorlds(parents, positions, rotations, scales, worlds);
+		for (int i = 0; i < nTransforms; i++)
+		{
+			const glm::mat4 world = transforms[i]->GetTransformMatrix();
+			const float magnitude = std::max(glm::length(glm::vec3(worlds[i][3])), 1.0f);
+			for (int column = 0; column < 4; column++)
+				matrixError = std::max(matrixError, glm::length(world[column] - worlds[i][column]) / magnitude);
+			positionError = std::max(positionError, 
+				glm::length(transforms[i]->GetAbsolutePosition() - glm::vec3(worlds[i][3])) / magnitude);
+		}
+	}
+	for (int i = nTransforms - 1; i >= 0; i--)
+		delete transforms[i];
+	TransformHierarchy::Instance().Update();
+
+	std::cout << "[BENCHMARK] Transform edits " << nTransforms << " transforms, " << nFrames << " frames of " 
+		<< nEdits << " local and world edits, read before and after the update: max error " << matrixError 
+		<< " matrix, " << positionError << " position" << std::endl;
+	return ReportCheck("Transforms read before and after the update match the local poses", 
+		matrixError < 1e-4f && positionError < 1e-4f);
+}
+
+bool BenchmarkTransformRemoval(int nNodes, int nRounds)
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> offset(-5.0f, 5.0f), angle(-3.14159f, 3.14159f), 
+		scale(0.8f, 1.25f);
+
+	// The reference keeps the nodes in order of addition, each after its parent, with -1 for
+	// the roots and the removed nodes' former children.
+	TransformHierarchy hierarchy;
+	std::vector<unsigned int> nodes;
+	std::vector<int> parents;
+	std::vector<bool> alive;
+	std::vector<glm::vec3> positions, scales;
+	std::vector<glm::fquat> rotations;
+	auto addNode = [&]()
+	{
+		int parent = -1;
+		if (!nodes.empty() && random() % 4 != 0)
+		{
+			parent = random() % nodes.size();
+			if (!alive[parent])
+				parent = -1;
+		}
+		positions.push_back(glm::vec3(offset(random), offset(random), offset(random)));
+		rotations.push_back(euler2quat(glm::vec3(angle(random), angle(random), angle(random))));
+		scales.push_back(glm::vec3(scale(random)));
+		nodes.push_back(hierarchy.Add(parent >= 0 ? nodes[parent] : TRANSFORM_NO_NODE, 
+			positions.back(), rotations.back(), scales.back()));
+		parents.push_back(parent);
+		alive.push_back(true);
+	};
+	for (int i = 0; i < nNodes; i++)
+		addNode();
+	hierarchy.Update();
+
+	// Removes a tenth of the nodes in each round and adds as many, reusing the freed IDs, then
+	// checks the parents and the world matrices of the nodes alive after the compaction.
+	float matrixError = 0.0f;
+	size_t nAlive = nNodes;
+	bool parentsMatch = true, countsMatch = true;
+	std::vector<glm::mat4> worlds;
+	for (int round = 0; round < nRounds; round++)
+	{
+		for (int i = 0; i < nNodes / 10; i++)
+		{
+			const size_t removed = random() % nodes.size();
+			if (!alive[removed])
+				continue;
+			hierarchy.Remove(nodes[removed]);
+			alive[removed] = false;
+			nAlive--;
+			for (size_t child = removed + 1; child < nodes.size(); child++)
+			{
+				if (parents[child] == (int)removed)
+					parents[child] = -1;
+			}
+		}
+		for (int i = 0; i < nNodes / 10; i++, nAlive++)
+			addNode();
+		hierarchy.Update();
+
+		countsMatch = countsMatch && hierarchy.GetCount() == nAlive;
+		worlds.resize(nodes.size());
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			const glm::mat4 local = glm::translate(glm::mat4(), positions[i]) * glm::mat4_cast(rotations[i]) * 
+				glm::scale(glm::mat4(), scales[i]);
+			worlds[i] = parents[i] >= 0 ? worlds[parents[i]] * local : local;
+			if (!alive[i])
+				continue;
+			const unsigned int parent = hierarchy.GetParent(nodes[i]);
+			parentsMatch = parentsMatch && parent == (parents[i] >= 0 ? nodes[parents[i]] : TRANSFORM_NO_NODE);
+			const glm::mat4 world = hierarchy.GetWorldMatrix(nodes[i]);
+			const float magnitude = std::max(glm::length(glm::vec3(worlds[i][3])), 1.0f);
+			for (int column = 0; column < 4; column++)
+				matrixError = std::max(matrixError, glm::length(world[column] - worlds[i][column]) / magnitude);
+		}
+	}
+
+	// The Euler angles are recovered from the quaternions away from the pitch singularity.
+	float eulerError = 0.0f;
+	std::uniform_real_distribution<float> pitch(-1.5f, 1.5f);
+	for (int i = 0; i < nNodes; i++)
+	{
+		const glm::vec3 euler(angle(random), pitch(random), angle(random));
+		eulerError = std::max(eulerError, glm::length(quat2euler(euler2quat(euler)) - euler));
+	}
+
+	std::cout << "[BENCHMARK] Transform removal " << nNodes << " nodes, " << nRounds << " rounds of " 
+		<< nNodes / 10 << " removed and added: max error " << matrixError << " matrix, " << eulerError 
+		<< " Euler round trip" << std::endl;
+	bool passed = ReportCheck("Compaction keeps the parents, the removed nodes' children as roots", parentsMatch);
+	passed = ReportCheck("Compaction keeps the nodes alive", countsMatch) && passed;
+	passed = ReportCheck("Compaction keeps the world matrices", matrixError < 1e-4f) && passed;
+	return ReportCheck("Euler angles round trip through quaternions", eulerError < 1e-4f) && passed;
+}
+
+// Runs the frames of the given duration, returning the ticks and widening the range of the alphas.
+static int RunFrames(FixedTimestep& clock, float frameTime, int nFrames, float& minAlpha, float& maxAlpha)
+{
+	int ticks = 0;
+	for (int frame = 0; frame < nFrames; frame++)
+	{
+		ticks += clock.Advance(frameTime);
+		minAlpha = std::min(minAlpha, clock.GetAlpha());
+		maxAlpha = std::max(maxAlpha, clock.GetAlpha());
+	}
+	return ticks;
+}
+
+bool BenchmarkFixedTimestep()
+{
+	float minAlpha = 1.0f, maxAlpha = 0.0f;
+
+	// 10 seconds at 60 fps, at both rates, then at 144 fps.
+	FixedTimestep clock60(60), clock120(120), clock144(60);
+	const int ticks60 = RunFrames(clock60, 1.0f / 60, 600, minAlpha, maxAlpha);
+	const int ticks120 = RunFrames(clock120, 1.0f / 60, 600, minAlpha, maxAlpha);
+	const int ticks144 = RunFrames(clock144, 1.0f / 144, 1440, minAlpha, maxAlpha);
+
+	// A hitch of a second runs the most ticks, and the frame after it a single one.
+	FixedTimestep hitchClock(60);
+	RunFrames(hitchClock, 1.0f / 60, 60, minAlpha, maxAlpha);
+	const int hitchTicks = RunFrames(hitchClock, 1.0f, 1, minAlpha, maxAlpha);
+	const int afterHitchTicks = RunFrames(hitchClock, 1.0f / 60, 1, minAlpha, maxAlpha);
+
+	// Frames slightly shorter than a tick run it early, without drifting from the time elapsed.
+	FixedTimestep shortClock(60);
+	const int nShortFrames = 6000;
+	const int shortTicks = RunFrames(shortClock, 0.9995f / 60, nShortFrames, minAlpha, maxAlpha);
+	const int expectedShortTicks = (int)(nShortFrames * 0.9995);
+
+	std::cout << "[BENCHMARK] Fixed timestep: 10 s at 60 fps " << ticks60 << " ticks at 60 Hz, " << ticks120 
+		<< " at 120 Hz, at 144 fps " << ticks144 << " at 60 Hz, 1 s hitch " << hitchTicks << " ticks then " 
+		<< afterHitchTicks << ", " << nShortFrames << " frames of 0.9995 ticks " << shortTicks << " ticks, alpha in [" 
+		<< minAlpha << ", " << maxAlpha << "]" << std::endl;
+	bool passed = ReportCheck("Fixed timestep runs a tick per step of time at any frame and tick rate", 
+		ticks60 == 600 && ticks120 == 1200 && ticks144 == 600);
+	passed = ReportCheck("Fixed timestep bounds the ticks after a hitch", 
+		hitchTicks == FIXED_TIMESTEP_MAX_TICKS && afterHitchTicks == 1) && passed;
+	passed = ReportCheck("Fixed timestep does not drift with frames shorter than a tick", 
+		std::abs(shortTicks - expectedShortTicks) <= 1) && passed;
+	return ReportCheck("Fixed timestep keeps the alphas in [0, 1)", minAlpha >= 0.0f && maxAlpha < 1.0f) && passed;
+}
+
+bool BenchmarkInterpolation(int nNodes)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> offset(-5.0f, 5.0f), angle(-3.14159f, 3.14159f);
+
+	TransformHierarchy hierarchy;
+	std::vector<unsigned int> nodes(nNodes);
+	for (int i = 0; i < nNodes; i++)
+		nodes[i] = hierarchy.Add(TRANSFORM_NO_NODE, glm::vec3(offset(random), offset(random), offset(random)),
+			euler2quat(glm::vec3(angle(random), angle(random), angle(random))), glm::vec3(1, 1, 1));
+	hierarchy.Update();
+	hierarchy.StorePreviousPoses();
+
+	// Moves one node out of a hundred in two ticks: the poses of the first are the previous ones.
+	const int movedStride = 100;
+	auto moveNodes = [&]()
+	{
+		for (int i = 0; i < nNodes; i += movedStride)
+		{
+			hierarchy.SetLocalPosition(nodes[i], glm::vec3(offset(random), offset(random), offset(random)));
+			hierarchy.SetLocalRotation(nodes[i], euler2quat(glm::vec3(angle(random), angle(random), angle(random))));
+		}
+		hierarchy.Update();
+	};
+	moveNodes();
+	Clock::time_point begin = Clock::now();
+	hierarchy.StorePreviousPoses();
+	const double storeTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+	std::vector<glm::mat4> previous(nNodes);
+	for (int i = 0; i < nNodes; i++)
+		previous[i] = hierarchy.GetWorldMatrix(nodes[i]);
+	moveNodes();
+
+	// The moved nodes are at the previous pose at alpha 0, at the current one at 1, and halfway
+	// at 0.5; the others stay at their pose.
+	float endpointError = 0.0f, midpointError = 0.0f;
+	for (int i = 0; i < nNodes; i++)
+	{
+		const glm::mat4 current = hierarchy.GetWorldMatrix(nodes[i]);
+		const glm::mat4 start = hierarchy.GetInterpolatedMatrix(nodes[i], 0.0f);
+		const glm::mat4 end = hierarchy.GetInterpolatedMatrix(nodes[i], 1.0f);
+		const glm::vec3 middle(hierarchy.GetInterpolatedMatrix(nodes[i], 0.5f)[3]);
+		for (int column = 0; column < 4; column++)
+			endpointError = std::max(endpointError, std::max(glm::length(start[column] - previous[i][column]),
+				glm::length(end[column] - current[column])));
+		midpointError = std::max(midpointError, glm::length(middle - 
+			0.5f * (glm::vec3(previous[i][3]) + glm::vec3(current[3]))));
+	}
+
+	// Storing the poses after moving every node, for comparison.
+	for (int i = 0; i < nNodes; i++)
+		hierarchy.SetLocalPosition(nodes[i], glm::vec3(offset(random), offset(random), offset(random)));
+	hierarchy.Update();
+	begin = Clock::now();
+	hierarchy.StorePreviousPoses();
+	const double storeAllTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	std::cout << "[BENCHMARK] Interpolation " << nNodes << " nodes, " << nNodes / movedStride << " moved: previous "
+		<< "poses stored in " << storeTime << " ms (" << storeAllTime << " ms with all moved), max error " 
+		<< endpointError << " at the ends, " << midpointError << " at the middle" << std::endl;
+	const bool passed = ReportCheck("Interpolation is at the previous and current poses at alpha 0 and 1", 
+		endpointError < 1e-5f);
+	return ReportCheck("Interpolation is halfway at alpha 0.5", midpointError < 1e-5f) && passed;
+}
+
+bool BenchmarkTransformHierarchy(int nNodes, int depth, int nFrames)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> offset(-5.0f, 5.0f), angle(-3.14159f, 3.14159f), 
+		scale(0.8f, 1.25f);
+
+	// The nodes are split evenly among the levels, each one parented to a random node of the
+	// level above. The scales are uniform, so that the world rotations are exact.
+	TransformHierarchy hierarchy;
+	std::vector<unsigned int> nodes(nNodes), parents(nNodes);
+	std::vector<glm::vec3> positions(nNodes), angles(nNodes), scales(nNodes);
+	const int levelSize = nNodes / depth;
+	for (int i = 0; i < nNodes; i++)
+	{
+		const int level = std::min(i / levelSize, depth - 1);
+		parents[i] = level == 0 ? TRANSFORM_NO_NODE : 
+			(level - 1) * levelSize + random() % levelSize;
+		positions[i] = glm::vec3(offset(random), offset(random), offset(random));
+		angles[i] = glm::vec3(angle(random), angle(random), angle(random));
+		scales[i] = glm::vec3(scale(random));
+		nodes[i] = hierarchy.Add(parents[i] != TRANSFORM_NO_NODE ? nodes[parents[i]] : TRANSFORM_NO_NODE, 
+			positions[i], euler2quat(angles[i]), scales[i]);
+	}
+
+	Clock::time_point begin = Clock::now();
+	hierarchy.Update();
+	const double fullTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	// Moves one node out of a hundred in each frame.
+	const int nMoved = std::max(nNodes / 100, 1);
+	size_t nUpdated = 0;
+	begin = Clock::now();
+	for (int frame = 0; frame < nFrames; frame++)
+	{
+		for (int i = 0; i < nMoved; i++)
+		{
+			const int moved = random() % nNodes;
+			positions[moved] = glm::vec3(offset(random), offset(random), offset(random));
+			angles[moved] = glm::vec3(angle(random), angle(random), angle(random));
+			hierarchy.SetLocalPosition(nodes[moved], positions[moved]);
+			hierarchy.SetLocalRotation(nodes[moved], euler2quat(angles[moved]));
+		}
+		hierarchy.Update();
+		nUpdated += hierarchy.GetUpdatedCount();
+	}
+	const double partialTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / nFrames;
+
+	// The reference composes the rotations about each axis as matrices, node by node.
+	std::vector<glm::mat4> worlds(nNodes), rotations(nNodes);
+	begin = Clock::now();
+	for (int i = 0; i < nNodes; i++)
+	{
+		glm::mat4 rotation = glm::rotate(glm::mat4(), angles[i].z, glm::vec3(0, 0, 1)) *
+			glm::rotate(glm::mat4(), angles[i].y, glm::vec3(0, 1, 0)) *
+			glm::rotate(glm::mat4(), angles[i].x, glm::vec3(1, 0, 0));
+		glm::mat4 local = glm::translate(glm::mat4(), positions[i]) * rotation * glm::scale(glm::mat4(), scales[i]);
+		worlds[i] = parents[i] != TRANSFORM_NO_NODE ? worlds[parents[i]] * local : local;
+		rotations[i] = parents[i] != TRANSFORM_NO_NODE ? rotations[parents[i]] * rotation : rotation;
+	}
+	const double referenceTime = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	// The error is relative to the magnitude of the translations, which grows with the depth.
+	float matrixError = 0.0f, rotationError = 0.0f;
+	for (int i = 0; i < nNodes; i++)
+	{
+		const glm::mat4 world = hierarchy.GetWorldMatrix(nodes[i]);
+		const glm::mat4 rotation = glm::mat4_cast(hierarchy.GetWorldRotation(nodes[i]));
+		const float magnitude = std::max(glm::length(glm::vec3(worlds[i][3])), 1.0f);
+		for (int column = 0; column < 4; column++)
+		{
+			matrixError = std::max(matrixError, glm::length(world[column] - worlds[i][column]) / magnitude);
+			rotationError = std::max(rotationError, glm::length(rotation[column] - rotations[i][column]));
+		}
+	}
+
+	std::cout << "[BENCHMARK] Transform hierarchy " << nNodes << " nodes, depth " << depth << ": full update " 
+		<< fullTime << " ms (reference " << referenceTime << " ms), " << nMoved << " moved per frame " 
+		<< partialTime << " ms (" << nUpdated / nFrames << " nodes recomputed), max error " << matrixError 
+		<< " matrix, " << rotationError << " rotation" << std::endl;
+	return ReportCheck("Transform hierarchy matches the per-node recomputation", 
+		matrixError < 1e-4f && rotationError < 1e-4f);
+}
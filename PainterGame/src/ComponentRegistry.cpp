@@ -0,0 +1,139 @@
+#include "ComponentRegistry.hpp"
+
+#include "JobSystem.hpp"
+
+// The order the component types are updated in.
+static const unsigned int updateOrder[COMPONENT_TYPE_COUNT] = { RIGIDBODY_COMPONENT,
+	SELFMOVING_COMPONENT, PAINT_BALL_COMPONENT, PAINTABLE_COMPONENT };
+
+ComponentRegistry::ComponentRegistry()
+{
+	for (int i = 0; i < COMPONENT_TYPE_COUNT; i++)
+	{
+		pools[i] = NULL;
+		phases[i] = reads[i] = writes[i] = 0;
+	}
+	for (int phase = 0; phase < COMPONENT_PHASE_COUNT; phase++)
+		phaseTypeCounts[phase] = stageCounts[phase] = 0;
+}
+
+ComponentRegistry::~ComponentRegistry()
+{
+	for (int i = 0; i < COMPONENT_TYPE_COUNT; i++)
+		delete pools[i];
+}
+
+AComponent* ComponentRegistry::Get(unsigned long entity, unsigned int typeId)
+{
+	if (typeId >= COMPONENT_TYPE_COUNT || pools[typeId] == NULL)
+		return NULL;
+	return pools[typeId]->Get(entity);
+}
+
+size_t ComponentRegistry::RemoveAll(unsigned long entity)
+{
+	size_t bytes = 0;
+	for (int i = 0; i < COMPONENT_TYPE_COUNT; i++)
+		if (pools[i] != NULL && pools[i]->Remove(entity))
+			bytes += pools[i]->GetComponentSize();
+	return bytes;
+}
+
+void ComponentRegistry::Update(int phase, float deltaTime)
+{
+	for (int i = 0; i < phaseTypeCounts[phase]; i++)
+	{
+		AComponentPool* pool = pools[phaseTypes[phase][i]];
+		pool->Update(phase, deltaTime, 0, pool->GetSlotCount());
+	}
+}
+
+void ComponentRegistry::UpdateParallel(int phase, float deltaTime)
+{
+	JobSystem& jobs = JobSystem::Instance();
+	for (int stage = 0; stage < stageCounts[phase]; stage++)
+	{
+		// The slots of all the types of the stage form a single range, split in chunks.
+		AComponentPool* stagePools[COMPONENT_TYPE_COUNT];
+		size_t firstSlots[COMPONENT_TYPE_COUNT + 1];
+		int nPools = 0;
+		firstSlots[0] = 0;
+		for (int i = 0; i < phaseTypeCounts[phase]; i++)
+		{
+			const unsigned int type = phaseTypes[phase][i];
+			if (stages[phase][type] != stage)
+				continue;
+			stagePools[nPools] = pools[type];
+			firstSlots[nPools + 1] = firstSlots[nPools] + pools[type]->GetSlotCount();
+			nPools++;
+		}
+
+		jobs.ParallelFor(firstSlots[nPools], COMPONENT_UPDATE_CHUNK, 
+			[&stagePools, &firstSlots, nPools, phase, deltaTime](size_t begin, size_t end)
+		{
+			for (int p = 0; p < nPools; p++)
+				if (begin < firstSlots[p + 1] && end > firstSlots[p])
+					stagePools[p]->Update(phase, deltaTime, (begin > firstSlots[p] ? begin : firstSlots[p]) - firstSlots[p],
+						(end < firstSlots[p + 1] ? end : firstSlots[p + 1]) - firstSlots[p]);
+		});
+	}
+}
+
+int ComponentRegistry::GetStageCount(int phase) const { return stageCounts[phase]; }
+
+void ComponentRegistry::BuildUpdateGraph()
+{
+	for (int phase = 0; phase < COMPONENT_PHASE_COUNT; phase++)
+	{
+		phaseTypeCounts[phase] = stageCounts[phase] = 0;
+		for (int i = 0; i < COMPONENT_TYPE_COUNT; i++)
+		{
+			const unsigned int type = updateOrder[i];
+			if (pools[type] == NULL || (phases[type] & COMPONENT_PHASE(phase)) == 0)
+				continue;
+			stages[phase][type] = 0;
+			for (int j = 0; j < phaseTypeCounts[phase]; j++)
+			{
+				const unsigned int earlier = phaseTypes[phase][j];
+				bool conflict = (writes[earlier] & (reads[type] | writes[type])) != 0 || 
+					(reads[earlier] & writes[type]) != 0;
+				if (conflict && stages[phase][earlier] + 1 > stages[phase][type])
+					stages[phase][type] = stages[phase][earlier] + 1;
+			}
+			if (stages[phase][type] + 1 > stageCounts[phase])
+				stageCounts[phase] = stages[phase][type] + 1;
+			phaseTypes[phase][phaseTypeCounts[phase]++] = type;
+		}
+	}
+}
+
+void ComponentRegistry::UpdateEntity(unsigned long entity, int phase, float deltaTime)
+{
+	for (int i = 0; i < phaseTypeCounts[phase]; i++)
+	{
+		AComponent* component = pools[phaseTypes[phase][i]]->Get(entity);
+		if (component == NULL)
+			continue;
+		if (phase == COMPONENT_FIXED_STEP)
+			component->OnFixedUpdate(deltaTime);
+		else if (phase == COMPONENT_VARIABLE_STEP)
+			component->OnUpdate(deltaTime);
+		else if (phase == COMPONENT_POST_PHYSICS)
+			component->OnPostPhysics(deltaTime);
+	}
+}
+
+void ComponentRegistry::Collide(unsigned long entity, GameObject* other, glm::vec3 hitPoint)
+{
+	for (int i = 0; i < phaseTypeCounts[COMPONENT_COLLISION]; i++)
+	{
+		AComponent* component = pools[phaseTypes[COMPONENT_COLLISION][i]]->Get(entity);
+		if (component != NULL)
+			component->OnCollision(other, hitPoint);
+	}
+}
+
+size_t ComponentRegistry::GetCount(unsigned int typeId)
+{
+	return typeId < COMPONENT_TYPE_COUNT && pools[typeId] != NULL ? pools[typeId]->GetCount() : 0;
+}
@@ -0,0 +1,47 @@
+#include "FixedTimestep.hpp"
+
+#include <cmath>
+
+// The frame times are rounded, so a frame slightly shorter than a tick still runs it: the time
+// it lacks is taken from the next frame.
+#define FIXED_TIMESTEP_TOLERANCE 1e-3
+
+FixedTimestep::FixedTimestep(int rate)
+{
+	SetRate(rate);
+}
+
+void FixedTimestep::SetRate(int rate)
+{
+	this->rate = rate > 0 ? rate : FIXED_TIMESTEP_DEFAULT_RATE;
+	step = 1.0 / this->rate;
+}
+
+int FixedTimestep::GetRate() const { return rate; }
+
+float FixedTimestep::GetStep() const { return (float)step; }
+
+int FixedTimestep::Advance(float deltaTime)
+{
+	accumulator += deltaTime > 0.0f ? deltaTime : 0.0f;
+	int ticks = 0;
+	while (accumulator >= step * (1.0 - FIXED_TIMESTEP_TOLERANCE) && ticks < FIXED_TIMESTEP_MAX_TICKS)
+	{
+		accumulator -= step;
+		ticks++;
+	}
+	// Drops the whole ticks the simulation cannot catch up with.
+	if (ticks == FIXED_TIMESTEP_MAX_TICKS && accumulator >= step)
+		accumulator = std::fmod(accumulator, step);
+	tickCount += ticks;
+	return ticks;
+}
+
+float FixedTimestep::GetAlpha() const
+{
+	// The accumulator is slightly negative after a tick run early.
+	const double alpha = accumulator / step;
+	return (float)(alpha < 0.0 ? 0.0 : alpha < 1.0 ? alpha : 1.0);
+}
+
+unsigned long FixedTimestep::GetTickCount() const { return tickCount; }
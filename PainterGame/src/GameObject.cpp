@@ -10,7 +10,6 @@ GameObject::GameObject(unsigned long id, const std::string& name, Transform* tra
 	this->transform = transform;
 	this->model = model;
 	this->material = material;
-	this->firstComponent = NULL;
 }
 
 GameObject::GameObject(unsigned long id, const std::string& name, glm::vec3 position, glm::vec3 rotation, 
@@ -21,20 +20,13 @@ GameObject::GameObject(unsigned long id, const std::string& name, glm::vec3 posi
 	this->transform = new Transform(position, rotation, scale, NULL);
 	this->model = model; 
 	this->material = material;
-	this->firstComponent = NULL;
 }
 
 GameObject::~GameObject()
 {
 	delete this->transform;
-	AComponent* currentComponent = firstComponent;
-	AComponent* nextComponent;
-	while (currentComponent != NULL)
-	{
-		nextComponent = currentComponent->nextComponent;
-		delete currentComponent;
-		currentComponent = nextComponent;
-	}
+	if (components != NULL)
+		components->RemoveAll(goId);
 }
 
 const std::string GameObject::GetName() { return this->name; }
@@ -45,40 +37,30 @@ Material* GameObject::GetMaterial() { return this->material; }
 void GameObject::SetEngine(RenderingEngine* engine)
 {
 	this->engine = engine;
+	this->components = &engine->components;
 }
 
-AComponent* GameObject::GetComponent(unsigned int componentId)
-{
-	for (AComponent* current = firstComponent; current != NULL; current = current->nextComponent)
-		if (current->GetID() == componentId)
-			return current;
-	return NULL;
-}
+RenderingEngine* GameObject::GetEngine() { return engine; }
+
+unsigned long GameObject::GetId() { return goId; }
 
-void GameObject::AddComponent(AComponent* newComponent)
+GameObjectHandle GameObject::GetHandle() { return handle; }
+
+GameObjectPool* GameObject::GetPool() { return pool; }
+
+AComponent* GameObject::GetComponent(unsigned int componentId)
 {
-	if (firstComponent == nullptr)
-		firstComponent = newComponent;
-	else
-	{
-		AComponent* current;
-		for (current = firstComponent; current->nextComponent != NULL; current = current->nextComponent);
-		current->nextComponent = newComponent;
-	}
-	newComponent->SetGameObject(this);
-	newComponent->OnCreate();
+	return components != NULL ? components->Get(goId, componentId) : NULL;
 }
 
-void GameObject::UpdateComponents(float deltaTime)
+void GameObject::UpdateComponents(int phase, float deltaTime)
 {
-	for (AComponent* current = firstComponent; current != NULL; current = current->nextComponent)
-		current->OnUpdate(deltaTime);
+	components->UpdateEntity(goId, phase, deltaTime);
 }
 
 void GameObject::EnterCollision(GameObject* other, glm::vec3 hitPoint)
 {
-	for (AComponent* current = firstComponent; current != NULL; current = current->nextComponent)
-		current->OnCollision(other, hitPoint);
+	components->Collide(goId, other, hitPoint);
 }
 
 void GameObject::Destroy()
@@ -0,0 +1,84 @@
+#include "GameObjectPool.hpp"
+
+#include <new>
+
+#include "GameObject.hpp"
+
+// Marks the free slots in the positions array.
+#define GAMEOBJECT_NO_POSITION 0xFFFFFFFFu
+
+GameObjectPool::GameObjectPool()
+{
+}
+
+GameObjectPool::~GameObjectPool()
+{
+	for (size_t i = 0; i < objects.size(); i++)
+		objects[i]->~GameObject();
+	for (size_t i = 0; i < blocks.size(); i++)
+		::operator delete(blocks[i]);
+}
+
+GameObject* GameObjectPool::Create(const std::string& name, glm::vec3 position, glm::vec3 rotation,
+	glm::vec3 scale, Model* model, Material* material)
+{
+	unsigned int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = (unsigned int)generations.size();
+		generations.push_back(1);
+		positions.push_back(GAMEOBJECT_NO_POSITION);
+		if (slot % GAMEOBJECT_POOL_BLOCK_SIZE == 0)
+			blocks.push_back(static_cast<GameObject*>(::operator new(sizeof(GameObject) * GAMEOBJECT_POOL_BLOCK_SIZE)));
+	}
+
+	GameObject* object = new (At(slot)) GameObject(slot, name, position, rotation, scale, model, material);
+	object->handle = GameObjectHandle(slot, generations[slot]);
+	object->pool = this;
+	positions[slot] = (unsigned int)objects.size();
+	objects.push_back(object);
+	return object;
+}
+
+GameObject* GameObjectPool::Get(GameObjectHandle handle) const
+{
+	if (handle.index >= generations.size() || generations[handle.index] != handle.generation ||
+		positions[handle.index] == GAMEOBJECT_NO_POSITION)
+		return NULL;
+	return At(handle.index);
+}
+
+void GameObjectPool::Destroy(GameObjectHandle handle)
+{
+	GameObject* object = Get(handle);
+	if (object == NULL)
+		return;
+
+	// The last gameobject takes the place of the destroyed one.
+	const unsigned int position = positions[handle.index];
+	GameObject* last = objects.back();
+	objects[position] = last;
+	positions[last->handle.index] = position;
+	objects.pop_back();
+
+	object->~GameObject();
+	positions[handle.index] = GAMEOBJECT_NO_POSITION;
+	// Generation 0 is reserved to the default handle.
+	if (++generations[handle.index] == 0)
+		generations[handle.index] = 1;
+	freeSlots.push_back(handle.index);
+}
+
+const std::vector<GameObject*>& GameObjectPool::GetObjects() const { return objects; }
+
+size_t GameObjectPool::GetCount() const { return objects.size(); }
+
+GameObject* GameObjectPool::At(size_t slot) const
+{
+	return blocks[slot / GAMEOBJECT_POOL_BLOCK_SIZE] + slot % GAMEOBJECT_POOL_BLOCK_SIZE;
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+
+#include "HeadlessContext.hpp"
+
+#ifdef __linux__
+#include <EGL/eglext.h>
+#endif
+
+#ifdef __linux__
+
+bool HeadlessContext::Create()
+{
+	// Prefers the surfaceless platform, which needs neither a display server nor a GPU.
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay != NULL)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cout << "ERROR::HEADLESS:: cannot initialize the EGL display" << std::endl;
+		return false;
+	}
+	eglBindAPI(EGL_OPENGL_API);
+
+	// The default surface type is a window, which the surfaceless platform does not offer.
+	EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint nConfigs = 0;
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &nConfigs) || nConfigs == 0)
+	{
+		std::cout << "ERROR::HEADLESS:: no EGL configuration supports OpenGL" << std::endl;
+		return false;
+	}
+
+	EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, HEADLESS_GL_MAJOR,
+		EGL_CONTEXT_MINOR_VERSION, HEADLESS_GL_MINOR,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	// Surfaceless: the context is made current without any draw or read surface.
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cout << "ERROR::HEADLESS:: cannot create a surfaceless OpenGL " << HEADLESS_GL_MAJOR 
+			<< "." << HEADLESS_GL_MINOR << " core context" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void HeadlessContext::Destroy()
+{
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != EGL_NO_CONTEXT)
+		eglDestroyContext(display, context);
+	eglTerminate(display);
+}
+
+#else
+
+bool HeadlessContext::Create()
+{
+	if (!glfwInit())
+		return false;
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, HEADLESS_GL_MAJOR);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, HEADLESS_GL_MINOR);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	// The window is never shown: its size does not matter.
+	window = glfwCreateWindow(64, 64, "Paint Game", NULL, NULL);
+	if (!window)
+	{
+		std::cout << "ERROR::HEADLESS:: cannot create the hidden window" << std::endl;
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(window);
+	return true;
+}
+
+void HeadlessContext::Destroy()
+{
+	glfwDestroyWindow(window);
+	glfwTerminate();
+}
+
+#endif
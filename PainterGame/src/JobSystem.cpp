@@ -0,0 +1,159 @@
+#include <algorithm>
+
+#include "JobSystem.hpp"
+
+// The queue of the calling thread: a worker's own, or the shared one for the other threads.
+static thread_local int threadQueue = -1;
+
+JobSystem& JobSystem::Instance()
+{
+	static JobSystem instance;
+	return instance;
+}
+
+JobSystem::JobSystem() : queuedJobs(0), stolenJobs(0)
+{
+	// Leaves a core to the main thread.
+	unsigned int nCores = std::thread::hardware_concurrency();
+	unsigned int nWorkers = std::max(1u, std::min((unsigned int)JOB_MAX_WORKERS, nCores > 1 ? nCores - 1 : 1));
+	for (unsigned int i = 0; i <= nWorkers; i++)
+		queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	for (unsigned int i = 0; i < nWorkers; i++)
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this, (int)i));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		if (workers[i].joinable())
+			workers[i].join();
+}
+
+void JobSystem::Submit(const std::function<void()>& job, JobCounter* counter)
+{
+	if (counter != nullptr)
+		counter->pending++;
+	WorkQueue& queue = *queues[threadQueue >= 0 ? threadQueue : workers.size()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		Job queued;
+		queued.function = job;
+		queued.counter = counter;
+		queue.jobs.push_back(queued);
+	}
+	queuedJobs++;
+	{
+		// Taking the lock orders the notification after the check of a worker going to sleep.
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	jobAvailable.notify_one();
+}
+
+void JobSystem::WorkerLoop(int index)
+{
+	threadQueue = index;
+	while (true)
+	{
+		Job job;
+		if (TakeJob(job))
+		{
+			Run(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		jobAvailable.wait(lock, [this] { return stopping || queuedJobs.load() > 0; });
+		if (stopping)
+			return;
+	}
+}
+
+bool JobSystem::TakeJob(Job& job)
+{
+	if (queuedJobs.load() == 0)
+		return false;
+
+	// The newest job of the own queue, whose data is likely still in the cache.
+	const int self = threadQueue >= 0 ? threadQueue : (int)workers.size();
+	{
+		WorkQueue& queue = *queues[self];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	// The oldest job of another queue, which is likely to spawn more work.
+	const int nQueues = (int)queues.size();
+	for (int i = 1; i < nQueues; i++)
+	{
+		WorkQueue& queue = *queues[(self + i) % nQueues];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = queue.jobs.front();
+			queue.jobs.pop_front();
+			queuedJobs--;
+			stolenJobs++;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool JobSystem::RunPendingJob()
+{
+	Job job;
+	if (!TakeJob(job))
+		return false;
+	Run(job);
+	return true;
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	while (!counter.IsDone())
+		if (!RunPendingJob())
+			std::this_thread::yield();
+}
+
+void JobSystem::ParallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& body)
+{
+	// A few chunks per thread, so that the faster threads can steal from the slower ones.
+	const size_t nThreads = workers.size() + 1;
+	const size_t chunk = std::max(std::max(minChunk, (size_t)1), (count + nThreads * 4 - 1) / (nThreads * 4));
+	if (count <= chunk)
+	{
+		if (count > 0)
+			body(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (size_t begin = chunk; begin < count; begin += chunk)
+	{
+		const size_t end = std::min(begin + chunk, count);
+		Submit([&body, begin, end] { body(begin, end); }, &counter);
+	}
+	body(0, chunk);
+	Wait(counter);
+}
+
+void JobSystem::Run(Job& job)
+{
+	job.function();
+	if (job.counter != nullptr)
+		job.counter->pending--;
+}
+
+int JobSystem::GetWorkerCount() const { return (int)workers.size(); }
+
+unsigned long JobSystem::GetStolenJobCount() const { return stolenJobs.load(); }
@@ -0,0 +1,119 @@
+#include <sstream>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "LightManager.hpp"
+#include "Profiler.hpp"
+
+LightManager::LightManager()
+{
+	std::stringstream defines;
+	defines << "LIGHT_TILE_SIZE=" << LIGHT_TILE_SIZE << " MAX_LIGHTS_PER_TILE=" << MAX_LIGHTS_PER_TILE;
+	cullingShader = new Shader("shaders/light_culling.comp", SHADER_LIGHT_CULLING, defines.str());
+
+	glGenBuffers(1, &lightBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_LIGHTS * sizeof(GpuPointLight), NULL, GL_DYNAMIC_DRAW);
+	glGenBuffers(1, &tileBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	lights.reserve(MAX_LIGHTS);
+	gpuLights.reserve(MAX_LIGHTS);
+}
+
+void LightManager::AddLight(glm::vec3 position, glm::vec3 color, float radius, float lifetime)
+{
+	if (lights.size() >= MAX_LIGHTS)
+		return;
+
+	Light light;
+	light.position = position;
+	light.color = color;
+	light.radius = radius;
+	light.lifetime = lifetime;
+	light.age = 0.0f;
+	lights.push_back(light);
+}
+
+void LightManager::ClearLights()
+{
+	lights.clear();
+}
+
+void LightManager::Update(float deltaTime)
+{
+	size_t i = 0;
+	while (i < lights.size())
+	{
+		lights[i].age += deltaTime;
+		if (lights[i].lifetime > 0.0f && lights[i].age >= lights[i].lifetime)
+		{
+			// The order of the lights does not matter: swaps with the last one.
+			lights[i] = lights.back();
+			lights.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+size_t LightManager::GetLightCount() { return lights.size(); }
+
+int LightManager::GetTileCountX() { return tileCountX; }
+
+void LightManager::CullLights(GLuint depthTexture, const glm::mat4& view, const glm::mat4& projection,
+	int width, int height)
+{
+	ScopedGpuTimer timer("Light culling");
+
+	// Lights are uploaded in view coordinates, the space the fragments are lit in.
+	gpuLights.resize(lights.size());
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const Light& light = lights[i];
+		// Temporary lights fade out linearly.
+		float intensity = light.lifetime > 0.0f ? 1.0f - light.age / light.lifetime : 1.0f;
+		gpuLights[i].positionRadius = glm::vec4(glm::vec3(view * glm::vec4(light.position, 1.0f)), light.radius);
+		gpuLights[i].color = glm::vec4(light.color * intensity, 1.0f);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer);
+	if (!gpuLights.empty())
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpuLights.size() * sizeof(GpuPointLight), &gpuLights[0]);
+
+	// Each tile stores its light count followed by the indices of its lights.
+	tileCountX = (width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	int tileCountY = (height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	size_t nTiles = (size_t)tileCountX * tileCountY;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, tileBuffer);
+	if (nTiles > tileCapacity)
+	{
+		tileCapacity = nTiles;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, tileCapacity * (MAX_LIGHTS_PER_TILE + 1) * sizeof(GLuint),
+			NULL, GL_DYNAMIC_COPY);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BUFFER_BINDING, lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TILE_BUFFER_BINDING, tileBuffer);
+
+	cullingShader->Use();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glUniform1i(glGetUniformLocation(cullingShader->program, "depthMap"), 0);
+	glUniformMatrix4fv(glGetUniformLocation(cullingShader->program, "inverseProjection"), 1, GL_FALSE,
+		glm::value_ptr(glm::inverse(projection)));
+	glUniform1i(glGetUniformLocation(cullingShader->program, "lightCount"), (GLint)lights.size());
+	glUniform2i(glGetUniformLocation(cullingShader->program, "viewportSize"), width, height);
+	glDispatchCompute(tileCountX, tileCountY, 1);
+
+	// The lit pass reads the tile lists.
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void LightManager::Delete()
+{
+	glDeleteBuffers(1, &lightBuffer);
+	glDeleteBuffers(1, &tileBuffer);
+	cullingShader->Delete();
+	delete cullingShader;
+}
@@ -8,6 +8,7 @@
 Material::Material(Shader *shader)
 {
 	this->shader = shader;
+	this->activeShader = shader;
 
 	// Adds default uniforms.
 	this->AddUniform("projectionMatrix");
@@ -16,6 +17,12 @@ Material::Material(Shader *shader)
 	this->AddUniform("normalMatrix");
 }
 
+Shader* Material::SelectVariant(ShaderSet* shaderSet, unsigned int extraFeatures)
+{
+	activeShader = shaderSet->GetVariant(shader->id, shaderParams->GetFeatures() | extraFeatures);
+	return activeShader;
+}
+
 void Material::AddUniform(char *name)
 {
 	GLint uniformLocation = glGetUniformLocation(shader->program, name);
@@ -24,43 +31,43 @@ void Material::AddUniform(char *name)
 
 inline void Material::LoadUniform(char* uniformName, GLfloat parameter)
 {
-	GLint location = glGetUniformLocation(shader->program, uniformName);
+	GLint location = glGetUniformLocation(activeShader->program, uniformName);
 	glUniform1f(location, parameter);
 }
 
 inline void Material::LoadUniform(char* uniformName, GLint parameter)
 {
-	GLint location = glGetUniformLocation(shader->program, uniformName);
+	GLint location = glGetUniformLocation(activeShader->program, uniformName);
 	glUniform1i(location, parameter);
 }
 
 inline void Material::LoadUniform(char* uniformName, GLuint parameter)
 {
-	GLint location = glGetUniformLocation(shader->program, uniformName);
+	GLint location = glGetUniformLocation(activeShader->program, uniformName);
 	glUniform1ui(location, parameter);
 }
 
 inline void Material::LoadUniform(char* uniformName, glm::vec2 parameter)
 {
-	glUniform2fv(glGetUniformLocation(shader->program, uniformName), 1,
+	glUniform2fv(glGetUniformLocation(activeShader->program, uniformName), 1,
 		glm::value_ptr(parameter));
 }
 
 inline void Material::LoadUniform(char* uniformName, glm::vec3 parameter)
 {
-	GLint location = glGetUniformLocation(shader->program, uniformName);
+	GLint location = glGetUniformLocation(activeShader->program, uniformName);
 	glUniform3fv(location, 1, glm::value_ptr(parameter));
 }
 
 void Material::LoadUniform(char* uniformName, glm::mat3 parameter)
 {
-	GLint location = glGetUniformLocation(shader->program, uniformName);
+	GLint location = glGetUniformLocation(activeShader->program, uniformName);
 	glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(parameter));
 }
 
 void Material::LoadUniform(char* uniformName, glm::mat4 parameter)
 {
-	GLint location = glGetUniformLocation(shader->program, uniformName);
+	GLint location = glGetUniformLocation(activeShader->program, uniformName);
 	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(parameter));
 }
 
@@ -95,6 +102,10 @@ void PaintableLambertianTexturingShaderParamSet::LoadUniforms(Material* material
 
 void PaintableShaderParamSet::LoadUniforms(Material* material)
 {
+	// Non-paintable variants have no paint uniforms.
+	if (isPaintable <= 0.0f)
+		return;
+
 	glActiveTexture(GL_TEXTURE10);
 	glBindTexture(GL_TEXTURE_2D, paintMap);
 	material->LoadUniform("paintMap", 10);
@@ -103,26 +114,34 @@ void PaintableShaderParamSet::LoadUniforms(Material* material)
 	glBindTexture(GL_TEXTURE_2D, perlinNoise);
 	material->LoadUniform("perlinNoise", 11);
 
-	material->LoadUniform("isPaintable", isPaintable);
 	material->LoadUniform("paintColor", paintColor);
 }
 
+unsigned int PaintableShaderParamSet::GetFeatures()
+{
+	return isPaintable > 0.0f ? SHADER_FEATURE_PAINTABLE : 0;
+}
+
 void PaintableBlinnPhongTexturingShaderParamSet::LoadUniforms(Material* material)
 {
 	PaintableShaderParamSet::LoadUniforms(material);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, diffuseTexture);
-	material->LoadUniform("tex", 0);
-	
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, normalMap);
-	material->LoadUniform("normalMap", 1);
-
-	material->LoadUniform("usesTexture", diffuseTexture > 0? 1.0f : 0.0f);
-	material->LoadUniform("usesNormalMap", normalMap > 0? 1.0f : 0.0f);
+	if (diffuseTexture > 0)
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, diffuseTexture);
+		material->LoadUniform("tex", 0);
+	}
+	else
+		material->LoadUniform("diffuseColor", diffuseColor);
+
+	if (normalMap > 0)
+	{
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, normalMap);
+		material->LoadUniform("normalMap", 1);
+	}
 
-	material->LoadUniform("diffuseColor", diffuseColor);
 	material->LoadUniform("ambientColor", ambientColor);
 	material->LoadUniform("specularColor", specularColor);
 	material->LoadUniform("repeat", repeat);
@@ -135,6 +154,16 @@ void PaintableBlinnPhongTexturingShaderParamSet::LoadUniforms(Material* material
 	material->LoadUniform("linear", linear);
 	material->LoadUniform("pointLightPosition", pointLightPosition);
 }
+unsigned int PaintableBlinnPhongTexturingShaderParamSet::GetFeatures()
+{
+	unsigned int features = PaintableShaderParamSet::GetFeatures();
+	if (diffuseTexture > 0)
+		features |= SHADER_FEATURE_TEXTURE;
+	if (normalMap > 0)
+		features |= SHADER_FEATURE_NORMAL_MAP;
+	return features;
+}
+
 PaintableBlinnPhongTexturingShaderParamSet PaintableBlinnPhongTexturingShaderParamSet::Clone()
 {
 	PaintableBlinnPhongTexturingShaderParamSet paramSet;
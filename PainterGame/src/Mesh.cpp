@@ -1,14 +1,38 @@
+#include <algorithm>
 #include <sstream>
 
+#include <glm/gtc/packing.hpp>
+
 #include <Mesh.hpp>
 
 using namespace std;
 
-Mesh::Mesh(vector<Vertex> vertices, vector<GLuint> faceIndices, vector<Texture> textures)
+// Describes the whole index buffer as a single level of detail.
+static vector<MeshLod> SingleLod(GLsizei indexCount)
 {
-	this->vertices = vertices;
-	this->faceIndices = faceIndices;
+	MeshLod lod;
+	lod.firstIndex = 0;
+	lod.indexCount = indexCount;
+	lod.error = 0.0f;
+	return vector<MeshLod>(1, lod);
+}
+
+Mesh::Mesh(vector<Vertex> vertices, vector<GLuint> faceIndices, vector<Texture> textures,
+	unsigned int flags, vector<MeshLod> lods)
+{
+	// The arrays are taken over: callers done with them pass them with std::move.
+	this->vertices = std::move(vertices);
+	this->faceIndices = std::move(faceIndices);
 	this->textures = textures;
+	this->indexCount = (GLsizei)this->faceIndices.size();
+	this->lods = lods.empty() ? SingleLod(indexCount) : lods;
+
+	boundsMin = boundsMax = this->vertices.empty() ? glm::vec3(0.0f) : this->vertices[0].position;
+	for (size_t i = 1; i < this->vertices.size(); i++)
+	{
+		boundsMin = glm::min(boundsMin, this->vertices[i].position);
+		boundsMax = glm::max(boundsMax, this->vertices[i].position);
+	}
 
 	// Sets the mesh.
 	// Creates the buffer.
@@ -18,15 +42,85 @@ Mesh::Mesh(vector<Vertex> vertices, vector<GLuint> faceIndices, vector<Texture>
 
 	// Activates the VAO
 	glBindVertexArray(this->VAO);
+	if (flags & MESH_PACK_VERTICES)
+		UploadPackedVertices();
+	else
+		UploadFullVertices();
+	UploadIndices();
+	glBindVertexArray(0);
+
+	// The GPU owns the data from now on.
+	if (!(flags & MESH_KEEP_CPU_DATA))
+	{
+		vector<Vertex>().swap(this->vertices);
+		vector<GLuint>().swap(this->faceIndices);
+	}
+}
+
+Mesh::Mesh(const MeshBuffers& buffers, vector<Texture> textures, unsigned int flags)
+{
+	this->textures = textures;
+	this->indexCount = buffers.indexCount;
+	this->lods = buffers.lods.empty() ? SingleLod(indexCount) : buffers.lods;
+	this->indexType = buffers.indexType;
+	this->boundsMin = buffers.boundsMin;
+	this->boundsMax = buffers.boundsMax;
+	this->vertexBytes = buffers.vertexBytes;
+	const size_t indexBytes = buffers.indexCount * 
+		(buffers.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+	this->gpuBytes = buffers.vertexBytes + indexBytes;
+
+	glGenVertexArrays(1, &this->VAO);
+	glGenBuffers(1, &this->VBO);
+	glGenBuffers(1, &this->EBO);
+
+	glBindVertexArray(this->VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+	glBufferData(GL_ARRAY_BUFFER, buffers.vertexBytes, buffers.vertexData, GL_STATIC_DRAW);
+	if (flags & MESH_PACK_VERTICES)
+		SetPackedAttributes();
+	else
+		SetFullAttributes();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, buffers.indexData, GL_STATIC_DRAW);
+	glBindVertexArray(0);
+}
+
+MeshBuffers Mesh::ReadBuffers(vector<unsigned char>& vertexStorage, vector<unsigned char>& indexStorage) const
+{
+	vertexStorage.resize(vertexBytes);
+	indexStorage.resize(gpuBytes - vertexBytes);
+	// The copy target leaves the VAO's bindings untouched.
+	glBindBuffer(GL_COPY_READ_BUFFER, this->VBO);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, vertexStorage.size(), &vertexStorage[0]);
+	glBindBuffer(GL_COPY_READ_BUFFER, this->EBO);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, indexStorage.size(), &indexStorage[0]);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	MeshBuffers buffers;
+	buffers.vertexData = &vertexStorage[0];
+	buffers.vertexBytes = vertexStorage.size();
+	buffers.indexData = &indexStorage[0];
+	buffers.indexCount = indexCount;
+	buffers.indexType = indexType;
+	buffers.boundsMin = boundsMin;
+	buffers.boundsMax = boundsMax;
+	buffers.lods = lods;
+	return buffers;
+}
+
+void Mesh::UploadFullVertices()
+{
 	// Loads vertices into the VBO.
 	glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
 	glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), 
 		&this->vertices[0], GL_STATIC_DRAW);
-	// Loads data into the EBO.
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->faceIndices.size() * sizeof(GLuint), 
-		&this->faceIndices[0], GL_STATIC_DRAW);
+	gpuBytes = vertexBytes = this->vertices.size() * sizeof(Vertex);
+	SetFullAttributes();
+}
 
+void Mesh::SetFullAttributes()
+{
 	// Sets pointers to the vertices' attributes.
 	// Vertices' positions.
 	glEnableVertexAttribArray(0);
@@ -43,10 +137,78 @@ Mesh::Mesh(vector<Vertex> vertices, vector<GLuint> faceIndices, vector<Texture>
 	// Bitangent
 	glEnableVertexAttribArray(4);
 	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)offsetof(Vertex, bitangent));
+}
 
-	glBindVertexArray(0);
+void Mesh::UploadPackedVertices()
+{
+	const size_t nVertices = this->vertices.size();
+	vector<PackedVertex> packed(nVertices);
+	for (size_t i = 0; i < nVertices; i++)
+	{
+		const Vertex& v = this->vertices[i];
+		PackedVertex& p = packed[i];
+		p.position = v.position;
+		p.normal = glm::packSnorm3x10_1x2(glm::vec4(v.normal, 0.0f));
+		// Handedness of the tangent frame: the bitangent is rebuilt from it.
+		float sign = glm::dot(glm::cross(v.normal, v.tangent), v.bitangent) < 0.0f ? -1.0f : 1.0f;
+		p.tangent = glm::packSnorm3x10_1x2(glm::vec4(v.tangent, sign));
+		p.uv[0] = glm::packHalf1x16(v.uv.x);
+		p.uv[1] = glm::packHalf1x16(v.uv.y);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+	glBufferData(GL_ARRAY_BUFFER, nVertices * sizeof(PackedVertex), &packed[0], GL_STATIC_DRAW);
+	gpuBytes = vertexBytes = nVertices * sizeof(PackedVertex);
+	SetPackedAttributes();
+}
+
+void Mesh::SetPackedAttributes()
+{
+	// Vertices' positions.
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (GLvoid*)0);
+	// Vertices' normals.
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), 
+		(GLvoid*)offsetof(PackedVertex, normal));
+	// Vertices' UVs.
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), 
+		(GLvoid*)offsetof(PackedVertex, uv));
+	// Tangents and bitangents' sign.
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), 
+		(GLvoid*)offsetof(PackedVertex, tangent));
+	// The bitangent is not stored.
+	glDisableVertexAttribArray(4);
+}
+
+void Mesh::UploadIndices()
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+	if (this->vertices.size() <= 0xffff)
+	{
+		vector<GLushort> shortIndices(this->faceIndices.begin(), this->faceIndices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort),
+			&shortIndices[0], GL_STATIC_DRAW);
+		indexType = GL_UNSIGNED_SHORT;
+		gpuBytes += shortIndices.size() * sizeof(GLushort);
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->faceIndices.size() * sizeof(GLuint),
+			&this->faceIndices[0], GL_STATIC_DRAW);
+		indexType = GL_UNSIGNED_INT;
+		gpuBytes += this->faceIndices.size() * sizeof(GLuint);
+	}
 }
 
+GLsizei Mesh::GetIndexCount() const { return lods[0].indexCount; }
+int Mesh::GetLodCount() const { return (int)lods.size(); }
+float Mesh::GetLodError(int lod) const { return lods[std::min(lod, (int)lods.size() - 1)].error; }
+GLenum Mesh::GetIndexType() const { return indexType; }
+size_t Mesh::GetGpuBytes() const { return gpuBytes; }
+
 void Mesh::Delete()
 {
 	// De-allocates the buffer objects.
@@ -55,49 +217,83 @@ void Mesh::Delete()
 	glDeleteBuffers(1, &EBO);
 }
 
-// Rendering command.
-void Mesh::Draw(Shader shader)
+// Resolves the sampler locations of the textures only the first time the mesh is drawn 
+// with a program, so that the names are built and looked up once.
+const TextureBindingTable& Mesh::GetBindingTable(GLuint program)
 {
-	// Bind appropriate textures
+	const size_t nTables = bindingTables.size();
+	for (size_t i = 0; i < nTables; i++)
+		if (bindingTables[i].program == program)
+			return bindingTables[i];
+
+	TextureBindingTable table;
+	table.program = program;
+
 	GLuint diffuseNr = 1;
 	GLuint specularNr = 1;
 	GLuint normalNr = 1;
 	GLuint heightNr = 1;
-	
+
 	const size_t nTextures = textures.size();
+	table.bindings.reserve(nTextures);
 	for (GLuint i = 0; i < nTextures; i++)
 	{
-		glActiveTexture(GL_TEXTURE0 + i); // Active proper texture unit before binding
-											// Retrieve texture number (the N in diffuse_textureN)
+		// Retrieves texture number (the N in diffuse_textureN)
 		stringstream ss;
-		string number;
 		string name = this->textures[i].type;
 		if (name == "texture_diffuse")
-			ss << diffuseNr++; // Transfer GLuint to stream
+			ss << diffuseNr++;
 		else if (name == "texture_specular")
-			ss << specularNr++; // Transfer GLuint to stream
+			ss << specularNr++;
 		else if (name == "texture_normal")
-			ss << normalNr++; // Transfer GLuint to stream
+			ss << normalNr++;
 		else if (name == "texture_height")
-			ss << heightNr++; // Transfer GLuint to stream
-		number = ss.str();
-		// Now set the sampler to the correct texture unit
-		glUniform1i(glGetUniformLocation(shader.program, (name + number).c_str()), i);
-		// And finally bind the texture
-		glBindTexture(GL_TEXTURE_2D, this->textures[i].id);
+			ss << heightNr++;
+
+		TextureBinding binding;
+		binding.location = glGetUniformLocation(program, (name + ss.str()).c_str());
+		binding.unit = i;
+		binding.texture = this->textures[i].id;
+		table.bindings.push_back(binding);
+	}
+
+	bindingTables.push_back(table);
+	return bindingTables.back();
+}
+
+// Rendering command.
+void Mesh::Draw(const Shader& shader, int lod)
+{
+	// Binds the textures to the units resolved for the program. The samplers are part of the
+	// program's state, which other meshes and materials change: they are set on every draw.
+	const TextureBindingTable& table = GetBindingTable(shader.program);
+	const size_t nBindings = table.bindings.size();
+	for (size_t i = 0; i < nBindings; i++)
+	{
+		if (table.bindings[i].location != -1)
+			glUniform1i(table.bindings[i].location, table.bindings[i].unit);
+		glActiveTexture(GL_TEXTURE0 + table.bindings[i].unit);
+		glBindTexture(GL_TEXTURE_2D, table.bindings[i].texture);
 	}
 
+	// Meshes with fewer levels draw their coarsest one.
+	const MeshLod& level = lods[std::min(lod, (int)lods.size() - 1)];
+	const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
 	// Activates VAO
 	glBindVertexArray(this->VAO);
 	// Renders VAO data.
-	glDrawElements(GL_TRIANGLES, (GLsizei)this->faceIndices.size(), GL_UNSIGNED_INT, 0);
+	glDrawElements(GL_TRIANGLES, level.indexCount, indexType, (GLvoid*)(level.firstIndex * indexSize));
 	// De-activates VAO.
 	glBindVertexArray(0);
+}
 
-	// Always good practice to set everything back to defaults once configured.
-	for (GLuint i = 0; i < this->textures.size(); i++)
-	{
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, 0);
-	}
-}
\ No newline at end of file
+void Mesh::DrawInstanced(GLsizei instanceCount, int lod)
+{
+	const MeshLod& level = lods[std::min(lod, (int)lods.size() - 1)];
+	const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	glBindVertexArray(this->VAO);
+	glDrawElementsInstanced(GL_TRIANGLES, level.indexCount, indexType, 
+		(GLvoid*)(level.firstIndex * indexSize), instanceCount);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,197 @@
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "MeshCache.hpp"
+#include "ShaderCache.hpp"
+
+// Tags the cache files, followed by the version, the source hash and the meshes.
+#define MESH_CACHE_MAGIC 0x50474D43
+
+// The data of each mesh starts at a multiple of this.
+#define MESH_CACHE_ALIGNMENT 4
+
+std::string GetMeshCachePath(const std::string& modelPath, unsigned int meshFlags)
+{
+	unsigned long long hash = HashFNV1a(modelPath.data(), modelPath.size());
+	hash = HashFNV1a(&meshFlags, sizeof(meshFlags), hash);
+	std::stringstream path;
+	path << MESH_CACHE_DIRECTORY << "/" << std::hex << hash << ".mesh";
+	return path.str();
+}
+
+// Reads the fields of a mapped file, checking that they lie within it.
+class BlobReader
+{
+public:
+	BlobReader(const unsigned char* data, size_t size) : data(data), size(size), offset(0) {}
+
+	template <typename T> bool Read(T& value)
+	{
+		if (offset + sizeof(T) > size)
+			return false;
+		memcpy(&value, data + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	// Vectors are read by component, as they cannot be copied bytewise.
+	bool Read(glm::vec3& value)
+	{
+		return Read(value.x) && Read(value.y) && Read(value.z);
+	}
+
+	bool ReadString(std::string& value)
+	{
+		GLuint length;
+		if (!Read(length) || offset + length > size)
+			return false;
+		value.assign(reinterpret_cast<const char*>(data + offset), length);
+		offset += length;
+		return true;
+	}
+
+	// Returns a pointer to the next bytes, aligned, without copying them.
+	const unsigned char* Map(size_t bytes)
+	{
+		offset = (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+		if (offset + bytes > size)
+			return nullptr;
+		const unsigned char* mapped = data + offset;
+		offset += bytes;
+		return mapped;
+	}
+
+private:
+	const unsigned char* data;
+	size_t size, offset;
+};
+
+bool ReadMeshCache(MappedFile& file, const std::string& cachePath, unsigned long long sourceHash,
+	std::vector<CachedMesh>& meshes)
+{
+	if (!file.Open(cachePath))
+		return false;
+
+	BlobReader reader(file.GetData(), file.GetSize());
+	GLuint magic, version, nMeshes;
+	unsigned long long hash;
+	if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(hash) || !reader.Read(nMeshes)
+		|| magic != MESH_CACHE_MAGIC || version != MESH_CACHE_VERSION || hash != sourceHash)
+	{
+		file.Close();
+		return false;
+	}
+
+	// The meshes read are dropped if a later one is corrupted.
+	auto Fail = [&file, &meshes]()
+	{
+		meshes.clear();
+		file.Close();
+		return false;
+	};
+	meshes.resize(nMeshes);
+	for (GLuint i = 0; i < nMeshes; i++)
+	{
+		CachedMesh& mesh = meshes[i];
+		GLuint vertexBytes, indexCount, indexType, nLods, nTextures;
+		bool valid = reader.Read(vertexBytes) && reader.Read(indexCount) && reader.Read(indexType)
+			&& (indexType == GL_UNSIGNED_SHORT || indexType == GL_UNSIGNED_INT)
+			&& reader.Read(mesh.buffers.boundsMin) && reader.Read(mesh.buffers.boundsMax)
+			&& reader.Read(nLods);
+		for (GLuint l = 0; valid && l < nLods; l++)
+		{
+			// The range is checked without computing its end, which could overflow.
+			MeshLod lod;
+			valid = reader.Read(lod) && lod.indexCount >= 0 && lod.firstIndex <= indexCount &&
+				(GLuint)lod.indexCount <= indexCount - lod.firstIndex;
+			mesh.buffers.lods.push_back(lod);
+		}
+		valid = valid && reader.Read(nTextures);
+		for (GLuint t = 0; valid && t < nTextures; t++)
+		{
+			std::string type, path;
+			valid = reader.ReadString(type) && reader.ReadString(path);
+			mesh.textureTypes.push_back(type);
+			mesh.texturePaths.push_back(path);
+		}
+		if (!valid)
+			return Fail();
+
+		const size_t indexBytes = indexCount * (indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+		mesh.buffers.vertexBytes = vertexBytes;
+		mesh.buffers.vertexData = reader.Map(vertexBytes);
+		mesh.buffers.indexCount = (GLsizei)indexCount;
+		mesh.buffers.indexType = indexType;
+		mesh.buffers.indexData = reader.Map(indexBytes);
+		if (mesh.buffers.vertexData == nullptr || mesh.buffers.indexData == nullptr)
+			return Fail();
+	}
+	return true;
+}
+
+// Appends a value to the blob.
+template <typename T> static void Append(std::vector<unsigned char>& blob, const T& value)
+{
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+	blob.insert(blob.end(), bytes, bytes + sizeof(T));
+}
+
+static void AppendString(std::vector<unsigned char>& blob, const std::string& value)
+{
+	Append(blob, (GLuint)value.size());
+	blob.insert(blob.end(), value.begin(), value.end());
+}
+
+static void AppendAligned(std::vector<unsigned char>& blob, const void* data, size_t size)
+{
+	blob.resize((blob.size() + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT, 0);
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	blob.insert(blob.end(), bytes, bytes + size);
+}
+
+void WriteMeshCache(const std::string& cachePath, unsigned long long sourceHash,
+	const std::vector<CachedMesh>& meshes)
+{
+	std::vector<unsigned char> blob;
+	Append(blob, (GLuint)MESH_CACHE_MAGIC);
+	Append(blob, (GLuint)MESH_CACHE_VERSION);
+	Append(blob, sourceHash);
+	Append(blob, (GLuint)meshes.size());
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const MeshBuffers& buffers = meshes[i].buffers;
+		Append(blob, (GLuint)buffers.vertexBytes);
+		Append(blob, (GLuint)buffers.indexCount);
+		Append(blob, (GLuint)buffers.indexType);
+		Append(blob, buffers.boundsMin);
+		Append(blob, buffers.boundsMax);
+		Append(blob, (GLuint)buffers.lods.size());
+		for (size_t l = 0; l < buffers.lods.size(); l++)
+			Append(blob, buffers.lods[l]);
+		Append(blob, (GLuint)meshes[i].textureTypes.size());
+		for (size_t t = 0; t < meshes[i].textureTypes.size(); t++)
+		{
+			AppendString(blob, meshes[i].textureTypes[t]);
+			AppendString(blob, meshes[i].texturePaths[t]);
+		}
+		const size_t indexBytes = buffers.indexCount *
+			(buffers.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+		AppendAligned(blob, buffers.vertexData, buffers.vertexBytes);
+		AppendAligned(blob, buffers.indexData, indexBytes);
+	}
+
+#ifdef _WIN32
+	_mkdir(MESH_CACHE_DIRECTORY);
+#else
+	mkdir(MESH_CACHE_DIRECTORY, 0755);
+#endif
+	if (!WriteFileAtomically(cachePath, &blob[0], blob.size()))
+		std::cout << "ERROR::MESH_CACHE:: cannot write " << cachePath << std::endl;
+}
@@ -0,0 +1,543 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshOptimizer.hpp"
+
+// Parameters of Forsyth's vertex scoring function.
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRI_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+
+float ComputeACMR(const std::vector<GLuint>& indices, size_t nVertices, unsigned int cacheSize)
+{
+	if (indices.size() < 3)
+		return 0.0f;
+
+	// Each vertex remembers the miss counter value at which it entered the cache: it is
+	// still in the FIFO as long as fewer than cacheSize misses happened since then.
+	std::vector<long long> entered(nVertices, -(long long)cacheSize - 1);
+	long long misses = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		GLuint v = indices[i];
+		if (misses - entered[v] > (long long)cacheSize)
+		{
+			entered[v] = misses;
+			misses++;
+		}
+	}
+	return (float)misses / (float)(indices.size() / 3);
+}
+
+// Scores a vertex from its position in the LRU cache and its remaining triangles.
+static float ForsythVertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+	// The vertex is not used anymore.
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// Vertices of the last triangle get a fixed score, so that the triangle just
+		// emitted is not too favored by its neighbours.
+		if (cachePosition < 3)
+			score = FORSYTH_LAST_TRI_SCORE;
+		else
+		{
+			const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+		}
+	}
+
+	// Vertices with few triangles left are boosted to get rid of them quickly.
+	score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+	return score;
+}
+
+void OptimizeVertexCache(std::vector<GLuint>& indices, size_t nVertices)
+{
+	const size_t nTriangles = indices.size() / 3;
+	if (nTriangles == 0)
+		return;
+
+	// Builds the vertex-triangle adjacency.
+	std::vector<unsigned int> remaining(nVertices, 0);
+	for (size_t i = 0; i < nTriangles * 3; i++)
+		remaining[indices[i]]++;
+	std::vector<unsigned int> adjacencyOffset(nVertices + 1, 0);
+	for (size_t v = 0; v < nVertices; v++)
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+	std::vector<unsigned int> adjacency(adjacencyOffset[nVertices]);
+	std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t t = 0; t < nTriangles; t++)
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+	// Initial scores.
+	std::vector<float> vertexScore(nVertices);
+	for (size_t v = 0; v < nVertices; v++)
+		vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+	std::vector<float> triangleScore(nTriangles);
+	std::vector<bool> emitted(nTriangles, false);
+	for (size_t t = 0; t < nTriangles; t++)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] 
+			+ vertexScore[indices[t * 3 + 2]];
+
+	// The first triangle is the best scored one.
+	size_t bestTriangle = std::max_element(triangleScore.begin(), triangleScore.end()) 
+		- triangleScore.begin();
+
+	std::vector<GLuint> result;
+	result.reserve(indices.size());
+	std::vector<GLuint> cache, newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+	size_t nextUnemitted = 0;
+
+	for (size_t n = 0; n < nTriangles; n++)
+	{
+		// No candidate in the cache: falls back to the next triangle not yet emitted.
+		if (bestTriangle == (size_t)-1)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = nextUnemitted;
+		}
+
+		// Emits the triangle.
+		emitted[bestTriangle] = true;
+		const GLuint* tri = &indices[bestTriangle * 3];
+		for (int k = 0; k < 3; k++)
+		{
+			result.push_back(tri[k]);
+			// Removes the triangle from the vertex's adjacency.
+			unsigned int begin = adjacencyOffset[tri[k]];
+			unsigned int end = begin + remaining[tri[k]];
+			for (unsigned int a = begin; a < end; a++)
+				if (adjacency[a] == bestTriangle)
+				{
+					std::swap(adjacency[a], adjacency[end - 1]);
+					break;
+				}
+			remaining[tri[k]]--;
+		}
+
+		// Moves the triangle's vertices on top of the LRU cache.
+		newCache.clear();
+		newCache.push_back(tri[0]);
+		newCache.push_back(tri[1]);
+		newCache.push_back(tri[2]);
+		for (size_t c = 0; c < cache.size(); c++)
+			if (cache[c] != tri[0] && cache[c] != tri[1] && cache[c] != tri[2])
+				newCache.push_back(cache[c]);
+		cache.swap(newCache);
+
+		// Updates the scores of the vertices in the cache (and of those just pushed out).
+		for (size_t c = 0; c < cache.size(); c++)
+		{
+			GLuint v = cache[c];
+			int position = c < FORSYTH_CACHE_SIZE ? (int)c : -1;
+			vertexScore[v] = ForsythVertexScore(position, remaining[v]);
+		}
+
+		// Re-scores the triangles touching the cache and picks the best one.
+		bestTriangle = (size_t)-1;
+		float bestScore = -1.0f;
+		for (size_t c = 0; c < cache.size(); c++)
+		{
+			GLuint v = cache[c];
+			unsigned int begin = adjacencyOffset[v];
+			unsigned int end = begin + remaining[v];
+			for (unsigned int a = begin; a < end; a++)
+			{
+				unsigned int t = adjacency[a];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]]
+					+ vertexScore[indices[t * 3 + 2]];
+				triangleScore[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (cache.size() > FORSYTH_CACHE_SIZE)
+			cache.resize(FORSYTH_CACHE_SIZE);
+	}
+
+	indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices,
+	float threshold)
+{
+	const size_t nTriangles = indices.size() / 3;
+	if (nTriangles == 0)
+		return;
+
+	// Hard boundaries: triangles that miss the cache on all of their vertices start a new
+	// cluster, since reordering there does not affect the cache efficiency.
+	std::vector<size_t> clusterStart;
+	const float targetACMR = threshold * ComputeACMR(indices, vertices.size());
+	std::vector<long long> entered(vertices.size(), -ACMR_CACHE_SIZE - 1);
+	long long misses = 0, clusterMisses = 0;
+	size_t clusterTriangles = 0;
+	for (size_t t = 0; t < nTriangles; t++)
+	{
+		int triangleMisses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = indices[t * 3 + k];
+			if (misses - entered[v] > ACMR_CACHE_SIZE)
+			{
+				entered[v] = misses;
+				misses++;
+				triangleMisses++;
+			}
+		}
+
+		// Soft boundaries: a flush only cuts the cluster once the cluster's ACMR got 
+		// close enough to the ideal one.
+		bool cut = triangleMisses == 3 && (clusterTriangles == 0 
+			|| (float)clusterMisses / clusterTriangles <= targetACMR);
+		if (t == 0 || cut)
+		{
+			clusterStart.push_back(t);
+			clusterMisses = 0;
+			clusterTriangles = 0;
+		}
+		clusterMisses += triangleMisses;
+		clusterTriangles++;
+	}
+	clusterStart.push_back(nTriangles);
+
+	// The mesh's centroid.
+	glm::vec3 meshCentroid(0.0f);
+	for (size_t i = 0; i < vertices.size(); i++)
+		meshCentroid += vertices[i].position;
+	meshCentroid /= (float)std::max<size_t>(vertices.size(), 1);
+
+	// Each cluster is sorted by how much it faces outwards: clusters on the outside are
+	// more likely to occlude the others and are drawn first.
+	const size_t nClusters = clusterStart.size() - 1;
+	std::vector<std::pair<float, size_t> > sortKeys(nClusters);
+	for (size_t c = 0; c < nClusters; c++)
+	{
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+		{
+			const glm::vec3& p0 = vertices[indices[t * 3]].position;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+			centroid += p0 + p1 + p2;
+			// Area-weighted normal.
+			normal += glm::cross(p1 - p0, p2 - p0);
+		}
+		centroid /= (float)((clusterStart[c + 1] - clusterStart[c]) * 3);
+		float length = glm::length(normal);
+		if (length > 0.0f)
+			normal /= length;
+		sortKeys[c] = std::make_pair(glm::dot(centroid - meshCentroid, normal), c);
+	}
+	std::stable_sort(sortKeys.begin(), sortKeys.end(),
+		[](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) { return a.first > b.first; });
+
+	std::vector<GLuint> result;
+	result.reserve(indices.size());
+	for (size_t i = 0; i < nClusters; i++)
+	{
+		size_t c = sortKeys[i].second;
+		result.insert(result.end(), indices.begin() + clusterStart[c] * 3, 
+			indices.begin() + clusterStart[c + 1] * 3);
+	}
+	indices.swap(result);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+	const GLuint unused = (GLuint)-1;
+	std::vector<GLuint> remap(vertices.size(), unused);
+	std::vector<Vertex> result;
+	result.reserve(vertices.size());
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		GLuint& index = indices[i];
+		if (remap[index] == unused)
+		{
+			remap[index] = (GLuint)result.size();
+			result.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(result);
+}
+
+// A quadric error: the sum of the squared distances from a set of planes, weighted by the area
+// of the triangles they come from. Stored as the upper triangle of the symmetric 4x4 matrix.
+struct Quadric
+{
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+	// The total weight, to turn the error into an average squared distance.
+	double weight;
+};
+
+static void AddPlane(Quadric& q, const glm::vec3& normal, float d, double weight)
+{
+	const double a = normal.x, b = normal.y, c = normal.z;
+	q.a2 += weight * a * a; q.ab += weight * a * b; q.ac += weight * a * c; q.ad += weight * a * d;
+	q.b2 += weight * b * b; q.bc += weight * b * c; q.bd += weight * b * d;
+	q.c2 += weight * c * c; q.cd += weight * c * d;
+	q.d2 += weight * d * d;
+	q.weight += weight;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other)
+{
+	q.a2 += other.a2; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+	q.b2 += other.b2; q.bc += other.bc; q.bd += other.bd;
+	q.c2 += other.c2; q.cd += other.cd;
+	q.d2 += other.d2;
+	q.weight += other.weight;
+}
+
+// Returns the average squared distance of the point from the planes of the quadric.
+static double EvaluateQuadric(const Quadric& q, const glm::vec3& p)
+{
+	const double x = p.x, y = p.y, z = p.z;
+	double error = q.a2 * x * x + 2 * q.ab * x * y + 2 * q.ac * x * z + 2 * q.ad * x
+		+ q.b2 * y * y + 2 * q.bc * y * z + 2 * q.bd * y
+		+ q.c2 * z * z + 2 * q.cd * z
+		+ q.d2;
+	return q.weight > 0.0 ? fabs(error) / q.weight : 0.0;
+}
+
+// Hashes the bits of a position, to find the vertices sharing it.
+struct PositionHash
+{
+	size_t operator()(const glm::vec3& p) const
+	{
+		unsigned int bits[3];
+		memcpy(bits, &p, sizeof(bits));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+};
+
+struct PositionEqual
+{
+	bool operator()(const glm::vec3& a, const glm::vec3& b) const { return a == b; }
+};
+
+// An edge collapse candidate: the vertex from is moved onto the vertex to.
+struct EdgeCollapse
+{
+	GLuint from, to;
+	double cost;
+};
+
+std::vector<GLuint> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices,
+	size_t targetIndexCount, float& error)
+{
+	const size_t nVertices = vertices.size();
+	std::vector<GLuint> result(indices);
+	error = 0.0f;
+
+	// The vertices sharing their position with others lie on a seam: moving one of them would
+	// tear the surface or stretch the UVs.
+	std::vector<bool> locked(nVertices, false);
+	std::unordered_map<glm::vec3, GLuint, PositionHash, PositionEqual> firstAtPosition;
+	std::vector<GLuint> positionId(nVertices);
+	for (GLuint v = 0; v < nVertices; v++)
+	{
+		std::pair<std::unordered_map<glm::vec3, GLuint, PositionHash, PositionEqual>::iterator, bool> inserted =
+			firstAtPosition.insert(std::make_pair(vertices[v].position, v));
+		positionId[v] = inserted.first->second;
+		if (!inserted.second)
+			locked[v] = locked[inserted.first->second] = true;
+	}
+
+	// The edges used by a single triangle are on the border: their vertices keep the outline.
+	std::unordered_map<unsigned long long, int> edgeUses;
+	for (size_t i = 0; i < result.size(); i += 3)
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned long long a = positionId[result[i + k]], b = positionId[result[i + (k + 1) % 3]];
+			edgeUses[a < b ? (a << 32 | b) : (b << 32 | a)]++;
+		}
+	for (size_t i = 0; i < result.size(); i += 3)
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned long long a = positionId[result[i + k]], b = positionId[result[i + (k + 1) % 3]];
+			if (edgeUses[a < b ? (a << 32 | b) : (b << 32 | a)] == 1)
+				locked[result[i + k]] = locked[result[i + (k + 1) % 3]] = true;
+		}
+
+	// Each vertex starts with the planes of its triangles.
+	std::vector<Quadric> quadrics(nVertices);
+	memset(quadrics.data(), 0, nVertices * sizeof(Quadric));
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const glm::vec3& p0 = vertices[result[i]].position;
+		const glm::vec3& p1 = vertices[result[i + 1]].position;
+		const glm::vec3& p2 = vertices[result[i + 2]].position;
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal);
+		if (area == 0.0f)
+			continue;
+		normal /= area;
+		for (int k = 0; k < 3; k++)
+			AddPlane(quadrics[result[i + k]], normal, -glm::dot(normal, p0), area);
+	}
+
+	// Collapses the cheapest edges in passes, each vertex at most once per pass, until the
+	// target is reached or no edge can be collapsed.
+	double maxCost = 0.0;
+	while (result.size() > targetIndexCount)
+	{
+		const size_t nTriangles = result.size() / 3;
+
+		// The triangles around each vertex.
+		std::vector<unsigned int> adjacencyOffset(nVertices + 1, 0);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacencyOffset[result[i] + 1]++;
+		for (size_t v = 0; v < nVertices; v++)
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		std::vector<unsigned int> adjacency(result.size());
+		std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t t = 0; t < nTriangles; t++)
+			for (int k = 0; k < 3; k++)
+				adjacency[fill[result[t * 3 + k]]++] = (unsigned int)t;
+
+		std::vector<EdgeCollapse> candidates;
+		candidates.reserve(result.size() * 2);
+		for (size_t i = 0; i < result.size(); i += 3)
+			for (int k = 0; k < 3; k++)
+			{
+				GLuint a = result[i + k], b = result[i + (k + 1) % 3];
+				EdgeCollapse collapse;
+				if (!locked[a])
+				{
+					collapse.from = a;
+					collapse.to = b;
+					collapse.cost = EvaluateQuadric(quadrics[a], vertices[b].position);
+					candidates.push_back(collapse);
+				}
+				if (!locked[b])
+				{
+					collapse.from = b;
+					collapse.to = a;
+					collapse.cost = EvaluateQuadric(quadrics[b], vertices[a].position);
+					candidates.push_back(collapse);
+				}
+			}
+		std::sort(candidates.begin(), candidates.end(),
+			[](const EdgeCollapse& a, const EdgeCollapse& b) { return a.cost < b.cost; });
+
+		std::vector<GLuint> remap(nVertices);
+		for (GLuint v = 0; v < nVertices; v++)
+			remap[v] = v;
+		std::vector<bool> touched(nVertices, false);
+		size_t remainingTriangles = nTriangles, nCollapses = 0;
+		for (size_t c = 0; c < candidates.size() && remainingTriangles * 3 > targetIndexCount; c++)
+		{
+			const EdgeCollapse& collapse = candidates[c];
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// Rejects the collapses that flip a triangle around the moved vertex.
+			const glm::vec3& target = vertices[collapse.to].position;
+			bool flips = false;
+			size_t removed = 0;
+			for (unsigned int j = adjacencyOffset[collapse.from]; j < adjacencyOffset[collapse.from + 1] && !flips; j++)
+			{
+				const GLuint* triangle = &result[adjacency[j] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					removed++;
+					continue;
+				}
+				glm::vec3 p[3], q[3];
+				for (int k = 0; k < 3; k++)
+				{
+					p[k] = vertices[triangle[k]].position;
+					q[k] = triangle[k] == collapse.from ? target : p[k];
+				}
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+				flips = glm::dot(before, after) <= 0.0f;
+			}
+			if (flips)
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			maxCost = std::max(maxCost, collapse.cost);
+			remainingTriangles -= removed;
+			nCollapses++;
+			// The neighbourhood changed: its vertices wait for the next pass.
+			for (unsigned int j = adjacencyOffset[collapse.from]; j < adjacencyOffset[collapse.from + 1]; j++)
+				for (int k = 0; k < 3; k++)
+					touched[result[adjacency[j] * 3 + k]] = true;
+		}
+		if (nCollapses == 0)
+			break;
+
+		// Applies the collapses, dropping the triangles that became degenerate.
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			GLuint a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	error = (float)sqrt(maxCost);
+	return result;
+}
+
+void GenerateLods(const std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+	std::vector<MeshLod>& lods)
+{
+	MeshLod full;
+	full.firstIndex = 0;
+	full.indexCount = (GLsizei)indices.size();
+	full.error = 0.0f;
+	lods.assign(1, full);
+	if (indices.size() / 3 < LOD_MIN_TRIANGLES)
+		return;
+
+	std::vector<GLuint> previous(indices);
+	float previousError = 0.0f;
+	while (lods.size() < LOD_MAX_LEVELS)
+	{
+		float error;
+		std::vector<GLuint> simplified = SimplifyMesh(vertices, previous, 
+			(size_t)(previous.size() * LOD_REDUCTION) / 3 * 3, error);
+		// A level barely smaller than the previous one is not worth its memory.
+		if (simplified.size() > previous.size() * 0.8f)
+			break;
+		OptimizeVertexCache(simplified, vertices.size());
+
+		MeshLod lod;
+		lod.firstIndex = (GLuint)indices.size();
+		lod.indexCount = (GLsizei)simplified.size();
+		// The error adds up over the chain of simplifications.
+		lod.error = previousError + error;
+		lods.push_back(lod);
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+
+		previous.swap(simplified);
+		previousError = lod.error;
+	}
+}
@@ -1,132 +1,253 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
 #include <vector>
 
-// Library for image loading.
-#include <stb_image\stb_image.h>
-
 #include "Model.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshCache.hpp"
+#include "ShaderCache.hpp"
+#include "AssetRegistry.hpp"
+#include "JobSystem.hpp"
 
-GLint TextureFromFile(const char* path, string directory);
+// The post-processing operations applied by Assimp to the imported meshes.
+#define MODEL_IMPORT_FLAGS (aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs \
+	| aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace)
 
-Model::Model(const std::string& path)
+Model::Model(const std::string& path, unsigned int meshFlags, bool deferred)
 {
-	this->Load(path);
+	this->path = path;
+	this->meshFlags = meshFlags;
+	if (!deferred)
+	{
+		this->Import();
+		this->Upload();
+	}
 }
 
 // Renders the model by calling Mesh.Draw().
-void Model::Draw(Shader shader)
+void Model::Draw(const Shader& shader, int lod)
 {
-	for (GLuint i = 0; i < this->meshes.size(); i++)
-		this->meshes[i].Draw(shader);
+	const size_t nMeshes = this->meshes.size();
+	for (size_t i = 0; i < nMeshes; i++)
+		this->meshes[i].Draw(shader, lod);
+}
+
+void Model::DrawInstanced(GLsizei instanceCount, int lod)
+{
+	const size_t nMeshes = this->meshes.size();
+	for (size_t i = 0; i < nMeshes; i++)
+		this->meshes[i].DrawInstanced(instanceCount, lod);
+}
+
+int Model::GetLodCount() const
+{
+	int nLods = 1;
+	for (size_t i = 0; i < this->meshes.size(); i++)
+		nLods = std::max(nLods, this->meshes[i].GetLodCount());
+	return nLods;
 }
 
-// Destructor: de-allocates mesh memory.
+float Model::GetLodError(int lod) const
+{
+	float error = 0.0f;
+	for (size_t i = 0; i < this->meshes.size(); i++)
+		error = std::max(error, this->meshes[i].GetLodError(lod));
+	return error;
+}
+
+size_t Model::GetGpuBytes() const { return this->gpuBytes; }
+
+// Destructor: de-allocates mesh memory and releases the textures.
 Model::~Model()
 {
 	for (GLuint i = 0; i < this->meshes.size(); i++)
 		this->meshes[i].Delete();
+	for (size_t i = 0; i < this->loadedTextures.size(); i++)
+		AssetRegistry::Instance().ReleaseTexture(this->loadedTextures[i].id);
 }
 
-void Model::Load(std::string path)
+void Model::Import()
 {
-	// Defines the Assimp importer and the post-processing operations.
-	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path, 
-		aiProcess_Triangulate 
-		| aiProcess_JoinIdenticalVertices 
-		| aiProcess_FlipUVs 
-		| aiProcess_GenSmoothNormals 
-		| aiProcess_CalcTangentSpace
-	);
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	// The cached meshes are valid for the content of the file and the processing options.
+	std::ifstream source(path, std::ios::binary);
+	std::vector<char> bytes((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+	unsigned int settings[3] = { meshFlags, MODEL_IMPORT_FLAGS, MESH_CACHE_VERSION };
+	sourceHash = HashFNV1a(bytes.data(), bytes.size());
+	sourceHash = HashFNV1a(settings, sizeof(settings), sourceHash);
 
-	// Error check.
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+	// The cache holds the buffers in their GPU format only: the vertices kept in system memory
+	// need the import.
+	cacheable = !bytes.empty() && !(meshFlags & MESH_KEEP_CPU_DATA);
+	fromCache = cacheable && ReadMeshCache(cacheFile, GetMeshCachePath(path, meshFlags), sourceHash, cachedMeshes);
+	if (!fromCache)
 	{
-		std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-		return;
+		// Defines the Assimp importer and the post-processing operations.
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+
+		// Error check.
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+		{
+			std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+			return;
+		}
+
+		// recupera la directory dal path del modello
+		//this->directory = path.substr(0, path.find_last_of('/'));
+
+		// Processes the meshes of the Assimp's data struct in parallel, one job each.
+		vector<aiMesh*> assimpMeshes;
+		this->CollectAssimpMeshes(scene->mRootNode, scene, assimpMeshes);
+		importedMeshes.resize(assimpMeshes.size());
+		JobCounter counter;
+		for (size_t i = 0; i < assimpMeshes.size(); i++)
+			JobSystem::Instance().Submit([this, &assimpMeshes, scene, i] {
+				this->ProcessAssimpMesh(assimpMeshes[i], scene, this->importedMeshes[i]);
+			}, &counter);
+		JobSystem::Instance().Wait(counter);
+
+		for (size_t i = 0; i < importedMeshes.size(); i++)
+			unpackedBytes += importedMeshes[i].vertices.size() * sizeof(Vertex)
+				+ importedMeshes[i].faceIndices.size() * sizeof(GLuint);
 	}
+	importMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - start).count();
+}
 
-	// recupera la directory dal path del modello
-	//this->directory = path.substr(0, path.find_last_of('/'));
+void Model::Upload()
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	if (fromCache)
+	{
+		// The buffers are uploaded straight from the mapped file.
+		for (size_t i = 0; i < cachedMeshes.size(); i++)
+		{
+			vector<Texture> textures;
+			for (size_t t = 0; t < cachedMeshes[i].texturePaths.size(); t++)
+				textures.push_back(this->AcquireTexture(cachedMeshes[i].texturePaths[t], cachedMeshes[i].textureTypes[t]));
+			this->meshes.push_back(Mesh(cachedMeshes[i].buffers, textures, meshFlags));
+		}
+		vector<CachedMesh>().swap(cachedMeshes);
+		cacheFile.Close();
+	}
+	else
+	{
+		for (size_t i = 0; i < importedMeshes.size(); i++)
+		{
+			ImportedMesh& imported = importedMeshes[i];
+			vector<Texture> textures;
+			for (size_t t = 0; t < imported.texturePaths.size(); t++)
+				textures.push_back(this->AcquireTexture(imported.texturePaths[t], imported.textureTypes[t]));
+			this->meshes.push_back(Mesh(std::move(imported.vertices), std::move(imported.faceIndices), 
+				textures, meshFlags, imported.lods));
+		}
+		vector<ImportedMesh>().swap(importedMeshes);
+		if (cacheable && !this->meshes.empty())
+			this->StoreCache();
+	}
+	this->UpdateBounds();
 
-	// Starts the processing of the Assimp's data struct.
-	this->ProcessAssimpNode(scene->mRootNode, scene);
+	double uploadMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "INFO::MODEL:: " << path << ": " << gpuBytes / 1024 << " KB of vertex and index data";
+	if (fromCache)
+		std::cout << ", loaded from the cache in ";
+	else
+		std::cout << " (" << unpackedBytes / 1024 << " KB unpacked), imported in ";
+	std::cout << importMilliseconds << " ms, uploaded in " << uploadMilliseconds << " ms" << std::endl;
 }
 
-void Model::ProcessAssimpNode(aiNode* node, const aiScene* scene)
+void Model::UpdateBounds()
 {
-	// For each mesh
-	for (GLuint i = 0; i < node->mNumMeshes; i++)
+	gpuBytes = 0;
+	boundsMin = boundsMax = this->meshes.empty() ? glm::vec3(0.0f) : this->meshes[0].boundsMin;
+	for (size_t i = 0; i < this->meshes.size(); i++)
 	{
-		// Extracts the Mesh and adds it to the meshes vector.
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		this->meshes.push_back(this->ProcessAssimpMesh(mesh, scene));
+		gpuBytes += this->meshes[i].GetGpuBytes();
+		boundsMin = glm::min(boundsMin, this->meshes[i].boundsMin);
+		boundsMax = glm::max(boundsMax, this->meshes[i].boundsMax);
 	}
+}
+
+void Model::StoreCache()
+{
+	// The buffers are read back as uploaded: packed and with the final index size.
+	std::vector<CachedMesh> cached(this->meshes.size());
+	std::vector<std::vector<unsigned char>> vertexStorage(this->meshes.size()), indexStorage(this->meshes.size());
+	for (size_t i = 0; i < this->meshes.size(); i++)
+	{
+		cached[i].buffers = this->meshes[i].ReadBuffers(vertexStorage[i], indexStorage[i]);
+		for (size_t t = 0; t < this->meshes[i].textures.size(); t++)
+		{
+			cached[i].textureTypes.push_back(this->meshes[i].textures[t].type);
+			cached[i].texturePaths.push_back(this->meshes[i].textures[t].path.C_Str());
+		}
+	}
+	WriteMeshCache(GetMeshCachePath(path, meshFlags), sourceHash, cached);
+}
+
+void Model::CollectAssimpMeshes(aiNode* node, const aiScene* scene, vector<aiMesh*>& meshes)
+{
+	// For each mesh
+	for (GLuint i = 0; i < node->mNumMeshes; i++)
+		meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
 
 	// Repeat for each child of the current node.
 	for (GLuint i = 0; i < node->mNumChildren; i++)
-		this->ProcessAssimpNode(node->mChildren[i], scene);
+		this->CollectAssimpMeshes(node->mChildren[i], scene, meshes);
 }
 
-Mesh Model::ProcessAssimpMesh(aiMesh* mesh, const aiScene* scene)
+void Model::ProcessAssimpMesh(aiMesh* mesh, const aiScene* scene, ImportedMesh& imported)
 {
-	// Vectors for the read vertices and faces.
-	vector<Vertex> vertices;
-	vector<GLuint> faceIndices;
-	vector<Texture> textures;
-
-	// For each vertex
-	for (GLuint i = 0; i < mesh->mNumVertices; i++)
-	{
-		Vertex vertex;
-		// Converts Assimp's data structs to GLM's data structs.
-		glm::vec3 vector;
-		// Coordinate vertici
-		vector.x = mesh->mVertices[i].x;
-		vector.y = mesh->mVertices[i].y;
-		vector.z = mesh->mVertices[i].z;
-		vertex.position = vector;
-		// Normali
-		vector.x = mesh->mNormals[i].x;
-		vector.y = mesh->mNormals[i].y;
-		vector.z = mesh->mNormals[i].z;
-		vertex.normal = vector;
-		// Texture Coordinates
-
-		// If the model has texture coordinates, assign them to a GLM data struct, otherwise set them to 0.
-		if (mesh->mTextureCoords[0])
+	// Converts Assimp's arrays to the vertices one attribute at a time, in place.
+	const GLuint nVertices = mesh->mNumVertices;
+	vector<Vertex>& vertices = imported.vertices;
+	vertices.resize(nVertices);
+	for (GLuint i = 0; i < nVertices; i++)
+	{
+		vertices[i].position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+		vertices[i].normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+	}
+
+	// If the model has texture coordinates, assign them to a GLM data struct, otherwise set them to 0.
+	if (mesh->mTextureCoords[0])
+	{
+		// Assume a unique set of UV coordinates.
+		// In realt,  possibile avere fino a 8 diverse coordinate texture: per altri modelli e formati, questo codice va adattato e modificato
+		const aiVector3D* uvs = mesh->mTextureCoords[0];
+		for (GLuint i = 0; i < nVertices; i++)
 		{
-			glm::vec2 vec;
-			// Assume a unique set of UV coordinates.
-			// In realt,  possibile avere fino a 8 diverse coordinate texture: per altri modelli e formati, questo codice va adattato e modificato
-			vec.x = mesh->mTextureCoords[0][i].x;
-			vec.y = mesh->mTextureCoords[0][i].y;
-			vertex.uv = vec;
-
-			// Tangenti
-			vector.x = mesh->mTangents[i].x;
-			vector.y = mesh->mTangents[i].y;
-			vector.z = mesh->mTangents[i].z;
-			vertex.tangent = vector;
-			// Bitangenti
-			vector.x = mesh->mBitangents[i].x;
-			vector.y = mesh->mBitangents[i].y;
-			vector.z = mesh->mBitangents[i].z;
-			vertex.bitangent = vector;
+			vertices[i].uv = glm::vec2(uvs[i].x, uvs[i].y);
+			vertices[i].tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+			vertices[i].bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
 		}
-		else {
-			vertex.uv = glm::vec2(0.0f, 0.0f);
-			cout << "WARNING::ASSIMP:: MODEL WITHOUT UV COORDINATES -> TANGENT AND BITANGENT ARE = 0" << endl;
+	}
+	else
+	{
+		for (GLuint i = 0; i < nVertices; i++)
+		{
+			vertices[i].uv = glm::vec2(0.0f);
+			vertices[i].tangent = vertices[i].bitangent = glm::vec3(0.0f);
 		}
-		// Adds the vertex to the list.    
-		vertices.push_back(vertex);
+		cout << "WARNING::ASSIMP:: MODEL WITHOUT UV COORDINATES -> TANGENT AND BITANGENT ARE = 0" << endl;
 	}
 
 	// Gets the indices of the vertices the mesh is made of.
+	vector<GLuint>& faceIndices = imported.faceIndices;
+	size_t nIndices = 0;
+	for (GLuint i = 0; i < mesh->mNumFaces; i++)
+		nIndices += mesh->mFaces[i].mNumIndices;
+	faceIndices.resize(nIndices);
+	GLuint* index = faceIndices.data();
 	for (GLuint i = 0; i < mesh->mNumFaces; i++)
 	{
-		aiFace face = mesh->mFaces[i];
+		const aiFace& face = mesh->mFaces[i];
 		for (GLuint j = 0; j < face.mNumIndices; j++)
-			faceIndices.push_back(face.mIndices[j]);
+			*index++ = face.mIndices[j];
 	}
 
 	// Processes the materials.
@@ -141,79 +262,107 @@ Mesh Model::ProcessAssimpMesh(aiMesh* mesh, const aiScene* scene)
 		// Normal: texture_normalN
 
 		// 1. Diffuse maps
-		vector<Texture> diffuseMaps = this->LoadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+		this->CollectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", imported);
 		// 2. Specular maps
-		vector<Texture> specularMaps = this->LoadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+		this->CollectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", imported);
 		// 3. Normal maps
-		std::vector<Texture> normalMaps = this->LoadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-		textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+		this->CollectMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", imported);
 		// 4. Height maps
-		std::vector<Texture> heightMaps = this->LoadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+		this->CollectMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", imported);
 	}
 
-	// Creates the new mesh with the loaded vertices, faces and textures.
-	return Mesh(vertices, faceIndices, textures);
+	// Optimizes the triangles' order for the post-transform cache, then the vertices' order
+	// for the fetch.
+	if (meshFlags & MESH_OPTIMIZE_CACHE)
+	{
+		float acmrBefore = ComputeACMR(faceIndices, vertices.size());
+		OptimizeVertexCache(faceIndices, vertices.size());
+		if (meshFlags & MESH_OPTIMIZE_OVERDRAW)
+			OptimizeOverdraw(faceIndices, vertices, 1.05f);
+		OptimizeVertexFetch(vertices, faceIndices);
+		// Printed at once: the meshes are processed concurrently.
+		std::stringstream message;
+		message << "INFO::MODEL:: " << mesh->mName.C_Str() << ": ACMR " << acmrBefore << " -> "
+			<< ComputeACMR(faceIndices, vertices.size()) << std::endl;
+		std::cout << message.str();
+	}
+
+	// The levels of detail are simplified from the final vertices: they index the same ones.
+	if (meshFlags & MESH_GENERATE_LODS)
+	{
+		GenerateLods(vertices, faceIndices, imported.lods);
+		if (imported.lods.size() > 1)
+		{
+			std::stringstream message;
+			message << "INFO::MODEL:: " << mesh->mName.C_Str() << ": LOD triangles";
+			for (size_t l = 0; l < imported.lods.size(); l++)
+			{
+				message << " " << imported.lods[l].indexCount / 3;
+				if (l > 0)
+					message << " (error " << imported.lods[l].error << ")";
+			}
+			std::cout << message.str() << std::endl;
+		}
+	}
 }
 
-// Loads (if not loaded yet) the textures defined by the model's materials.
-vector<Texture> Model::LoadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+// Lists the textures defined by the model's materials. They are acquired by the upload: the
+// registry shares them with the other models and materials, each file is loaded once.
+void Model::CollectMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName, ImportedMesh& imported)
 {
-	vector<Texture> textures;
 	unsigned int texCount = mat->GetTextureCount(type);
 	for (GLuint i = 0; i < texCount; i++)
 	{
 		aiString str;
 		mat->GetTexture(type, i, &str);
-		// Skips this texture if already loaded.
-		GLboolean skip = false;
-		for (GLuint j = 0; j < loadedTextures.size(); j++)
-		{
-			if (loadedTextures[j].path == str)
-			{
-				textures.push_back(loadedTextures[j]);
-				skip = true; // A texture with the same filepath has already been loaded, continue to next one. (optimization)
-				break;
-			}
-		}
-		if (!skip)
-		{   // If texture hasn't been loaded already, load it
-			Texture texture;
-			texture.id = TextureFromFile(str.C_Str(), this->directory);
-			texture.type = typeName;
-			texture.path = str;
-			textures.push_back(texture);
-			this->loadedTextures.push_back(texture);  // Store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-		}
+		imported.textureTypes.push_back(typeName);
+		imported.texturePaths.push_back(str.C_Str());
 	}
-	return textures;
 }
 
-// Loads a texture from the specified file path.
-GLint TextureFromFile(const char* path, string directory)
+Texture Model::AcquireTexture(const std::string& path, const std::string& typeName)
 {
-	//Generate texture ID and load texture data 
-	string filename = string(path);
-	filename = directory + '/' + filename;
-	GLuint textureID;
-	glGenTextures(1, &textureID);
-	int width, height;
-	unsigned char* image = stbi_load(filename.c_str(), &width, &height, 0, STBI_rgb);
-
-	// Assign texture to ID
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	// Parameters
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	stbi_image_free(image);
-	return textureID;
+	Texture texture;
+	texture.id = AssetRegistry::Instance().AcquireTexture(this->directory + '/' + path,
+		typeName == "texture_normal" ? TEXTURE_USAGE_NORMAL_MAP : TEXTURE_USAGE_COLOR);
+	texture.type = typeName;
+	texture.path = aiString(path);
+	// Each acquired reference is released by the destructor.
+	this->loadedTextures.push_back(texture);
+	return texture;
 }
 
+std::vector<Model*> LoadModels(const std::vector<std::string>& paths, unsigned int meshFlags)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	const size_t nModels = paths.size();
+	std::vector<Model*> models(nModels);
+	std::vector<JobCounter> imported(nModels);
+	for (size_t i = 0; i < nModels; i++)
+	{
+		Model* model = models[i] = new Model(paths[i], meshFlags, true);
+		JobSystem::Instance().Submit([model] { model->Import(); }, &imported[i]);
+	}
+
+	// Uploads the models as they are imported, helping the workers in the meantime.
+	std::vector<bool> uploaded(nModels, false);
+	size_t nUploaded = 0;
+	while (nUploaded < nModels)
+	{
+		bool progress = false;
+		for (size_t i = 0; i < nModels; i++)
+			if (!uploaded[i] && imported[i].IsDone())
+			{
+				models[i]->Upload();
+				uploaded[i] = progress = true;
+				nUploaded++;
+			}
+		if (!progress && !JobSystem::Instance().RunPendingJob())
+			std::this_thread::yield();
+	}
+
+	std::cout << "INFO::MODEL:: " << nModels << " models loaded in " << std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - start).count() << " ms on " 
+		<< JobSystem::Instance().GetWorkerCount() << " workers" << std::endl;
+	return models;
+}
@@ -2,6 +2,7 @@
 #include "PaintableComponent.h"
 #include "RigidbodyComponent.h"
 #include "GameObject.hpp"
+#include "RenderingEngine.hpp"
 #include <iostream>
 
 PaintBallComponent::PaintBallComponent(GameObject* gameObject, PhysicsModule* physicsModule) 
@@ -12,13 +13,16 @@ PaintBallComponent::PaintBallComponent(GameObject* gameObject, PhysicsModule* ph
 
 void PaintBallComponent::OnCreate()
 {
+	GameObject* gameObject = GetGameObject();
 	previousPosition = gameObject->GetTransform()->GetAbsolutePosition();
 }
 
-void PaintBallComponent::OnUpdate(float deltaTime)
+void PaintBallComponent::OnPostPhysics(float deltaTime)
 {
-	RigidbodyComponent *rb = 
-		static_cast<RigidbodyComponent*>(gameObject->GetComponent(RIGIDBODY_COMPONENT));
+	GameObject* gameObject = GetGameObject();
+	if (gameObject == NULL)
+		return;
+	RigidbodyComponent *rb = gameObject->GetComponent<RigidbodyComponent>();
 	direction = rb->GetLinearVelocity();
 	direction = glm::normalize(direction);
 }
@@ -27,18 +31,12 @@ glm::vec3 PaintBallComponent::GetDirection() { return direction; }
 
 void PaintBallComponent::OnCollision(GameObject* other, glm::vec3 hitPoint)
 {
-	if (!exploded)
+	GameObject* gameObject = GetGameObject();
+	if (!exploded && gameObject != NULL)
 	{
-		btSphereShape* sphereShape = new btSphereShape((btScalar)1.0f);
-		btCollisionObject* trigger = new btCollisionObject();
-		trigger->setCollisionShape(sphereShape);
 		glm::vec3 paintBallPos = gameObject->GetTransform()->GetAbsolutePosition();
-		trigger->getWorldTransform().setOrigin(btVector3((btScalar)paintBallPos.x, 
-			(btScalar)paintBallPos.y, (btScalar)paintBallPos.z));
-		//physicsModule->collisionWorld->addCollisionObject(trigger);
 
-		RigidbodyComponent* rbComponent = 
-			static_cast<RigidbodyComponent*>(gameObject->GetComponent(RIGIDBODY_COMPONENT));
+		RigidbodyComponent* rbComponent = gameObject->GetComponent<RigidbodyComponent>();
 		rbComponent->rb->getCollisionShape()->setLocalScaling(btVector3(1.5f, 1.5f, 1.5f));
 
 		// View matrix is created by locating the point of view one unit behind the paint
@@ -61,14 +59,16 @@ void PaintBallComponent::OnCollision(GameObject* other, glm::vec3 hitPoint)
 		std::vector<GameObject*> collisions = physicsModule->GetGameObjectsCollidingWith(gameObject);
 		for (int i = 0; i < collisions.size(); i++)
 		{
-			PaintableComponent* paintableComponent =
-				static_cast<PaintableComponent*>(collisions[i]->GetComponent(PAINTABLE_COMPONENT));
+			PaintableComponent* paintableComponent = collisions[i]->GetComponent<PaintableComponent>();
 			if (paintableComponent)
 				paintableComponent->RenderPaintMap(paintSpaceMatrix, direction);
 		}
 
+		// The splash briefly lights up the surroundings with the paint color.
+		gameObject->GetEngine()->lights->AddLight(paintBallPos, glm::vec3(0, 1, 0) * SPLASH_LIGHT_INTENSITY,
+			SPLASH_LIGHT_RADIUS, SPLASH_LIGHT_LIFETIME);
+
 		gameObject->Destroy();
-		//physicsModule->collisionWorld->removeCollisionObject(trigger);
 
 		exploded = true;
 	}
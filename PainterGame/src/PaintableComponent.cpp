@@ -4,6 +4,7 @@
 
 #include "PaintableComponent.h"
 #include "RenderingEngine.hpp"
+#include "Profiler.hpp"
 
 #include "bitmap_image.hpp"
 
@@ -26,7 +27,7 @@ PaintableComponent::~PaintableComponent()
 
 void PaintableComponent::OnCreate()
 {
-	Material* goMat = gameObject->GetMaterial();
+	Material* goMat = GetGameObject()->GetMaterial();
 	PaintableShaderParamSet *shaderParams =
 		static_cast<PaintableShaderParamSet*>(goMat->shaderParams);
 	CreatePaintMap();
@@ -52,6 +53,13 @@ inline void PaintableComponent::CreatePaintMap()
 	GLuint borderColor[] = { UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX };
 	glTexParameterIuiv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// The paint map is written with image stores: the framebuffer has no attachments, it only
+	// defines the rasterization area. Unlike the default framebuffer, it exists in headless 
+	// contexts and is not clipped by the window size.
+	glBindFramebuffer(GL_FRAMEBUFFER, paintMapFBO);
+	glFramebufferParameteri(GL_FRAMEBUFFER, GL_FRAMEBUFFER_DEFAULT_WIDTH, PAINTMAP_SIZE);
+	glFramebufferParameteri(GL_FRAMEBUFFER, GL_FRAMEBUFFER_DEFAULT_HEIGHT, PAINTMAP_SIZE);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
@@ -61,6 +69,10 @@ void PaintableComponent::RenderPaintMap(glm::mat4 paintSpaceMatrix, glm::vec3 pa
 	if (paintMap == 0)
 		CreatePaintMap();
 
+	GameObject* gameObject = GetGameObject();
+	if (gameObject == NULL)
+		return;
+	ScopedGpuTimer timer("Paint splat");
 	Transform* tr = gameObject->GetTransform();
 	Model* model = gameObject->GetModel();
 
@@ -86,21 +98,34 @@ void PaintableComponent::RenderPaintMap(glm::mat4 paintSpaceMatrix, glm::vec3 pa
 	glBindTexture(GL_TEXTURE_2D, stainSet->GetNextRandomStain());
 	glUniform1i(glGetUniformLocation(paintMapShader->program, "stainTex"), 11);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glClear(GL_DEPTH_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, paintMapFBO);
 	model->Draw(*paintMapShader);
 	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);	
 	
 	// Resets the state.
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void PaintableComponent::OnUpdate(float deltaTime)
+GLuint PaintableComponent::GetPaintMap() { return paintMap; }
+
+float PaintableComponent::ComputePaintCoverage()
 {
-	
-}
+	if (paintMap == 0)
+		return 0.0f;
 
-GLuint PaintableComponent::GetPaintMap() { return paintMap; }
+	// Unpainted texels hold the maximum value.
+	std::vector<GLubyte> pixels(PAINTMAP_SIZE * PAINTMAP_SIZE);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindTexture(GL_TEXTURE_2D, paintMap);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &pixels[0]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	size_t painted = 0;
+	for (size_t i = 0; i < pixels.size(); i++)
+		if (pixels[i] < 0xff)
+			painted++;
+	return (float)painted / (float)pixels.size();
+}
 
 void ExportTexture(GLint texture, GLint width, GLint height, std::string name, GLenum format)
 {
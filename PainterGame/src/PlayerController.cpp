@@ -74,6 +74,15 @@ void PlayerController::ProcessMouseMovement(GLfloat xOffset, GLfloat yOffset, GL
 	this->UpdateCameraVectors();
 }
 
+// Places the camera.
+void PlayerController::SetPose(vec3 position, GLfloat yaw, GLfloat pitch)
+{
+	this->position = position;
+	this->yaw = yaw;
+	this->pitch = pitch;
+	this->UpdateCameraVectors();
+}
+
 // Updates the camera vectors from the current yaw and pitch values.
 void PlayerController::UpdateCameraVectors()
 {
@@ -106,11 +115,10 @@ void PlayerController::Shoot(Model* paintBallModel, RenderingEngine* engine,
 		glm::vec3(0.15f, 0.15f, 0.15f), glm::vec3(0, 0, 0), 3, 0.3f, 0.3f);
 	GameObject* paintBall = engine->AddGameObject("PaintBall", paintBallModel, this->position, 
 		glm::vec3(0, 0, 0), glm::vec3(0.15f, 0.15f, 0.15f), nullptr, paintMaterial);
-	paintBall->AddComponent(new RigidbodyComponent(paintBall, physicsModule, paintBallRb));
+	paintBall->AddComponent<RigidbodyComponent>(physicsModule, paintBallRb);
 
-	PaintBallComponent* paintBallComponent = new PaintBallComponent(paintBall, physicsModule);
+	PaintBallComponent* paintBallComponent = paintBall->AddComponent<PaintBallComponent>(physicsModule);
 	paintBallComponent->SetLocalRight(glm::cross(this->localFront, this->worldUp));
-	paintBall->AddComponent(paintBallComponent);
 
 	// Applies the impulse to the projectile.
 	// When the player presses the space bar, a paint ball is shot to the center of the screen.
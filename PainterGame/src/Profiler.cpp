@@ -0,0 +1,219 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "Profiler.hpp"
+
+// The name of the timer that measures whole frames.
+#define FRAME_TIMER "Frame"
+
+Profiler& Profiler::Instance()
+{
+	static Profiler instance;
+	return instance;
+}
+
+Profiler::Profiler()
+{
+	origin = Clock::now();
+}
+
+double Profiler::Now()
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - origin).count();
+}
+
+void Profiler::BeginFrame()
+{
+	if (!enabled)
+		return;
+
+	frameIndex++;
+	// The slot has been issued PROFILER_QUERY_RING_SIZE frames ago: its results are ready.
+	ResolveQueries(queryRing[frameIndex % PROFILER_QUERY_RING_SIZE]);
+	BeginCpu(FRAME_TIMER);
+}
+
+void Profiler::EndFrame()
+{
+	if (!enabled)
+		return;
+
+	EndCpu();
+	for (std::map<std::string, TimerStats>::iterator it = timers.begin(); it != timers.end(); ++it)
+		if (!it->second.gpu)
+		{
+			PushHistory(it->second, it->second.frameTotal);
+			it->second.frameTotal = 0.0;
+		}
+}
+
+void Profiler::BeginCpu(const char* name)
+{
+	if (!enabled)
+		return;
+
+	OpenScope scope;
+	scope.name = name;
+	scope.start = Now();
+	openScopes.push_back(scope);
+}
+
+void Profiler::EndCpu()
+{
+	if (!enabled || openScopes.empty())
+		return;
+
+	// Scopes are closed in reverse order.
+	OpenScope scope = openScopes.back();
+	openScopes.pop_back();
+	double duration = Now() - scope.start;
+	timers[scope.name].frameTotal += duration;
+	Record(scope.name, false, scope.start, duration);
+}
+
+bool Profiler::BeginGpu(const char* name)
+{
+	if (!enabled || gpuScopeOpen)
+		return false;
+
+	GpuScope scope;
+	scope.name = name;
+	scope.cpuStart = Now();
+	if (freeQueries.empty())
+		glGenQueries(1, &scope.query);
+	else
+	{
+		scope.query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+	glBeginQuery(GL_TIME_ELAPSED, scope.query);
+	queryRing[frameIndex % PROFILER_QUERY_RING_SIZE].push_back(scope);
+	gpuScopeOpen = true;
+	return true;
+}
+
+void Profiler::EndGpu()
+{
+	if (!gpuScopeOpen)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	gpuScopeOpen = false;
+}
+
+void Profiler::ResolveQueries(std::vector<GpuScope>& scopes)
+{
+	// Sums the scopes with the same name, as a timer reports its total per frame.
+	std::map<std::string, double> totals;
+	lastGpuFrameTime = 0.0;
+	for (size_t i = 0; i < scopes.size(); i++)
+	{
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(scopes[i].query, GL_QUERY_RESULT, &nanoseconds);
+		double duration = nanoseconds / 1000000.0;
+		totals[scopes[i].name] += duration;
+		lastGpuFrameTime += duration;
+		// The GPU timeline is not known: the scope is placed where the CPU issued it.
+		Record(scopes[i].name, true, scopes[i].cpuStart, duration);
+		freeQueries.push_back(scopes[i].query);
+	}
+	scopes.clear();
+
+	for (std::map<std::string, double>::iterator it = totals.begin(); it != totals.end(); ++it)
+		timers[it->first].gpu = true;
+	// Passes not issued in the frame count as zero, like CPU timers.
+	for (std::map<std::string, TimerStats>::iterator it = timers.begin(); it != timers.end(); ++it)
+		if (it->second.gpu)
+			PushHistory(it->second, totals[it->first]);
+}
+
+void Profiler::PushHistory(TimerStats& stats, double total)
+{
+	stats.history[stats.historyNext] = total;
+	stats.historyNext = (stats.historyNext + 1) % PROFILER_HISTORY_SIZE;
+	if (stats.historyCount < PROFILER_HISTORY_SIZE)
+		stats.historyCount++;
+}
+
+double Profiler::GetLastGpuFrameTime() { return lastGpuFrameTime; }
+
+double Profiler::GetAverage(const std::string& name)
+{
+	std::map<std::string, TimerStats>::iterator it = timers.find(name);
+	if (it == timers.end() || it->second.historyCount == 0)
+		return 0.0;
+
+	double sum = 0.0;
+	for (int i = 0; i < it->second.historyCount; i++)
+		sum += it->second.history[i];
+	return sum / it->second.historyCount;
+}
+
+void Profiler::PrintAverages()
+{
+	std::cout << "| -- Profiler (average ms per frame) ------------------- -- |" << std::endl;
+	for (std::map<std::string, TimerStats>::iterator it = timers.begin(); it != timers.end(); ++it)
+		std::cout << "| " << (it->second.gpu ? "GPU " : "CPU ") << it->first << ": " 
+			<< GetAverage(it->first) << std::endl;
+	std::cout << "| -- --------------------------------------------------- -- |" << std::endl;
+}
+
+void Profiler::Record(const char* name, bool gpu, double start, double duration)
+{
+	if (!recordTrace || traceEvents.size() >= PROFILER_MAX_TRACE_EVENTS)
+		return;
+
+	TraceEvent e;
+	e.name = name;
+	e.gpu = gpu;
+	e.start = start;
+	e.duration = duration;
+	traceEvents.push_back(e);
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "ERROR::PROFILER:: cannot write " << path << std::endl;
+		return false;
+	}
+
+	// CPU and GPU measures are shown as two threads; times are in microseconds.
+	file << "{\"traceEvents\":[" << std::endl;
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}}," << std::endl;
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+	char line[256];
+	for (size_t i = 0; i < traceEvents.size(); i++)
+	{
+		const TraceEvent& e = traceEvents[i];
+		snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			e.name, e.gpu ? "gpu" : "cpu", e.gpu ? 1 : 0, e.start * 1000.0, e.duration * 1000.0);
+		file << line;
+	}
+	file << std::endl << "]}" << std::endl;
+	return true;
+}
+
+ScopedCpuTimer::ScopedCpuTimer(const char* name)
+{
+	Profiler::Instance().BeginCpu(name);
+}
+
+ScopedCpuTimer::~ScopedCpuTimer()
+{
+	Profiler::Instance().EndCpu();
+}
+
+ScopedGpuTimer::ScopedGpuTimer(const char* name)
+{
+	started = Profiler::Instance().BeginGpu(name);
+}
+
+ScopedGpuTimer::~ScopedGpuTimer()
+{
+	if (started)
+		Profiler::Instance().EndGpu();
+}
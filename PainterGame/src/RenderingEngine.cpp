@@ -1,9 +1,8 @@
 #include "RenderingEngine.hpp"
+#include "TransformHierarchy.hpp"
 #include "RigidbodyComponent.h"
 #include "PaintableComponent.h"
-
-#define SCR_WIDTH 1920
-#define SCR_HEIGHT 1080
+#include "Profiler.hpp"
 
 unsigned int quadVAO = 0;
 unsigned int quadVBO;
@@ -11,14 +10,15 @@ void renderQuad();
 
 void ExportTexture(GLint texture, GLint width, GLint height, std::string name, GLenum format);
 
-RenderingEngine::RenderingEngine(PlayerController* player)
+RenderingEngine::RenderingEngine(PlayerController* player, int width, int height)
 {
-	renderableObjects = std::list<GameObject*>();
-	paintableObjects = std::list<GameObject*>();
-	gameObjectCounter = 0;
 	this->player = player;
+	this->width = width;
+	this->height = height;
 
 	uiShader = new Shader("shaders/ui.vert", "shaders/ui.frag", SHADER_UI);
+	lights = new LightManager();
+	shadows = new ShadowSystem();
 
 	glGenFramebuffers(1, &hdrFBO);
 	glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
@@ -27,19 +27,19 @@ RenderingEngine::RenderingEngine(PlayerController* player)
 	// "Bind" the newly created texture : all future texture functions will modify this texture
 	glBindTexture(GL_TEXTURE_2D, renderedTexture);
 
-	// Give an empty image to OpenGL ( the last "0" )
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+	// Linear filtering: the scene is upscaled when rendered at a lower resolution.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-	// Poor filtering. Needed !
+	// The depth buffer, a texture so that the light culling pass can read it.
+	glGenTextures(1, &depthTexture);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-	// The depth buffer
-	GLuint depthrenderbuffer;
-	glGenRenderbuffers(1, &depthrenderbuffer);
-	glBindRenderbuffer(GL_RENDERBUFFER, depthrenderbuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthrenderbuffer);
+	AllocateRenderTargets();
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0);
 
 	// Set "renderedTexture" as our colour attachement #0
 	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderedTexture, 0);
@@ -49,6 +49,49 @@ RenderingEngine::RenderingEngine(PlayerController* player)
 	glDrawBuffers(1, DrawBuffers); // "1" is the size of DrawBuffers
 }
 
+void RenderingEngine::AllocateRenderTargets()
+{
+	// Give an empty image to OpenGL ( the last "0" )
+	glBindTexture(GL_TEXTURE_2D, renderedTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void RenderingEngine::Resize(int width, int height)
+{
+	// A minimized window has no size: keeps the current targets.
+	if (width <= 0 || height <= 0 || (width == this->width && height == this->height))
+		return;
+
+	this->width = width;
+	this->height = height;
+	// The attachments keep their names: only their storage is reallocated.
+	AllocateRenderTargets();
+}
+
+float RenderingEngine::GetRenderScale() { return renderScale; }
+
+void RenderingEngine::UpdateRenderScale()
+{
+	if (!dynamicResolution)
+	{
+		renderScale = 1.0f;
+		return;
+	}
+
+	// The GPU times are read a few frames late: smoothing avoids oscillations.
+	gpuFrameTime = gpuFrameTime * 0.9 + Profiler::Instance().GetLastGpuFrameTime() * 0.1;
+	if (gpuFrameTime > targetFrameTime)
+		renderScale -= DYNAMIC_RESOLUTION_STEP_DOWN;
+	else if (gpuFrameTime < targetFrameTime * 0.8)
+		renderScale += DYNAMIC_RESOLUTION_STEP_UP;
+	renderScale = glm::clamp(renderScale, DYNAMIC_RESOLUTION_MIN_SCALE, 1.0f);
+}
+
 /// <summary>
 /// Renders all the objects in the scene.
 /// </summary>
@@ -58,30 +101,72 @@ void RenderingEngine::RenderAll(glm::mat4 viewMat, glm::mat4 projection)
 {
 	glm::vec3 lightPosition(0, 4, -1);
 	// Texture unit 1 is the default used with the normal rendering.
+	UpdateRenderScale();
+	GLint sceneWidth = (GLint)(width * renderScale), sceneHeight = (GLint)(height * renderScale);
+
+	InterpolateModelMatrices();
+
+	// The shadow maps are updated first, in their own framebuffer.
+	shadows->Render(gameObjects.GetObjects(), modelMatrices, viewMat, projection);
+	SelectLods(viewMat, projection, sceneHeight);
+
 	glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
+	glViewport(0, 0, sceneWidth, sceneHeight);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	//Set blue as background color  
 	glClearColor(0.0f, 0.0f, 1.0f, 0.75f);
 	
-	for (std::list<GameObject*>::iterator it = renderableObjects.begin(); it != renderableObjects.end(); ++it)
+	// With point lights in the scene, a depth prepass feeds the light culling, and the scene pass
+	// only shades the visible fragments.
+	bool tiledLights = lights->GetLightCount() > 0;
+	unsigned int extraFeatures = shadows->GetShaderFeature();
+	if (tiledLights)
+	{
+		RenderDepthPrepass(viewMat, projection);
+		lights->CullLights(depthTexture, viewMat, projection, sceneWidth, sceneHeight);
+		extraFeatures |= SHADER_FEATURE_TILED_LIGHTS;
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_FALSE);
+	}
+
+	Profiler::Instance().BeginGpu("Scene pass");
+	const std::vector<GameObject*>& objects = gameObjects.GetObjects();
+	for (size_t i = 0; i < objects.size(); i++)
 	{
-		GameObject* currentObj = *it;
+		GameObject* currentObj = objects[i];
 		Material* mat = currentObj->GetMaterial();
-		Transform* tr = currentObj->GetTransform();
 		Model* model = currentObj->GetModel();
 
-		mat->shader->Use();
+		// The variant depends on the features currently used by the material.
+		Shader* shader = mat->SelectVariant(shaders, extraFeatures);
+		shader->Use();
 		mat->shaderParams->LoadUniforms(mat);
+		if (tiledLights)
+			mat->LoadUniform("tileCountX", (GLint)lights->GetTileCountX());
+		if (shadows->GetLightType() != SHADOW_LIGHT_NONE)
+			shadows->LoadUniforms(shader->program);
 		mat->LoadUniform("projectionMatrix", projection);
-		mat->LoadUniform("viewMatrix", player->GetViewMatrix());
-		glm::mat4 modelMatrix = tr->GetTransformMatrix();
+		mat->LoadUniform("viewMatrix", viewMat);
+		const glm::mat4& modelMatrix = modelMatrices[i];
 		mat->LoadUniform("modelMatrix", modelMatrix);
 		glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(viewMat * modelMatrix));
 		mat->LoadUniform("normalMatrix", normalMatrix);
-		model->Draw(*mat->shader);
+		model->Draw(*shader, objectLods[i]);
+	}
+	Profiler::Instance().EndGpu();
+
+	if (tiledLights)
+	{
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
 	}
 
+	if (!presentToScreen)
+		return;
+
+	ScopedGpuTimer timer("UI composite");
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	uiShader->Use();
 	glActiveTexture(GL_TEXTURE0);
@@ -90,9 +175,67 @@ void RenderingEngine::RenderAll(glm::mat4 viewMat, glm::mat4 projection)
 	glBindTexture(GL_TEXTURE_2D, uiTexture);
 	glUniform1i(glGetUniformLocation(uiShader->program, "scene"), 0);
 	glUniform1i(glGetUniformLocation(uiShader->program, "ui"), 1);
+	glUniform2f(glGetUniformLocation(uiShader->program, "sceneScale"), 
+		(float)sceneWidth / width, (float)sceneHeight / height);
 	renderQuad();
 }
 
+void RenderingEngine::InterpolateModelMatrices()
+{
+	const std::vector<GameObject*>& objects = gameObjects.GetObjects();
+	modelMatrices.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+		modelMatrices[i] = objects[i]->GetTransform()->GetInterpolatedMatrix(interpolationAlpha);
+}
+
+void RenderingEngine::SelectLods(const glm::mat4& viewMat, const glm::mat4& projection, int sceneHeight)
+{
+	// Pixels covered by a unit length at unit distance from the camera.
+	const float pixelsPerUnit = projection[1][1] * sceneHeight * 0.5f;
+	const std::vector<GameObject*>& objects = gameObjects.GetObjects();
+	objectLods.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		Model* model = objects[i]->GetModel();
+		int& lod = objectLods[i];
+		lod = 0;
+		const int nLods = model->GetLodCount();
+		if (nLods == 1 || lodPixelError <= 0.0f)
+			continue;
+
+		// The distance is taken from the closest point of the bounding sphere.
+		const glm::mat4& modelMatrix = modelMatrices[i];
+		float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])), 
+			glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+		glm::vec3 center = glm::vec3(viewMat * modelMatrix * glm::vec4((model->boundsMin + model->boundsMax) * 0.5f, 1.0f));
+		float radius = glm::length(model->boundsMax - model->boundsMin) * 0.5f * scale;
+		float distance = glm::max(glm::length(center) - radius, 0.001f);
+
+		while (lod + 1 < nLods && model->GetLodError(lod + 1) * scale * pixelsPerUnit / distance <= lodPixelError)
+			lod++;
+	}
+}
+
+void RenderingEngine::RenderDepthPrepass(glm::mat4 viewMat, glm::mat4 projection)
+{
+	ScopedGpuTimer timer("Depth prepass");
+	Shader* depthShader = shaders->GetVariant(SHADER_DEPTH, 0);
+	depthShader->Use();
+	glUniformMatrix4fv(glGetUniformLocation(depthShader->program, "projectionMatrix"), 1, GL_FALSE, 
+		glm::value_ptr(projection));
+	glUniformMatrix4fv(glGetUniformLocation(depthShader->program, "viewMatrix"), 1, GL_FALSE, 
+		glm::value_ptr(viewMat));
+	GLint modelLocation = glGetUniformLocation(depthShader->program, "modelMatrix");
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	const std::vector<GameObject*>& objects = gameObjects.GetObjects();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(modelMatrices[i]));
+		objects[i]->GetModel()->Draw(*depthShader, objectLods[i]);
+	}
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
 /// <summary>
 /// Creates a new GameObject for the scene.
 /// </summary>
@@ -106,10 +249,8 @@ void RenderingEngine::RenderAll(glm::mat4 viewMat, glm::mat4 projection)
 GameObject* RenderingEngine::AddGameObject(const std::string& name, Model *model, glm::vec3 position,
 	glm::vec3 rotation, glm::vec3 scale, GameObject* parent, Material *material)
 {
-	GameObject* object = new GameObject(gameObjectCounter++, name, position, rotation, scale, model, 
-		material);
+	GameObject* object = gameObjects.Create(name, position, rotation, scale, model, material);
 	object->SetEngine(this);
-	renderableObjects.push_back(object);
 	//std::cout << "Created GO named " << name << " with address " << object << std::endl;
 	return object;
 }
@@ -117,33 +258,74 @@ GameObject* RenderingEngine::AddGameObject(const std::string& name, Model *model
 void RenderingEngine::MarkGameObjectForDestruction(GameObject* toDestroy)
 {
 	if (!toDestroy->IsBeingDestroyed())
-		objectsToDestroy.push_back(toDestroy);
+		objectsToDestroy.push_back(toDestroy->GetHandle());
 
 }
 
 void RenderingEngine::DestroyGameObjects()
 {
-	std::vector<GameObject*>::iterator it = objectsToDestroy.begin();
-	while (it != objectsToDestroy.end())
+	// The components are released first, to measure them: the gameobjects find none left.
+	DestructionStats stats;
+	for (size_t i = 0; i < objectsToDestroy.size(); i++)
 	{
-		GameObject *go = *it;
-		if (go->IsBeingDestroyed())
-		{
-			renderableObjects.remove(go);
-			//std::cout << "Removed gameobject " << go->GetName() << " from rendering engine." << std::endl;
-		}
-		RigidbodyComponent* rb = static_cast<RigidbodyComponent*>(go->GetComponent(RIGIDBODY_COMPONENT));
-		if (rb != NULL)
-			delete rb;
-		it++;
+		GameObject* go = gameObjects.Get(objectsToDestroy[i]);
+		if (go == NULL)
+			continue;
+		stats.pooledBytes += components.RemoveAll(go->GetId()) + sizeof(GameObject) + TransformHierarchy::GetNodeSize();
+		stats.freedBytes += sizeof(Transform);
+		gameObjects.Destroy(objectsToDestroy[i]);
+		stats.objects++;
 	}
 	objectsToDestroy.clear();
+
+	// The rigidbody components have queued their bodies.
+	if (physics != NULL)
+	{
+		stats.bodies = physics->queuedRemovals.size();
+		stats.freedBytes += physics->RemoveQueuedBodies();
+	}
+
+	lastDestruction = stats;
+	totalDestruction.objects += stats.objects;
+	totalDestruction.bodies += stats.bodies;
+	totalDestruction.pooledBytes += stats.pooledBytes;
+	totalDestruction.freedBytes += stats.freedBytes;
+	peakFreedBytes = std::max(peakFreedBytes, stats.freedBytes);
+}
+
+const DestructionStats& RenderingEngine::GetLastDestruction() { return lastDestruction; }
+
+void RenderingEngine::PrintDestructionReport()
+{
+	std::cout << "INFO::DESTRUCTION:: " << totalDestruction.objects << " gameobjects and " 
+		<< totalDestruction.bodies << " bodies destroyed, " << totalDestruction.pooledBytes / 1024 
+		<< " KB returned to the pools, " << totalDestruction.freedBytes / 1024 << " KB freed (last frame " 
+		<< lastDestruction.objects << " gameobjects, " << lastDestruction.freedBytes << " bytes freed; peak " 
+		<< peakFreedBytes << " bytes in a frame)" << std::endl;
+}
+
+const std::vector<GameObject*>& RenderingEngine::GetGameObjects() { return gameObjects.GetObjects(); }
+
+GameObject* RenderingEngine::GetGameObject(GameObjectHandle handle) { return gameObjects.Get(handle); }
+
+void RenderingEngine::UpdateComponents(int phase, float deltaTime)
+{
+	components.UpdateParallel(phase, deltaTime);
+}
+
+void RenderingEngine::UpdateTransforms()
+{
+	TransformHierarchy::Instance().Update();
+}
+
+void RenderingEngine::StorePreviousTransforms()
+{
+	TransformHierarchy::Instance().StorePreviousPoses();
 }
 
-void RenderingEngine::UpdateComponents(float deltaTime)
+void RenderingEngine::SetInterpolation(float alpha)
 {
-	for (std::list<GameObject*>::iterator it = renderableObjects.begin(); it != renderableObjects.end(); ++it)
-		(*it)->UpdateComponents(deltaTime);
+	interpolationAlpha = glm::clamp(alpha, 0.0f, 1.0f);
 }
 
 /// <summary>
@@ -162,20 +344,17 @@ inline glm::mat4 rotateEuler(glm::mat4 mat, glm::vec3 eulerAngles)
 
 void RenderingEngine::SetPaintable(GameObject* go, bool paintable)
 {
-	renderableObjects.remove(go);
-	paintableObjects.remove(go);
+	// Updates the shader params.
+	PaintableShaderParamSet* sp = static_cast<PaintableShaderParamSet*>(go->GetMaterial()->shaderParams);
 	if (paintable)
 	{
-		paintableObjects.push_back(go);
-		// Updates the shader params.
-		PaintableComponent* pc = static_cast<PaintableComponent*>(go->GetComponent(PAINTABLE_COMPONENT));
-		PaintableShaderParamSet* sp = static_cast<PaintableShaderParamSet*>(go->GetMaterial()->shaderParams);
+		PaintableComponent* pc = go->GetComponent<PaintableComponent>();
 		sp->paintMap = pc->GetPaintMap();
 		sp->isPaintable = 1;
 		sp->paintColor = glm::vec3(0, 1, 0);
 	}
 	else
-		renderableObjects.push_back(go);
+		sp->isPaintable = 0;
 }
 
 void renderQuad()
@@ -13,38 +13,22 @@ RigidbodyComponent::RigidbodyComponent(GameObject* go, PhysicsModule* physicsWor
 	this->physicsWorld = physicsWorld;
 	this->rb = rb;
 	this->collider = this->rb->getCollisionShape();
-	if (go != NULL)
-		this->goTransform = go->GetTransform();
 }
 
 RigidbodyComponent::~RigidbodyComponent()
 {
-	physicsWorld->removeRigidBody(rb);
-	physicsWorld->collisionWorld->removeCollisionObject(rb);
-	delete collider;
-	delete rb;
+	// The body stays in the world, without gameobject, until the end of the destruction pass.
+	PhysicsModule::SetGameObject(rb, GameObjectHandle());
+	physicsWorld->QueueRemoval(rb);
 }
 
 void RigidbodyComponent::OnCreate()
 {
+	GameObject* gameObject = GetGameObject();
 	Transform* tr = gameObject->GetTransform();
 	tr->SetRigidbody(rb);
-	rb->getCollisionShape()->setUserPointer(gameObject);
-}
-
-void RigidbodyComponent::OnUpdate(float deltaTime)
-{
-	btTransform rbTransform;
-	rb->getMotionState()->getWorldTransform(rbTransform);
-	GLfloat modelMat[16];
-	rbTransform.getOpenGLMatrix(modelMat);
-
-	glm::mat4 modelMatrix = glm::make_mat4(modelMat)* glm::scale(modelMatrix, goTransform->GetAbsoluteScale());
-	btVector3 rbCoM = rb->getCenterOfMassTransform().getOrigin();
-	goTransform->SetAbsolutePosition(glm::vec3(rbCoM.getX(), rbCoM.getY(), rbCoM.getZ()));
-	btQuaternion btQuat = rbTransform.getRotation();
-	glm::vec3 newRotation = quat2euler(glm::fquat(btQuat.getW(), btQuat.getX(), btQuat.getY(), btQuat.getZ()));
-	//goTransform->SetAbsoluteRotation(newRotation);
+	PhysicsModule::SetGameObject(rb, gameObject->GetHandle());
+	PhysicsModule::CopyPose(rb, tr);
 }
 
 glm::vec3 RigidbodyComponent::GetLinearVelocity()
@@ -0,0 +1,483 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include "Scene.hpp"
+#include "AssetRegistry.hpp"
+#include "MappedFile.hpp"
+#include "PaintableComponent.h"
+#include "PhysicsModule.h"
+#include "RenderingEngine.hpp"
+#include "RigidbodyComponent.h"
+#include "SelfMovingComponent.h"
+#include "ShaderCache.hpp"
+#include "StainSet.h"
+#include "TextureStreamer.hpp"
+
+// Tags the compiled scenes, followed by the version, the source hash and the counts.
+#define SCENE_BINARY_MAGIC 0x50475343
+
+// The header of a compiled scene, followed by the string table and the arrays of records, each
+// starting at a multiple of 4 bytes.
+struct SceneHeader
+{
+	GLuint magic, version;
+	GLuint sourceHash[2];
+	// Stored as floats so that the header can be copied bytewise.
+	float lightPosition[3];
+	GLuint stringBytes, nModels, nTextures, nMaterials, nObjects;
+};
+
+static size_t Align4(size_t size) { return (size + 3) & ~(size_t)3; }
+
+// The offsets of the arrays of a compiled scene, and of its end.
+struct SceneLayout
+{
+	size_t strings, models, textures, materials, objects, end;
+};
+
+static SceneLayout GetLayout(const SceneHeader& header)
+{
+	SceneLayout layout;
+	layout.strings = Align4(sizeof(SceneHeader));
+	layout.models = layout.strings + Align4(header.stringBytes);
+	layout.textures = layout.models + header.nModels * sizeof(SceneAssetRecord);
+	layout.materials = layout.textures + header.nTextures * sizeof(SceneAssetRecord);
+	layout.objects = layout.materials + header.nMaterials * sizeof(SceneMaterialRecord);
+	layout.end = layout.objects + header.nObjects * sizeof(SceneObjectRecord);
+	return layout;
+}
+
+// Reads a vector after a property, returning false if missing.
+static bool ReadVector(std::stringstream& stream, glm::vec3& value)
+{
+	return (bool)(stream >> value.x >> value.y >> value.z);
+}
+
+bool SceneDescription::Parse(const std::string& text)
+{
+	std::map<std::string, GLuint> modelNames, textureNames, materialNames;
+	std::map<std::string, GLuint> stringOffsets;
+	auto AddString = [this, &stringOffsets](const std::string& value)
+	{
+		// The same model and texture paths are stored once.
+		auto found = stringOffsets.find(value);
+		if (found != stringOffsets.end())
+			return found->second;
+		const GLuint offset = (GLuint)strings.size();
+		strings.append(value).push_back('\0');
+		stringOffsets[value] = offset;
+		return offset;
+	};
+
+	// The object being declared, completed when the next declaration starts.
+	enum { NONE, MATERIAL, OBJECT } current = NONE;
+	glm::vec3 bodyOffset;
+	bool hasBodyRotation = false, hasBodySize = false;
+	auto FinishObject = [&]()
+	{
+		if (current != OBJECT)
+			return;
+		SceneObjectRecord& object = objects.back();
+		object.bodyPosition = object.position + bodyOffset;
+		if (!hasBodyRotation)
+			object.bodyRotation = object.rotation;
+		if (!hasBodySize)
+			object.bodySize = object.scale;
+	};
+
+	lightPosition = glm::vec3(0.0f);
+	std::stringstream lines(text);
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(lines, line))
+	{
+		lineNumber++;
+		std::stringstream stream(line);
+		std::string command;
+		if (!(stream >> command) || command[0] == '#')
+			continue;
+
+		bool valid = true;
+		if (command == "light")
+			valid = ReadVector(stream, lightPosition);
+		else if (command == "model" || command == "texture")
+		{
+			std::string name, path, usage = "color";
+			valid = (bool)(stream >> name >> path);
+			stream >> usage;
+			SceneAssetRecord asset;
+			asset.path = AddString(path);
+			asset.usage = usage == "normal" ? TEXTURE_USAGE_NORMAL_MAP :
+				usage == "data" ? TEXTURE_USAGE_DATA : TEXTURE_USAGE_COLOR;
+			std::map<std::string, GLuint>& names = command == "model" ? modelNames : textureNames;
+			if (valid && names.count(name) != 0)
+			{
+				std::cout << "ERROR::SCENE:: duplicate " << command << " name at line " << lineNumber << ": " <<
+					name << std::endl;
+				return false;
+			}
+			if (command == "model")
+			{
+				modelNames[name] = (GLuint)models.size();
+				models.push_back(asset);
+			}
+			else
+			{
+				textureNames[name] = (GLuint)textures.size();
+				textures.push_back(asset);
+			}
+		}
+		else if (command == "material")
+		{
+			FinishObject();
+			std::string name;
+			valid = (bool)(stream >> name);
+			if (valid && materialNames.count(name) != 0)
+			{
+				std::cout << "ERROR::SCENE:: duplicate material name at line " << lineNumber << ": " << name <<
+					std::endl;
+				return false;
+			}
+			materialNames[name] = (GLuint)materials.size();
+			// The defaults of PaintableBlinnPhongTexturingShaderParamSet.
+			SceneMaterialRecord material;
+			material.diffuseTexture = material.normalMap = -1;
+			material.diffuseColor = material.ambientColor = material.specularColor = glm::vec3(0.0f);
+			material.Kd = 0.8f;
+			material.Ka = 0.1f;
+			material.Ks = 0.5f;
+			material.shininess = 25.0f;
+			material.repeat = glm::vec2(30.0f, 30.0f);
+			material.lightPosition = lightPosition;
+			materials.push_back(material);
+			current = MATERIAL;
+		}
+		else if (command == "object")
+		{
+			FinishObject();
+			std::string name, model, material;
+			valid = (bool)(stream >> name >> model >> material) && modelNames.count(model) > 0
+				&& materialNames.count(material) > 0;
+			SceneObjectRecord object;
+			object.name = AddString(name);
+			object.model = valid ? modelNames[model] : 0;
+			object.material = valid ? materialNames[material] : 0;
+			object.position = object.rotation = glm::vec3(0.0f);
+			object.scale = glm::vec3(1.0f);
+			object.bodyShape = SCENE_BODY_NONE;
+			object.bodyPosition = object.bodyRotation = object.bodySize = glm::vec3(0.0f);
+			object.mass = 0.0f;
+			object.friction = object.restitution = 0.3f;
+			object.paintMapSize = 0;
+			object.moveDisplacement = glm::vec3(0.0f);
+			object.moveSpeed = 0.0f;
+			objects.push_back(object);
+			bodyOffset = glm::vec3(0.0f);
+			hasBodyRotation = hasBodySize = false;
+			current = OBJECT;
+		}
+		else if (current == MATERIAL)
+		{
+			SceneMaterialRecord& material = materials.back();
+			if (command == "diffuse_texture" || command == "normal_map")
+			{
+				std::string texture;
+				valid = (bool)(stream >> texture) && textureNames.count(texture) > 0;
+				(command == "diffuse_texture" ? material.diffuseTexture : material.normalMap) =
+					valid ? (GLint)textureNames[texture] : -1;
+			}
+			else if (command == "diffuse_color")
+				valid = ReadVector(stream, material.diffuseColor);
+			else if (command == "ambient_color")
+				valid = ReadVector(stream, material.ambientColor);
+			else if (command == "specular_color")
+				valid = ReadVector(stream, material.specularColor);
+			else if (command == "kd")
+				valid = (bool)(stream >> material.Kd);
+			else if (command == "ka")
+				valid = (bool)(stream >> material.Ka);
+			else if (command == "ks")
+				valid = (bool)(stream >> material.Ks);
+			else if (command == "shininess")
+				valid = (bool)(stream >> material.shininess);
+			else if (command == "repeat")
+				valid = (bool)(stream >> material.repeat.x >> material.repeat.y);
+			else if (command == "light_position")
+				valid = ReadVector(stream, material.lightPosition);
+			else
+				valid = false;
+		}
+		else if (current == OBJECT)
+		{
+			SceneObjectRecord& object = objects.back();
+			if (command == "position")
+				valid = ReadVector(stream, object.position);
+			else if (command == "rotation")
+				valid = ReadVector(stream, object.rotation);
+			else if (command == "scale")
+				valid = ReadVector(stream, object.scale);
+			else if (command == "body")
+			{
+				std::string shape;
+				stream >> shape;
+				object.bodyShape = shape == "box" ? SCENE_BODY_BOX : shape == "sphere" ? SCENE_BODY_SPHERE :
+					shape == "plane" ? SCENE_BODY_PLANE : shape == "cylinder" ? SCENE_BODY_CYLINDER : SCENE_BODY_NONE;
+				valid = object.bodyShape != SCENE_BODY_NONE;
+			}
+			else if (command == "body_offset")
+				valid = ReadVector(stream, bodyOffset);
+			else if (command == "body_rotation")
+				valid = hasBodyRotation = ReadVector(stream, object.bodyRotation);
+			else if (command == "body_size")
+				valid = hasBodySize = ReadVector(stream, object.bodySize);
+			else if (command == "mass")
+				valid = (bool)(stream >> object.mass);
+			else if (command == "friction")
+				valid = (bool)(stream >> object.friction);
+			else if (command == "restitution")
+				valid = (bool)(stream >> object.restitution);
+			else if (command == "paintable")
+				valid = (bool)(stream >> object.paintMapSize);
+			else if (command == "moves")
+				valid = ReadVector(stream, object.moveDisplacement) && (bool)(stream >> object.moveSpeed);
+			else
+				valid = false;
+		}
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			std::cout << "ERROR::SCENE:: invalid command at line " << lineNumber << ": " << line << std::endl;
+			return false;
+		}
+	}
+	FinishObject();
+	return true;
+}
+
+// Appends the bytes of a value or an array to the blob.
+static void AppendBytes(std::vector<unsigned char>& blob, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	blob.insert(blob.end(), bytes, bytes + size);
+	blob.resize(Align4(blob.size()), 0);
+}
+
+template <typename T> static void AppendArray(std::vector<unsigned char>& blob, const std::vector<T>& values)
+{
+	if (!values.empty())
+		AppendBytes(blob, &values[0], values.size() * sizeof(T));
+}
+
+void SceneDescription::Compile(unsigned long long sourceHash, std::vector<unsigned char>& blob) const
+{
+	SceneHeader header;
+	header.magic = SCENE_BINARY_MAGIC;
+	header.version = SCENE_BINARY_VERSION;
+	memcpy(header.sourceHash, &sourceHash, sizeof(sourceHash));
+	header.lightPosition[0] = lightPosition.x;
+	header.lightPosition[1] = lightPosition.y;
+	header.lightPosition[2] = lightPosition.z;
+	header.stringBytes = (GLuint)strings.size();
+	header.nModels = (GLuint)models.size();
+	header.nTextures = (GLuint)textures.size();
+	header.nMaterials = (GLuint)materials.size();
+	header.nObjects = (GLuint)objects.size();
+
+	blob.clear();
+	AppendBytes(blob, &header, sizeof(header));
+	AppendBytes(blob, strings.data(), strings.size());
+	AppendArray(blob, models);
+	AppendArray(blob, textures);
+	AppendArray(blob, materials);
+	AppendArray(blob, objects);
+}
+
+Scene::Scene()
+{
+}
+
+Scene::~Scene()
+{
+}
+
+bool Scene::Load(const std::string& path, RenderingEngine* engine, PhysicsModule* physics, ShaderSet* shaders,
+	StainSet* stainSet, GLint perlinNoise, unsigned int meshFlags)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	const Clock::time_point start = Clock::now();
+	const std::string binaryPath = path + SCENE_BINARY_EXTENSION;
+
+	// The text is only read to check that the compiled file is up to date.
+	std::ifstream textFile(path, std::ios::binary);
+	std::string text;
+	bool hasText = (bool)textFile;
+	if (hasText)
+		text.assign(std::istreambuf_iterator<char>(textFile), std::istreambuf_iterator<char>());
+	const unsigned long long sourceHash = HashFNV1a(text.data(), text.size());
+
+	MappedFile file;
+	if (file.Open(binaryPath) && file.GetSize() >= sizeof(SceneHeader))
+	{
+		SceneHeader header;
+		memcpy(&header, file.GetData(), sizeof(header));
+		unsigned long long hash;
+		memcpy(&hash, header.sourceHash, sizeof(hash));
+		if (header.magic == SCENE_BINARY_MAGIC && header.version == SCENE_BINARY_VERSION &&
+			(!hasText || hash == sourceHash) &&
+			Instantiate(file.GetData(), file.GetSize(), engine, physics, shaders, stainSet, perlinNoise, meshFlags))
+		{
+			std::cout << "INFO::SCENE:: " << objects.size() << " objects loaded from " << binaryPath << " in " <<
+				std::chrono::duration<double, std::milli>(Clock::now() - start).count() << " ms" << std::endl;
+			return true;
+		}
+	}
+	file.Close();
+	if (!hasText)
+	{
+		std::cout << "ERROR::SCENE:: cannot read " << path << std::endl;
+		return false;
+	}
+
+	// Compiles the text, keeping the compiled scene for the next runs.
+	SceneDescription description;
+	if (!description.Parse(text))
+		return false;
+	std::vector<unsigned char> blob;
+	description.Compile(sourceHash, blob);
+	if (!WriteFileAtomically(binaryPath, &blob[0], blob.size()))
+		std::cout << "ERROR::SCENE:: cannot write " << binaryPath << std::endl;
+
+	if (!Instantiate(&blob[0], blob.size(), engine, physics, shaders, stainSet, perlinNoise, meshFlags))
+		return false;
+	std::cout << "INFO::SCENE:: " << objects.size() << " objects compiled from " << path << " and loaded in " <<
+		std::chrono::duration<double, std::milli>(Clock::now() - start).count() << " ms" << std::endl;
+	return true;
+}
+
+bool Scene::Validate(const unsigned char* data, size_t size, GLint maxTextureSize)
+{
+	// Checks that the arrays lie within the file and that the records only refer to valid entries.
+	SceneHeader header;
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+	const SceneLayout layout = GetLayout(header);
+	if (layout.end > size || (header.stringBytes > 0 && data[layout.strings + header.stringBytes - 1] != '\0'))
+		return false;
+
+	const SceneAssetRecord* modelRecords = reinterpret_cast<const SceneAssetRecord*>(data + layout.models);
+	const SceneAssetRecord* textureRecords = reinterpret_cast<const SceneAssetRecord*>(data + layout.textures);
+	const SceneMaterialRecord* materialRecords = reinterpret_cast<const SceneMaterialRecord*>(data + layout.materials);
+	const SceneObjectRecord* objectRecords = reinterpret_cast<const SceneObjectRecord*>(data + layout.objects);
+	for (GLuint i = 0; i < header.nModels; i++)
+		if (modelRecords[i].path >= header.stringBytes)
+			return false;
+	for (GLuint i = 0; i < header.nTextures; i++)
+		if (textureRecords[i].path >= header.stringBytes)
+			return false;
+	for (GLuint i = 0; i < header.nMaterials; i++)
+		if (materialRecords[i].diffuseTexture >= (GLint)header.nTextures ||
+			materialRecords[i].normalMap >= (GLint)header.nTextures)
+			return false;
+	for (GLuint i = 0; i < header.nObjects; i++)
+	{
+		const SceneObjectRecord& record = objectRecords[i];
+		if (record.name >= header.stringBytes || record.model >= header.nModels ||
+			record.material >= header.nMaterials || record.bodyShape < SCENE_BODY_NONE ||
+			record.bodyShape > SCENE_BODY_CYLINDER || !(record.mass >= 0.0f) || record.paintMapSize < 0 ||
+			record.paintMapSize > maxTextureSize)
+			return false;
+	}
+	return true;
+}
+
+bool Scene::Instantiate(const unsigned char* data, size_t size, RenderingEngine* engine, PhysicsModule* physics,
+	ShaderSet* shaders, StainSet* stainSet, GLint perlinNoise, unsigned int meshFlags)
+{
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	if (!Validate(data, size, maxTextureSize))
+		return false;
+
+	SceneHeader header;
+	memcpy(&header, data, sizeof(header));
+	const SceneLayout layout = GetLayout(header);
+	const char* strings = reinterpret_cast<const char*>(data + layout.strings);
+	const SceneAssetRecord* modelRecords = reinterpret_cast<const SceneAssetRecord*>(data + layout.models);
+	const SceneAssetRecord* textureRecords = reinterpret_cast<const SceneAssetRecord*>(data + layout.textures);
+	const SceneMaterialRecord* materialRecords = reinterpret_cast<const SceneMaterialRecord*>(data + layout.materials);
+	const SceneObjectRecord* objectRecords = reinterpret_cast<const SceneObjectRecord*>(data + layout.objects);
+
+	// The models are imported in parallel, the textures streamed in the background.
+	AssetRegistry& assets = AssetRegistry::Instance();
+	std::vector<std::string> modelPaths(header.nModels);
+	for (GLuint i = 0; i < header.nModels; i++)
+		modelPaths[i] = strings + modelRecords[i].path;
+	std::vector<Model*> models = assets.AcquireModels(modelPaths, meshFlags);
+	std::vector<GLint> textures(header.nTextures);
+	for (GLuint i = 0; i < header.nTextures; i++)
+		textures[i] = (GLint)assets.AcquireTexture(strings + textureRecords[i].path, textureRecords[i].usage);
+
+	// The materials are never reallocated: the gameobjects point to them.
+	lightPosition = glm::vec3(header.lightPosition[0], header.lightPosition[1], header.lightPosition[2]);
+	objects.reserve(header.nObjects);
+	materials.reserve(header.nObjects);
+	materialParams.reserve(header.nObjects);
+	Shader* shader = &shaders->availableShaders[SHADER_BLINN_PHONG];
+	Shader* paintMapShader = &shaders->availableShaders[SHADER_PAINTMAP];
+	for (GLuint i = 0; i < header.nObjects; i++)
+	{
+		const SceneObjectRecord& record = objectRecords[i];
+		const SceneMaterialRecord& materialRecord = materialRecords[record.material];
+		materialParams.push_back(PaintableBlinnPhongTexturingShaderParamSet());
+		PaintableBlinnPhongTexturingShaderParamSet& params = materialParams.back();
+		params.diffuseTexture = materialRecord.diffuseTexture >= 0 ? textures[materialRecord.diffuseTexture] : -1;
+		params.normalMap = materialRecord.normalMap >= 0 ? textures[materialRecord.normalMap] : -1;
+		params.perlinNoise = perlinNoise;
+		params.diffuseColor = materialRecord.diffuseColor;
+		params.ambientColor = materialRecord.ambientColor;
+		params.specularColor = materialRecord.specularColor;
+		params.Kd = materialRecord.Kd;
+		params.Ka = materialRecord.Ka;
+		params.Ks = materialRecord.Ks;
+		params.shininess = materialRecord.shininess;
+		params.repeat = materialRecord.repeat;
+		params.pointLightPosition = materialRecord.lightPosition;
+		materials.push_back(Material(shader));
+		materials.back().shaderParams = &params;
+
+		// The transforms take degrees, the bodies radians.
+		GameObject* object = engine->AddGameObject(strings + record.name, models[record.model], record.position,
+			glm::degrees(record.rotation), record.scale, nullptr, &materials.back());
+		if (record.bodyShape != SCENE_BODY_NONE)
+		{
+			btRigidBody* rb = physics->createRigidBody(record.bodyShape, record.bodyPosition, record.bodySize,
+				record.bodyRotation, record.mass, record.friction, record.restitution);
+			object->AddComponent<RigidbodyComponent>(physics, rb);
+		}
+		if (record.paintMapSize > 0)
+			object->AddComponent<PaintableComponent>(paintMapShader, stainSet, record.paintMapSize);
+		if (record.moveSpeed != 0.0f)
+			object->AddComponent<SelfMovingComponent>(record.moveDisplacement, record.moveSpeed);
+		objects.push_back(object);
+	}
+	return true;
+}
+
+glm::vec3 Scene::GetLightPosition() const { return lightPosition; }
+
+const std::vector<GameObject*>& Scene::GetObjects() const { return objects; }
+
+GameObject* Scene::Find(const std::string& name) const
+{
+	for (size_t i = 0; i < objects.size(); i++)
+		if (objects[i]->GetName() == name)
+			return objects[i];
+	return NULL;
+}
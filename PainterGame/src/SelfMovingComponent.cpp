@@ -5,7 +5,6 @@
 SelfMovingComponent::SelfMovingComponent(GameObject* gameObject, 
 	glm::vec3 displacement, float speed) : AComponent(gameObject, SELFMOVING_COMPONENT)
 {
-	rb = static_cast<RigidbodyComponent*>(gameObject->GetComponent(RIGIDBODY_COMPONENT));
 	beginPosition = gameObject->GetTransform()->GetAbsolutePosition();
 	endPosition = beginPosition + displacement;
 	currentDestination = endPosition;
@@ -18,8 +17,13 @@ SelfMovingComponent::~SelfMovingComponent()
 {
 }
 
-void SelfMovingComponent::OnUpdate(float deltaTime)
+void SelfMovingComponent::OnFixedUpdate(float deltaTime)
 {
+	// The rigidbody is looked up on every tick, as it may be replaced or destroyed.
+	GameObject* gameObject = GetGameObject();
+	RigidbodyComponent* rb = gameObject != NULL ? gameObject->GetComponent<RigidbodyComponent>() : NULL;
+	if (rb == NULL)
+		return;
 	glm::vec3 currentPosition = gameObject->GetTransform()->GetAbsolutePosition();
 	t += deltaTime * speed;
 	if (t > 1)
@@ -0,0 +1,300 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "ShaderCache.hpp"
+
+// Tags the binary files, followed by the binary format and size.
+#define SHADER_CACHE_MAGIC 0x50475342
+
+unsigned long long HashFNV1a(const void* data, size_t size, unsigned long long hash)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+ShaderCache& ShaderCache::Instance()
+{
+	static ShaderCache instance;
+	return instance;
+}
+
+ShaderCache::ShaderCache()
+{
+	// The cache is created after the context: the driver can be queried.
+	std::stringstream driver;
+	driver << glGetString(GL_VENDOR) << "|" << glGetString(GL_RENDERER) << "|" << glGetString(GL_VERSION);
+	driverString = driver.str();
+
+	GLint nFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+	binariesSupported = nFormats > 0;
+
+#ifdef _WIN32
+	_mkdir(SHADER_CACHE_DIRECTORY);
+#else
+	mkdir(SHADER_CACHE_DIRECTORY, 0755);
+#endif
+}
+
+GLuint ShaderCache::GetProgram(const std::string& vertexPath, const std::string& fragmentPath,
+	const std::string& defines)
+{
+	std::vector<ShaderStage> stages(2);
+	stages[0].type = GL_VERTEX_SHADER;
+	stages[0].path = vertexPath;
+	stages[1].type = GL_FRAGMENT_SHADER;
+	stages[1].path = fragmentPath;
+	return GetProgram(stages, defines);
+}
+
+GLuint ShaderCache::GetComputeProgram(const std::string& computePath, const std::string& defines)
+{
+	std::vector<ShaderStage> stages(1);
+	stages[0].type = GL_COMPUTE_SHADER;
+	stages[0].path = computePath;
+	return GetProgram(stages, defines);
+}
+
+GLuint ShaderCache::GetProgram(const std::vector<ShaderStage>& stages, const std::string& defines)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point begin = Clock::now();
+
+	ProgramEntry request;
+	for (size_t i = 0; i < stages.size(); i++)
+		request.name += (i > 0 ? " + " : "") + stages[i].path;
+	if (!defines.empty())
+		request.name += " [" + defines + "]";
+
+	// The same sources have already been requested.
+	std::map<std::string, ProgramEntry>::iterator it = programs.find(request.name);
+	if (it != programs.end())
+	{
+		it->second.references++;
+		request.program = it->second.program;
+		request.origin = PROGRAM_SHARED;
+		request.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+		requests.push_back(request);
+		return request.program;
+	}
+
+	// Each define becomes a directive of the sources.
+	std::string directives, define;
+	std::stringstream defineStream(defines);
+	while (defineStream >> define)
+	{
+		size_t equals = define.find('=');
+		if (equals != std::string::npos)
+			define[equals] = ' ';
+		directives += "#define " + define + "\n";
+	}
+
+	// The binary is keyed by the sources and by the driver that produced it.
+	std::vector<std::string> sources;
+	unsigned long long hash = HashFNV1a(driverString.data(), driverString.size());
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		sources.push_back(ReadSource(stages[i].path, directives));
+		hash = HashFNV1a(sources[i].data(), sources[i].size(), hash);
+	}
+	char key[17];
+	snprintf(key, sizeof(key), "%016llx", hash);
+
+	request.program = binariesSupported ? LoadBinary(key) : 0;
+	request.origin = PROGRAM_BINARY;
+	if (request.program == 0)
+	{
+		request.program = CompileProgram(stages, sources);
+		request.origin = PROGRAM_COMPILED;
+		if (binariesSupported)
+			StoreBinary(key, request.program);
+	}
+	request.references = 1;
+	request.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+	programs[request.name] = request;
+	requests.push_back(request);
+	return request.program;
+}
+
+void ShaderCache::ReleaseProgram(GLuint program)
+{
+	for (std::map<std::string, ProgramEntry>::iterator it = programs.begin(); it != programs.end(); ++it)
+		if (it->second.program == program)
+		{
+			if (--it->second.references == 0)
+			{
+				glDeleteProgram(program);
+				programs.erase(it);
+			}
+			return;
+		}
+}
+
+void ShaderCache::PrintReport()
+{
+	const char* origins[] = { "compiled", "cache hit", "shared" };
+	double total = 0.0;
+	std::cout << "| -- Shader programs startup ---------------------------- -- |" << std::endl;
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		std::cout << "| " << requests[i].name << ": " << origins[requests[i].origin] << ", "
+			<< requests[i].milliseconds << " ms" << std::endl;
+		total += requests[i].milliseconds;
+	}
+	std::cout << "| Total: " << total << " ms" << std::endl;
+	std::cout << "| -- --------------------------------------------------- -- |" << std::endl;
+}
+
+std::string ShaderCache::ReadSource(const std::string& path, const std::string& directives)
+{
+	std::ifstream file;
+	// Reads file content and manages errors with exceptions.
+	file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	try
+	{
+		file.open(path);
+		std::stringstream stream;
+		stream << file.rdbuf();
+		file.close();
+		std::string source = stream.str();
+
+		// The #version directive must stay the first statement of the source.
+		size_t insertion = 0;
+		size_t version = source.find("#version");
+		if (version != std::string::npos)
+		{
+			insertion = source.find('\n', version);
+			insertion = insertion == std::string::npos ? source.size() : insertion + 1;
+		}
+		return source.insert(insertion, directives);
+	}
+	catch (std::ifstream::failure e)
+	{
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+	}
+	return std::string();
+}
+
+GLuint ShaderCache::CompileProgram(const std::vector<ShaderStage>& stages, 
+	const std::vector<std::string>& sources)
+{
+	// Creates Shader Program, asking the driver to keep its binary retrievable.
+	GLuint program = glCreateProgram();
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	std::vector<GLuint> shaders;
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		const GLchar* code = sources[i].c_str();
+		GLuint shader = glCreateShader(stages[i].type);
+		glShaderSource(shader, 1, &code, NULL);
+		glCompileShader(shader);
+		CheckCompileErrors(shader, stages[i].type == GL_VERTEX_SHADER ? "VERTEX" : 
+			stages[i].type == GL_FRAGMENT_SHADER ? "FRAGMENT" : "COMPUTE");
+		glAttachShader(program, shader);
+		shaders.push_back(shader);
+	}
+	glLinkProgram(program);
+	CheckCompileErrors(program, "PROGRAM");
+
+	// Shaders have been linked: delete them.
+	for (size_t i = 0; i < shaders.size(); i++)
+		glDeleteShader(shaders[i]);
+	return program;
+}
+
+GLuint ShaderCache::LoadBinary(const std::string& key)
+{
+	std::ifstream file(std::string(SHADER_CACHE_DIRECTORY) + "/" + key + ".bin", std::ios::binary);
+	if (!file)
+		return 0;
+
+	GLuint magic = 0;
+	GLenum format = 0;
+	GLint length = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&format), sizeof(format));
+	file.read(reinterpret_cast<char*>(&length), sizeof(length));
+	if (!file || magic != SHADER_CACHE_MAGIC || length <= 0)
+		return 0;
+	std::vector<char> binary(length);
+	file.read(&binary[0], length);
+	if (!file)
+		return 0;
+
+	// The driver may still reject the binary (e.g. after an update): falls back to compiling.
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, format, &binary[0], length);
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+void ShaderCache::StoreBinary(const std::string& key, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, NULL, &format, &binary[0]);
+
+	std::ofstream file(std::string(SHADER_CACHE_DIRECTORY) + "/" + key + ".bin", std::ios::binary);
+	GLuint magic = SHADER_CACHE_MAGIC;
+	file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+	file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+	file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+	file.write(&binary[0], length);
+}
+
+// Compile error check.
+void ShaderCache::CheckCompileErrors(GLuint shader, std::string type)
+{
+	GLint success;
+	// Buffer for error messages.
+	GLchar infoLog[1024];
+	if (type != "PROGRAM")
+	{
+		// Gets the shader's compile status.
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			// If an error occurred then retrieve it and print it.
+			glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+			std::cout << "| ERROR::::SHADER-COMPILATION-ERROR of type: " << type << "|\n" << infoLog << "\n| -- --------------------------------------------------- -- |" << std::endl;
+		}
+	}
+	else
+	{
+		// Gets the shader's linking status.
+		glGetProgramiv(shader, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			// If an error occurred then retrieve it and print it.
+			glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+			std::cout << "| ERROR::::PROGRAM-LINKING-ERROR of type: " << type << "|\n" << infoLog << "\n| -- --------------------------------------------------- -- |" << std::endl;
+		}
+	}
+}
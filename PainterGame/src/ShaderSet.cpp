@@ -1,4 +1,8 @@
+#include <sstream>
+
 #include "ShaderSet.hpp"
+#include "LightManager.hpp"
+#include "ShadowSystem.hpp"
 
 ShaderSet::ShaderSet()
 {
@@ -15,4 +19,57 @@ ShaderSet::ShaderSet()
 	availableShaders.push_back(Shader("shaders/lambertian_texturing.vert",
 		"shaders/lambert.frag", SHADER_LAMBERT));
 	availableShaders.push_back(Shader("shaders/ui.vert", "shaders/ui.frag", SHADER_UI));
-}
\ No newline at end of file
+	availableShaders.push_back(Shader("shaders/depth.vert", "shaders/depth.frag", SHADER_DEPTH));
+
+	supportedFeatures = std::vector<unsigned int>(availableShaders.size(), 0);
+	supportedFeatures[SHADER_BLINN_PHONG] = SHADER_FEATURE_TEXTURE | SHADER_FEATURE_NORMAL_MAP | 
+		SHADER_FEATURE_PAINTABLE | SHADER_FEATURE_TILED_LIGHTS | SHADER_FEATURE_POINT_SHADOWS | 
+		SHADER_FEATURE_CASCADED_SHADOWS;
+}
+
+Shader* ShaderSet::GetVariant(int shaderId, unsigned int features)
+{
+	features &= supportedFeatures[shaderId];
+	if (features == 0)
+		return &availableShaders[shaderId];
+
+	std::pair<int, unsigned int> key(shaderId, features);
+	std::map<std::pair<int, unsigned int>, Shader*>::iterator it = variants.find(key);
+	if (it != variants.end())
+		return it->second;
+
+	// Translates the feature bits to the macros tested by the sources.
+	std::stringstream macros;
+	if (features & SHADER_FEATURE_TEXTURE)
+		macros << "USE_TEXTURE ";
+	if (features & SHADER_FEATURE_NORMAL_MAP)
+		macros << "USE_NORMAL_MAP ";
+	if (features & SHADER_FEATURE_PAINTABLE)
+		macros << "PAINTABLE ";
+	if (features & SHADER_FEATURE_TILED_LIGHTS)
+		macros << "TILED_LIGHTS LIGHT_TILE_SIZE=" << LIGHT_TILE_SIZE << " MAX_LIGHTS_PER_TILE=" 
+			<< MAX_LIGHTS_PER_TILE << " ";
+	if (features & SHADER_FEATURE_POINT_SHADOWS)
+		macros << "POINT_SHADOWS ";
+	if (features & SHADER_FEATURE_CASCADED_SHADOWS)
+		macros << "CASCADED_SHADOWS SHADOW_CASCADE_COUNT=" << SHADOW_CASCADE_COUNT << " ";
+	std::string defines = macros.str();
+	defines.pop_back();
+
+	const Shader& base = availableShaders[shaderId];
+	Shader* variant = new Shader(base.vertexPath.c_str(), base.fragmentPath.c_str(), shaderId, defines);
+	variants[key] = variant;
+	return variant;
+}
+
+void ShaderSet::Delete()
+{
+	for (size_t i = 0; i < availableShaders.size(); i++)
+		availableShaders[i].Delete();
+	for (std::map<std::pair<int, unsigned int>, Shader*>::iterator it = variants.begin(); it != variants.end(); ++it)
+	{
+		it->second->Delete();
+		delete it->second;
+	}
+	variants.clear();
+}
@@ -0,0 +1,386 @@
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <map>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "ShadowSystem.hpp"
+#include "ShaderCache.hpp"
+#include "ShaderSet.hpp"
+#include "RigidbodyComponent.h"
+#include "Profiler.hpp"
+
+// Returns true if the box is at least partially on the positive side of all the clip planes.
+bool IsBoxInFrustum(const glm::mat4& viewProjection, glm::vec3 boxMin, glm::vec3 boxMax);
+
+// Returns true if the object moves, so that its shadow cannot be cached.
+bool IsMovingCaster(GameObject* go);
+
+ShadowSystem::ShadowSystem()
+{
+	depthShader = new Shader("shaders/shadow_depth.vert", "shaders/depth.frag", SHADER_SHADOW_DEPTH);
+
+	glGenTextures(1, &staticMaps);
+	glGenTextures(1, &shadowMaps);
+	glGenFramebuffers(1, &shadowFBO);
+	glGenBuffers(1, &instanceBuffer);
+}
+
+void ShadowSystem::SetPointLight(glm::vec3 position)
+{
+	lightType = SHADOW_LIGHT_POINT;
+	lightPosition = position;
+
+	// One view for each face of a cube, ordered as +X, -X, +Y, -Y, +Z, -Z.
+	const glm::vec3 axes[6] = { glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+		glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1) };
+	const glm::vec3 ups[6] = { glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+		glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0) };
+	glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_POINT_NEAR,
+		SHADOW_POINT_FAR);
+	AllocateViews(6);
+	for (int i = 0; i < 6; i++)
+		views[i].viewProjection = faceProjection * glm::lookAt(position, position + axes[i], ups[i]);
+}
+
+void ShadowSystem::SetDirectionalLight(glm::vec3 direction)
+{
+	lightType = SHADOW_LIGHT_DIRECTIONAL;
+	lightDirection = glm::normalize(direction);
+	// The cascades follow the camera: their matrices are computed at each frame.
+	AllocateViews(SHADOW_CASCADE_COUNT);
+}
+
+int ShadowSystem::GetLightType() { return lightType; }
+
+unsigned int ShadowSystem::GetShaderFeature()
+{
+	if (lightType == SHADOW_LIGHT_POINT)
+		return SHADER_FEATURE_POINT_SHADOWS;
+	if (lightType == SHADOW_LIGHT_DIRECTIONAL)
+		return SHADER_FEATURE_CASCADED_SHADOWS;
+	return 0;
+}
+
+void ShadowSystem::AllocateViews(size_t nViews)
+{
+	views = std::vector<ShadowView>(nViews);
+	for (size_t i = 0; i < nViews; i++)
+	{
+		views[i].staticValid = false;
+		views[i].staticSignature = 0;
+		views[i].hadMovingCasters = false;
+	}
+
+	GLuint textures[2] = { staticMaps, shadowMaps };
+	for (int i = 0; i < 2; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textures[i]);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE,
+			(GLsizei)nViews, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		// Linear filtering with depth comparison gives a 2x2 percentage closer filter.
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		// Outside the maps everything is lit.
+		GLfloat border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void ShadowSystem::UpdateCascades(const glm::mat4& view, const glm::mat4& projection)
+{
+	// Splits [near, SHADOW_DISTANCE] blending the logarithmic and the uniform schemes.
+	float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+	{
+		float fraction = (float)(i + 1) / SHADOW_CASCADE_COUNT;
+		float logSplit = nearPlane * std::pow(SHADOW_DISTANCE / nearPlane, fraction);
+		float uniformSplit = nearPlane + (SHADOW_DISTANCE - nearPlane) * fraction;
+		cascadeSplits[i] = SHADOW_SPLIT_LAMBDA * logSplit + (1.0f - SHADOW_SPLIT_LAMBDA) * uniformSplit;
+	}
+
+	glm::mat4 cameraToWorld = glm::inverse(view);
+	float tanX = 1.0f / projection[0][0], tanY = 1.0f / projection[1][1];
+	glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+	glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+
+	float sliceNear = nearPlane;
+	for (int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+	{
+		float sliceFar = cascadeSplits[i];
+		// The bounding sphere of the slice does not change with the camera's orientation:
+		// its radius is constant and the cascade only translates.
+		float centerDepth = (sliceNear + sliceFar) * 0.5f;
+		glm::vec3 nearCorner(sliceNear * tanX, sliceNear * tanY, -sliceNear);
+		glm::vec3 farCorner(sliceFar * tanX, sliceFar * tanY, -sliceFar);
+		glm::vec3 center(0.0f, 0.0f, -centerDepth);
+		float radius = glm::max(glm::length(nearCorner - center), glm::length(farCorner - center));
+
+		// The center moves by whole cells, and the cascade grows by a cell to still contain
+		// the slice.
+		float texelSize = 2.0f * radius / SHADOW_MAP_SIZE;
+		float cell = texelSize * SHADOW_CACHE_SNAP_TEXELS;
+		radius += cell;
+		glm::vec3 lightCenter = glm::vec3(lightRotation * cameraToWorld * glm::vec4(center, 1.0f));
+		lightCenter = glm::floor(lightCenter / cell) * cell;
+
+		glm::mat4 cascade = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+			lightCenter.y - radius, lightCenter.y + radius,
+			-lightCenter.z - SHADOW_DEPTH_RANGE, -lightCenter.z + SHADOW_DEPTH_RANGE) * lightRotation;
+		if (cascade != views[i].viewProjection)
+		{
+			views[i].viewProjection = cascade;
+			views[i].staticValid = false;
+		}
+		sliceNear = sliceFar;
+	}
+}
+
+void ShadowSystem::BuildDraws(const std::vector<GameObject*>& objects, const std::vector<glm::mat4>& modelMatrices)
+{
+	// Instances of the same model visible in the same view are drawn together.
+	typedef std::map<Model*, std::vector<glm::mat4>> Batches;
+	std::vector<Batches> staticBatches(views.size()), movingBatches(views.size());
+	// The static casters of each view, batched only for the layers to render again.
+	std::vector<std::vector<size_t>> staticCasters(views.size());
+	std::vector<unsigned long long> signatures(views.size(), 0);
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		GameObject* go = objects[i];
+		Model* model = go->GetModel();
+		const glm::mat4& modelMatrix = modelMatrices[i];
+
+		// The world bounds of the object, from the corners of the model's bounds.
+		glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+		for (int c = 0; c < 8; c++)
+		{
+			glm::vec3 corner((c & 1) ? model->boundsMax.x : model->boundsMin.x,
+				(c & 2) ? model->boundsMax.y : model->boundsMin.y,
+				(c & 4) ? model->boundsMax.z : model->boundsMin.z);
+			glm::vec3 world = glm::vec3(modelMatrix * glm::vec4(corner, 1.0f));
+			boxMin = glm::min(boxMin, world);
+			boxMax = glm::max(boxMax, world);
+		}
+
+		bool moving = IsMovingCaster(go);
+		unsigned long long casterHash = 0;
+		if (!moving)
+		{
+			// Summed, so that the signature does not depend on the order of the objects.
+			GameObjectHandle handle = go->GetHandle();
+			casterHash = HashFNV1a(&handle, sizeof(handle));
+			casterHash = HashFNV1a(&model, sizeof(model), casterHash);
+			casterHash = HashFNV1a(&modelMatrix, sizeof(modelMatrix), casterHash);
+		}
+		for (size_t v = 0; v < views.size(); v++)
+		{
+			if (!IsBoxInFrustum(views[v].viewProjection, boxMin, boxMax))
+				continue;
+			if (moving)
+				movingBatches[v][model].push_back(modelMatrix);
+			else
+			{
+				staticCasters[v].push_back(i);
+				signatures[v] += casterHash;
+			}
+		}
+	}
+
+	for (size_t v = 0; v < views.size(); v++)
+	{
+		if (signatures[v] != views[v].staticSignature)
+		{
+			views[v].staticSignature = signatures[v];
+			views[v].staticValid = false;
+		}
+		if (views[v].staticValid)
+			continue;
+		for (size_t c = 0; c < staticCasters[v].size(); c++)
+		{
+			const size_t i = staticCasters[v][c];
+			staticBatches[v][objects[i]->GetModel()].push_back(modelMatrices[i]);
+		}
+	}
+
+	instances.clear();
+	draws.clear();
+	for (size_t v = 0; v < views.size(); v++)
+	{
+		views[v].staticDraws.clear();
+		views[v].movingDraws.clear();
+		for (int moving = 0; moving < 2; moving++)
+		{
+			Batches& batches = moving ? movingBatches[v] : staticBatches[v];
+			for (Batches::iterator it = batches.begin(); it != batches.end(); ++it)
+			{
+				ShadowDraw draw;
+				draw.model = it->first;
+				draw.offset = (GLint)instances.size();
+				draw.count = (GLsizei)it->second.size();
+				instances.insert(instances.end(), it->second.begin(), it->second.end());
+				(moving ? views[v].movingDraws : views[v].staticDraws).push_back(draws.size());
+				draws.push_back(draw);
+			}
+		}
+	}
+
+	// A single upload for all the views.
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+	if (instances.size() > instanceCapacity)
+	{
+		instanceCapacity = instances.size() * 2;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, instanceCapacity * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+	}
+	if (!instances.empty())
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, instances.size() * sizeof(glm::mat4), &instances[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ShadowSystem::Render(const std::vector<GameObject*>& objects, const std::vector<glm::mat4>& modelMatrices,
+	const glm::mat4& view, const glm::mat4& projection)
+{
+	if (lightType == SHADOW_LIGHT_NONE)
+		return;
+
+	{
+		ScopedCpuTimer timer("Shadow culling");
+		if (lightType == SHADOW_LIGHT_DIRECTIONAL)
+			UpdateCascades(view, projection);
+		BuildDraws(objects, modelMatrices);
+	}
+
+	ScopedGpuTimer timer("Shadow pass");
+	frames++;
+	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+	glViewport(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+	// Depth only: no color attachment.
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	// Slope scaled bias against shadow acne.
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+	depthShader->Use();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SHADOW_INSTANCE_BINDING, instanceBuffer);
+
+	for (size_t v = 0; v < views.size(); v++)
+	{
+		ShadowView& shadowView = views[v];
+		bool refresh = !shadowView.staticValid;
+		if (!shadowView.staticValid)
+		{
+			RenderDraws(staticMaps, (int)v, shadowView.viewProjection, shadowView.staticDraws);
+			shadowView.staticValid = true;
+			staticRenders++;
+		}
+
+		// The moving casters of the last frame must be erased as well.
+		bool hasMovingCasters = !shadowView.movingDraws.empty();
+		if (refresh || hasMovingCasters || shadowView.hadMovingCasters)
+		{
+			glCopyImageSubData(staticMaps, GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)v,
+				shadowMaps, GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)v, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1);
+			if (hasMovingCasters)
+			{
+				RenderDraws(shadowMaps, (int)v, shadowView.viewProjection, shadowView.movingDraws);
+				movingRenders++;
+			}
+		}
+		shadowView.hadMovingCasters = hasMovingCasters;
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowSystem::RenderDraws(GLuint texture, int layer, const glm::mat4& viewProjection,
+	const std::vector<size_t>& drawIndices)
+{
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+	if (texture == staticMaps)
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+	glUniformMatrix4fv(glGetUniformLocation(depthShader->program, "lightMatrix"), 1, GL_FALSE,
+		glm::value_ptr(viewProjection));
+	GLint offsetLocation = glGetUniformLocation(depthShader->program, "instanceOffset");
+	for (size_t i = 0; i < drawIndices.size(); i++)
+	{
+		const ShadowDraw& draw = draws[drawIndices[i]];
+		glUniform1i(offsetLocation, draw.offset);
+		draw.model->DrawInstanced(draw.count);
+	}
+}
+
+void ShadowSystem::LoadUniforms(GLuint program)
+{
+	std::vector<glm::mat4> matrices(views.size());
+	for (size_t i = 0; i < views.size(); i++)
+		matrices[i] = views[i].viewProjection;
+	glUniformMatrix4fv(glGetUniformLocation(program, "shadowMatrices"), (GLsizei)views.size(), GL_FALSE,
+		glm::value_ptr(matrices[0]));
+
+	// The lighting follows the light casting the shadows. A directional light is a point light
+	// far away in the opposite direction.
+	glm::vec3 position = lightType == SHADOW_LIGHT_POINT ? lightPosition : -lightDirection * 10000.0f;
+	glUniform3fv(glGetUniformLocation(program, "pointLightPosition"), 1, glm::value_ptr(position));
+	if (lightType == SHADOW_LIGHT_POINT)
+		glUniform3fv(glGetUniformLocation(program, "shadowLightPosition"), 1, glm::value_ptr(lightPosition));
+	else
+		glUniform1fv(glGetUniformLocation(program, "cascadeSplits"), SHADOW_CASCADE_COUNT, cascadeSplits);
+
+	glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_UNIT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMaps);
+	glUniform1i(glGetUniformLocation(program, "shadowMap"), SHADOW_MAP_UNIT);
+}
+
+void ShadowSystem::PrintReport()
+{
+	if (frames == 0)
+		return;
+	std::cout << "INFO::SHADOWS:: " << views.size() << " views, " << frames << " frames: "
+		<< staticRenders << " static renders, " << movingRenders << " refreshes with moving casters ("
+		<< (double)movingRenders / frames << " views per frame)" << std::endl;
+}
+
+void ShadowSystem::Delete()
+{
+	glDeleteTextures(1, &staticMaps);
+	glDeleteTextures(1, &shadowMaps);
+	glDeleteFramebuffers(1, &shadowFBO);
+	glDeleteBuffers(1, &instanceBuffer);
+	depthShader->Delete();
+	delete depthShader;
+}
+
+bool IsBoxInFrustum(const glm::mat4& viewProjection, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+	// The planes are the sums and differences of the last row with the other rows.
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i],
+			viewProjection[3][i]);
+	for (int p = 0; p < 6; p++)
+	{
+		glm::vec4 plane = rows[3] + (p % 2 == 0 ? rows[p / 2] : -rows[p / 2]);
+		// The corner of the box farthest along the plane's normal.
+		glm::vec3 corner(plane.x > 0 ? boxMax.x : boxMin.x, plane.y > 0 ? boxMax.y : boxMin.y,
+			plane.z > 0 ? boxMax.z : boxMin.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+			return false;
+	}
+	return true;
+}
+
+bool IsMovingCaster(GameObject* go)
+{
+	if (go->GetComponent(SELFMOVING_COMPONENT) != NULL || go->GetComponent(PAINT_BALL_COMPONENT) != NULL)
+		return true;
+	RigidbodyComponent* rb = go->GetComponent<RigidbodyComponent>();
+	return rb != NULL && !rb->rb->isStaticOrKinematicObject();
+}
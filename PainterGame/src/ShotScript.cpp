@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "ShotScript.hpp"
+
+// Frames between two shots of the default script.
+#define DEFAULT_SHOT_INTERVAL 15
+
+bool ShotScript::Load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cout << "ERROR::SCRIPT:: cannot read " << path << std::endl;
+		return false;
+	}
+
+	cameraKeys.clear();
+	shotFrames.clear();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::stringstream stream(line);
+		std::string command;
+		if (!(stream >> command) || command[0] == '#')
+			continue;
+
+		if (command == "frames")
+			stream >> frameCount;
+		else if (command == "camera")
+		{
+			CameraKey key;
+			stream >> key.frame >> key.position.x >> key.position.y >> key.position.z 
+				>> key.yaw >> key.pitch;
+			cameraKeys.push_back(key);
+		}
+		else if (command == "shoot")
+		{
+			int frame;
+			stream >> frame;
+			shotFrames.insert(frame);
+		}
+		else
+			std::cout << "WARNING::SCRIPT:: unknown command " << command << std::endl;
+	}
+
+	std::sort(cameraKeys.begin(), cameraKeys.end(), 
+		[](const CameraKey& a, const CameraKey& b) { return a.frame < b.frame; });
+	return true;
+}
+
+void ShotScript::CreateDefault(int frameCount)
+{
+	this->frameCount = frameCount;
+	cameraKeys.clear();
+	shotFrames.clear();
+
+	// Turns around the center of the arena, looking slightly down to hit the floor too.
+	for (int i = 0; i <= 4; i++)
+	{
+		CameraKey key;
+		key.frame = frameCount * i / 4;
+		key.position = glm::vec3(0.0f, 2.0f, 0.0f);
+		key.yaw = -90.0f + 90.0f * i;
+		key.pitch = i % 2 == 0 ? 0.0f : -15.0f;
+		cameraKeys.push_back(key);
+	}
+	for (int frame = DEFAULT_SHOT_INTERVAL; frame < frameCount; frame += DEFAULT_SHOT_INTERVAL)
+		shotFrames.insert(frame);
+}
+
+void ShotScript::GetCameraPose(int frame, glm::vec3& position, float& yaw, float& pitch) const
+{
+	if (cameraKeys.empty())
+		return;
+
+	// Finds the keys around the frame.
+	size_t next = 0;
+	while (next < cameraKeys.size() && cameraKeys[next].frame < frame)
+		next++;
+	const CameraKey& b = cameraKeys[std::min(next, cameraKeys.size() - 1)];
+	const CameraKey& a = cameraKeys[next == 0 ? 0 : next - 1];
+
+	float t = b.frame > a.frame ? (float)(frame - a.frame) / (float)(b.frame - a.frame) : 1.0f;
+	t = std::min(std::max(t, 0.0f), 1.0f);
+	position = glm::mix(a.position, b.position, t);
+	yaw = glm::mix(a.yaw, b.yaw, t);
+	pitch = glm::mix(a.pitch, b.pitch, t);
+}
+
+bool ShotScript::IsShotFrame(int frame) const
+{
+	return shotFrames.count(frame) > 0;
+}
+
+size_t ShotScript::GetShotCount() const
+{
+	return shotFrames.size();
+}
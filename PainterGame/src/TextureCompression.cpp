@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "TextureCompression.hpp"
+
+// Reads the 4x4 block at the given block coordinates, repeating the edge pixels of the images
+// whose size is not a multiple of 4.
+static void FetchBlock(const unsigned char* rgba, int width, int height, int bx, int by, 
+	unsigned char block[16][4])
+{
+	for (int y = 0; y < 4; y++)
+		for (int x = 0; x < 4; x++)
+		{
+			int px = std::min(bx * 4 + x, width - 1), py = std::min(by * 4 + y, height - 1);
+			const unsigned char* pixel = rgba + (py * width + px) * 4;
+			for (int c = 0; c < 4; c++)
+				block[y * 4 + x][c] = pixel[c];
+		}
+}
+
+static unsigned short PackRGB565(const float color[3])
+{
+	int r = (int)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	int g = (int)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+	int b = (int)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(unsigned short packed, int color[3])
+{
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// Encodes the colors of a block in the four-color mode: the endpoints are the extremes of 
+// the pixels along the principal axis of their distribution.
+static void EncodeColorBlock(unsigned char block[16][4], unsigned char* output)
+{
+	float mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+		for (int c = 0; c < 3; c++)
+			mean[c] += block[i][c] / 16.0f;
+	float covariance[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+		covariance[0] += d[0] * d[0]; covariance[1] += d[0] * d[1]; covariance[2] += d[0] * d[2];
+		covariance[3] += d[1] * d[1]; covariance[4] += d[1] * d[2]; covariance[5] += d[2] * d[2];
+	}
+	// Power iterations converge to the principal axis.
+	float axis[3] = { 1, 1, 1 };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[3] = {
+			covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+			covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+			covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2] };
+		float length = std::max(std::abs(next[0]), std::max(std::abs(next[1]), std::abs(next[2])));
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	int minPixel = 0, maxPixel = 0;
+	float minProjection = 1e30f, maxProjection = -1e30f;
+	for (int i = 0; i < 16; i++)
+	{
+		float projection = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+		if (projection < minProjection) { minProjection = projection; minPixel = i; }
+		if (projection > maxProjection) { maxProjection = projection; maxPixel = i; }
+	}
+	float maxColor[3] = { (float)block[maxPixel][0], (float)block[maxPixel][1], (float)block[maxPixel][2] };
+	float minColor[3] = { (float)block[minPixel][0], (float)block[minPixel][1], (float)block[minPixel][2] };
+	unsigned short color0 = PackRGB565(maxColor), color1 = PackRGB565(minColor);
+	// The four-color mode requires color0 > color1.
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	unsigned int indices = 0;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestDistance = INT_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], 
+					db = block[i][2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance) { bestDistance = distance; best = p; }
+			}
+			indices |= best << (2 * i);
+		}
+	}
+
+	output[0] = color0 & 0xff; output[1] = color0 >> 8;
+	output[2] = color1 & 0xff; output[3] = color1 >> 8;
+	for (int b = 0; b < 4; b++)
+		output[4 + b] = (indices >> (8 * b)) & 0xff;
+}
+
+// Encodes a channel of a block in the eight-value mode of BC4 (the alpha of BC3, and each
+// channel of BC5).
+static void EncodeChannelBlock(unsigned char block[16][4], int channel, unsigned char* output)
+{
+	int maxValue = 0, minValue = 255;
+	for (int i = 0; i < 16; i++)
+	{
+		maxValue = std::max(maxValue, (int)block[i][channel]);
+		minValue = std::min(minValue, (int)block[i][channel]);
+	}
+
+	unsigned long long indices = 0;
+	if (maxValue != minValue)
+	{
+		int palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int p = 1; p < 7; p++)
+			palette[p + 1] = ((7 - p) * maxValue + p * minValue) / 7;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestDistance = INT_MAX;
+			for (int p = 0; p < 8; p++)
+			{
+				int distance = std::abs(block[i][channel] - palette[p]);
+				if (distance < bestDistance) { bestDistance = distance; best = p; }
+			}
+			indices |= (unsigned long long)best << (3 * i);
+		}
+	}
+
+	output[0] = (unsigned char)maxValue;
+	output[1] = (unsigned char)minValue;
+	for (int b = 0; b < 6; b++)
+		output[2 + b] = (indices >> (8 * b)) & 0xff;
+}
+
+std::vector<unsigned char> CompressBC1(const unsigned char* rgba, int width, int height)
+{
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	std::vector<unsigned char> output(blocksX * blocksY * BC1_BLOCK_BYTES);
+	unsigned char block[16][4];
+	for (int by = 0; by < blocksY; by++)
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			FetchBlock(rgba, width, height, bx, by, block);
+			EncodeColorBlock(block, &output[(by * blocksX + bx) * BC1_BLOCK_BYTES]);
+		}
+	return output;
+}
+
+std::vector<unsigned char> CompressBC3(const unsigned char* rgba, int width, int height)
+{
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	std::vector<unsigned char> output(blocksX * blocksY * BC3_BLOCK_BYTES);
+	unsigned char block[16][4];
+	for (int by = 0; by < blocksY; by++)
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			FetchBlock(rgba, width, height, bx, by, block);
+			unsigned char* blockOutput = &output[(by * blocksX + bx) * BC3_BLOCK_BYTES];
+			EncodeChannelBlock(block, 3, blockOutput);
+			EncodeColorBlock(block, blockOutput + 8);
+		}
+	return output;
+}
+
+std::vector<unsigned char> CompressBC5(const unsigned char* rgba, int width, int height)
+{
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	std::vector<unsigned char> output(blocksX * blocksY * BC5_BLOCK_BYTES);
+	unsigned char block[16][4];
+	for (int by = 0; by < blocksY; by++)
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			FetchBlock(rgba, width, height, bx, by, block);
+			unsigned char* blockOutput = &output[(by * blocksX + bx) * BC5_BLOCK_BYTES];
+			EncodeChannelBlock(block, 0, blockOutput);
+			EncodeChannelBlock(block, 1, blockOutput + 8);
+		}
+	return output;
+}
+
+std::vector<unsigned char> DownsampleRGBA(const unsigned char* rgba, int width, int height, 
+	bool normalMap)
+{
+	int halfWidth = std::max(width / 2, 1), halfHeight = std::max(height / 2, 1);
+	std::vector<unsigned char> output(halfWidth * halfHeight * 4);
+	for (int y = 0; y < halfHeight; y++)
+		for (int x = 0; x < halfWidth; x++)
+		{
+			// The 2x2 footprint, clamped for the dimensions that are already 1.
+			int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+			int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+			float sum[4] = { 0, 0, 0, 0 };
+			const int xs[2] = { x0, x1 }, ys[2] = { y0, y1 };
+			for (int j = 0; j < 2; j++)
+				for (int i = 0; i < 2; i++)
+					for (int c = 0; c < 4; c++)
+						sum[c] += rgba[(ys[j] * width + xs[i]) * 4 + c] / 4.0f;
+
+			if (normalMap)
+			{
+				float n[3];
+				for (int c = 0; c < 3; c++)
+					n[c] = sum[c] / 127.5f - 1.0f;
+				float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length > 1e-6f)
+					for (int c = 0; c < 3; c++)
+						sum[c] = (n[c] / length + 1.0f) * 127.5f;
+			}
+			for (int c = 0; c < 4; c++)
+				output[(y * halfWidth + x) * 4 + c] = (unsigned char)std::min(sum[c] + 0.5f, 255.0f);
+		}
+	return output;
+}
+
+size_t GetImageSize(GLenum format, int width, int height)
+{
+	size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+	switch (format)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		return blocks * BC1_BLOCK_BYTES;
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		return blocks * BC3_BLOCK_BYTES;
+	case GL_COMPRESSED_RG_RGTC2:
+		return blocks * BC5_BLOCK_BYTES;
+	default:
+		return (size_t)width * height * 4;
+	}
+}
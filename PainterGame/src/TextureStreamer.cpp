@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Library for image loading.
+#include <stb_image\stb_image.h>
+
+#include "TextureStreamer.hpp"
+#include "TextureCompression.hpp"
+#include "ShaderCache.hpp"
+#include "Profiler.hpp"
+
+// Tags the cache files, followed by the version, the format and the levels.
+#define TEXTURE_CACHE_MAGIC 0x50475458
+
+TextureStreamer& TextureStreamer::Instance()
+{
+	static TextureStreamer instance;
+	return instance;
+}
+
+TextureStreamer::TextureStreamer()
+{
+	// The streamer is created after the context: the driver can be queried.
+	s3tcSupported = GLEW_EXT_texture_compression_s3tc != 0;
+	glGenBuffers(STREAMING_PBO_COUNT, pbos);
+
+#ifdef _WIN32
+	_mkdir(TEXTURE_CACHE_DIRECTORY);
+#else
+	mkdir(TEXTURE_CACHE_DIRECTORY, 0755);
+#endif
+
+	// Leaves a core to the main thread.
+	unsigned int nWorkers = std::max(1u, std::min(4u, std::thread::hardware_concurrency() - 1));
+	for (unsigned int i = 0; i < nWorkers; i++)
+		workers.push_back(std::thread(&TextureStreamer::WorkerLoop, this));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		if (workers[i].joinable())
+			workers[i].join();
+}
+
+GLuint TextureStreamer::Request(const std::string& path, int usage)
+{
+	if (pending == 0)
+		firstRequest = std::chrono::high_resolution_clock::now();
+
+	// Until the first mips are resident the texture is a single neutral texel: grey, a flat
+	// normal, or zero for the data.
+	const unsigned char placeholders[3][4] = { { 128, 128, 128, 255 }, { 128, 128, 255, 255 },
+		{ 0, 0, 0, 0 } };
+	StreamedTexture* texture = new StreamedTexture();
+	glGenTextures(1, &texture->id);
+	glBindTexture(GL_TEXTURE_2D, texture->id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholders[usage]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	texture->path = path;
+	texture->usage = usage;
+	texture->fromCache = false;
+	texture->released = false;
+	inFlight[texture->id] = texture;
+	pending++;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(texture);
+	}
+	jobAvailable.notify_one();
+	return texture->id;
+}
+
+void TextureStreamer::WorkerLoop()
+{
+	while (true)
+	{
+		StreamedTexture* texture;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			texture = jobs.front();
+			jobs.pop_front();
+		}
+
+		Load(texture);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(texture);
+	}
+}
+
+void TextureStreamer::Load(StreamedTexture* texture)
+{
+	std::ifstream file(texture->path, std::ios::binary);
+	std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (bytes.empty())
+	{
+		std::cout << "ERROR::TEXTURE:: Failed to read " << texture->path << std::endl;
+		return;
+	}
+
+	// The cache is keyed by the content of the image and by how it is transcoded.
+	int settings[3] = { texture->usage, TEXTURE_CACHE_VERSION, s3tcSupported ? 1 : 0 };
+	unsigned long long hash = HashFNV1a(&bytes[0], bytes.size());
+	hash = HashFNV1a(settings, sizeof(settings), hash);
+	std::stringstream key;
+	key << std::hex << hash;
+	if (LoadCache(key.str(), texture))
+	{
+		texture->fromCache = true;
+		return;
+	}
+
+	int width, height, channels;
+	unsigned char* image = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(&bytes[0]),
+		(int)bytes.size(), &width, &height, &channels, STBI_rgb_alpha);
+	if (image == nullptr)
+	{
+		std::cout << "ERROR::TEXTURE:: Failed to decode " << texture->path << std::endl;
+		return;
+	}
+
+	bool hasAlpha = channels == 2 || channels == 4;
+	if (texture->usage == TEXTURE_USAGE_NORMAL_MAP)
+		texture->format = GL_COMPRESSED_RG_RGTC2;
+	else if (texture->usage == TEXTURE_USAGE_DATA || !s3tcSupported)
+		texture->format = GL_RGBA8;
+	else
+		texture->format = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+	// Builds the whole mip chain, down to 1x1.
+	std::vector<unsigned char> pixels(image, image + width * height * 4);
+	stbi_image_free(image);
+	while (true)
+	{
+		TextureLevel level;
+		level.width = width;
+		level.height = height;
+		switch (texture->format)
+		{
+		case GL_COMPRESSED_RG_RGTC2:
+			level.data = CompressBC5(&pixels[0], width, height);
+			break;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			level.data = CompressBC3(&pixels[0], width, height);
+			break;
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+			level.data = CompressBC1(&pixels[0], width, height);
+			break;
+		default:
+			level.data = pixels;
+		}
+		texture->levels.push_back(level);
+
+		if (width == 1 && height == 1)
+			break;
+		pixels = DownsampleRGBA(&pixels[0], width, height, texture->usage == TEXTURE_USAGE_NORMAL_MAP);
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	StoreCache(key.str(), texture);
+}
+
+bool TextureStreamer::LoadCache(const std::string& key, StreamedTexture* texture)
+{
+	std::ifstream file(std::string(TEXTURE_CACHE_DIRECTORY) + "/" + key + ".tex", std::ios::binary);
+	if (!file)
+		return false;
+
+	GLuint magic = 0;
+	GLint version = 0, nLevels = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&texture->format), sizeof(texture->format));
+	file.read(reinterpret_cast<char*>(&nLevels), sizeof(nLevels));
+	if (!file || magic != TEXTURE_CACHE_MAGIC || version != TEXTURE_CACHE_VERSION || nLevels <= 0)
+		return false;
+
+	std::vector<TextureLevel> levels(nLevels);
+	for (int i = 0; i < nLevels; i++)
+	{
+		GLint size = 0;
+		file.read(reinterpret_cast<char*>(&levels[i].width), sizeof(levels[i].width));
+		file.read(reinterpret_cast<char*>(&levels[i].height), sizeof(levels[i].height));
+		file.read(reinterpret_cast<char*>(&size), sizeof(size));
+		if (!file || size != (GLint)GetImageSize(texture->format, levels[i].width, levels[i].height))
+			return false;
+		levels[i].data.resize(size);
+		file.read(reinterpret_cast<char*>(&levels[i].data[0]), size);
+	}
+	if (!file)
+		return false;
+
+	texture->levels.swap(levels);
+	return true;
+}
+
+void TextureStreamer::StoreCache(const std::string& key, const StreamedTexture* texture)
+{
+	std::ofstream file(std::string(TEXTURE_CACHE_DIRECTORY) + "/" + key + ".tex", std::ios::binary);
+	GLuint magic = TEXTURE_CACHE_MAGIC;
+	GLint version = TEXTURE_CACHE_VERSION, nLevels = (GLint)texture->levels.size();
+	file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+	file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+	file.write(reinterpret_cast<const char*>(&texture->format), sizeof(texture->format));
+	file.write(reinterpret_cast<const char*>(&nLevels), sizeof(nLevels));
+	for (int i = 0; i < nLevels; i++)
+	{
+		const TextureLevel& level = texture->levels[i];
+		GLint size = (GLint)level.data.size();
+		file.write(reinterpret_cast<const char*>(&level.width), sizeof(level.width));
+		file.write(reinterpret_cast<const char*>(&level.height), sizeof(level.height));
+		file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		file.write(reinterpret_cast<const char*>(&level.data[0]), size);
+	}
+}
+
+void TextureStreamer::Update(int maxLevels)
+{
+	if (pending == 0)
+		return;
+	ScopedCpuTimer timer("Texture streaming");
+
+	std::deque<StreamedTexture*> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.swap(decoded);
+	}
+
+	// The smallest mips are uploaded at once: the texture can be sampled from this frame.
+	for (size_t i = 0; i < ready.size(); i++)
+	{
+		StreamedTexture* texture = ready[i];
+		if (texture->released || texture->levels.empty())
+		{
+			// Deleted, or failed: the placeholder stays.
+			Complete(texture);
+			continue;
+		}
+
+		for (size_t l = 0; l < texture->levels.size(); l++)
+			uncompressedBytes += (size_t)texture->levels[l].width * texture->levels[l].height * 4;
+		if (texture->fromCache)
+			cacheHits++;
+		glBindTexture(GL_TEXTURE_2D, texture->id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture->levels.size() - 1);
+		texture->nextLevel = (int)texture->levels.size() - 1;
+		while (texture->nextLevel > 0 && std::max(texture->levels[texture->nextLevel].width,
+			texture->levels[texture->nextLevel].height) <= STREAMING_INITIAL_SIZE)
+			UploadLevel(texture, texture->nextLevel--);
+		uploading.push_back(texture);
+	}
+
+	// Then the larger mips, one texture after the other.
+	int nUploaded = 0;
+	while (nUploaded < maxLevels && !uploading.empty())
+	{
+		StreamedTexture* texture = uploading.front();
+		if (!texture->released)
+		{
+			UploadLevel(texture, texture->nextLevel--);
+			nUploaded++;
+		}
+		if (texture->released || texture->nextLevel < 0)
+		{
+			uploading.erase(uploading.begin());
+			if (!texture->released)
+				loadedTextures++;
+			Complete(texture);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (pending == 0)
+		PrintReport();
+}
+
+void TextureStreamer::Complete(StreamedTexture* texture)
+{
+	if (texture->released)
+		glDeleteTextures(1, &texture->id);
+	inFlight.erase(texture->id);
+	pending--;
+	delete texture;
+}
+
+void TextureStreamer::Delete(GLuint texture)
+{
+	std::map<GLuint, StreamedTexture*>::iterator it = inFlight.find(texture);
+	if (it != inFlight.end())
+		it->second->released = true;
+	else
+		glDeleteTextures(1, &texture);
+}
+
+void TextureStreamer::UploadLevel(StreamedTexture* texture, int level)
+{
+	TextureLevel& data = texture->levels[level];
+	GLsizeiptr size = (GLsizeiptr)data.data.size();
+
+	// Orphans the buffer: the driver copies from it while the next one is filled.
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+	nextPbo = (nextPbo + 1) % STREAMING_PBO_COUNT;
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	memcpy(mapped, &data.data[0], size);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glBindTexture(GL_TEXTURE_2D, texture->id);
+	if (texture->format == GL_RGBA8)
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, data.width, data.height, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, 0);
+	else
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, texture->format, data.width, data.height, 0,
+			(GLsizei)size, 0);
+	// Only the resident levels are sampled.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	residentBytes += size;
+	std::vector<unsigned char>().swap(data.data);
+}
+
+void TextureStreamer::Finish()
+{
+	while (!IsIdle())
+	{
+		Update(INT_MAX);
+		if (!IsIdle())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+bool TextureStreamer::IsIdle() { return pending == 0; }
+
+void TextureStreamer::PrintReport()
+{
+	double loadTime = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - firstRequest).count();
+	std::cout << "INFO::TEXTURES:: " << loadedTextures << " textures resident after " << loadTime
+		<< " ms (" << cacheHits << " from cache): " << residentBytes / 1024 << " KB ("
+		<< uncompressedBytes / 1024 << " KB as RGBA8)" << std::endl;
+}
+
+void TextureStreamer::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		if (workers[i].joinable())
+			workers[i].join();
+	glDeleteBuffers(STREAMING_PBO_COUNT, pbos);
+}
@@ -5,6 +5,7 @@
 #include <glm\gtc\matrix_transform.hpp>
 
 #include "Transform.hpp"
+#include "TransformHierarchy.hpp"
 #include "RigidbodyComponent.h"
 
 #define DEG2RAD 0.0174533f
@@ -12,9 +13,8 @@
 // Basic constructor with default values.
 Transform::Transform()
 {
-	this->position = glm::vec3(0, 0, 0);
-	this->rotation = glm::vec3(0, 0, 0);
-	this->scale = glm::vec3(1, 1, 1);
+	node = TransformHierarchy::Instance().Add(TRANSFORM_NO_NODE, glm::vec3(0, 0, 0), glm::fquat(), 
+		glm::vec3(1, 1, 1));
 }
 
 // Customizable constructor
@@ -23,36 +23,34 @@ Transform::Transform(const glm::vec3 position = glm::vec3(0, 0, 0),
 	const glm::vec3 scale = glm::vec3(1, 1, 1), 
 	Transform* parent = nullptr)
 {
-	this->position = position;
-	this->rotation = rotation;
-	this->scale = scale;
-	this->parent = parent;
+	node = TransformHierarchy::Instance().Add(parent != nullptr ? parent->node : TRANSFORM_NO_NODE, 
+		position, euler2quat(rotation * DEG2RAD), scale);
+}
+
+Transform::~Transform()
+{
+	TransformHierarchy::Instance().Remove(node);
 }
 
 void Transform::SetRigidbody(btRigidBody* rb)
 {
 	this->rb = rb;
+	TransformHierarchy::Instance().Detach(node);
 }
 
-
-// Updates the transformation matrix with the 
 glm::mat4 Transform::GetTransformMatrix()
 {
-	if (rb != NULL)
-	{
-		btTransform btTr; 
-		rb->getMotionState()->getWorldTransform(btTr);
-		GLfloat modelMatrix[16];
-		btTr.getOpenGLMatrix(modelMatrix);
-		glm::mat4 trMat = glm::mat4(1.0f);
-		trMat = glm::make_mat4(modelMatrix) * glm::scale(trMat, scale);
-		return trMat;
-	}
-	glm::mat4 translation = glm::translate(glm::mat4(), this->position);
-	glm::mat4 rotation = glm::mat4_cast(euler2quat(this->rotation * DEG2RAD));
-	glm::mat4 scaling = glm::scale(glm::mat4(), this->scale);
-	glm::mat4 trMatrix = translation * rotation * scaling;
-	return trMatrix;
+	return TransformHierarchy::Instance().GetWorldMatrix(node);
+}
+
+glm::mat4 Transform::GetInterpolatedMatrix(float alpha)
+{
+	return TransformHierarchy::Instance().GetInterpolatedMatrix(node, alpha);
+}
+
+bool Transform::IsDirty() const
+{
+	return TransformHierarchy::Instance().IsDirty(node);
 }
 
 
@@ -71,82 +69,83 @@ inline glm::mat4 Transform::rotateEuler(glm::mat4 mat, glm::vec3 eulerAngles)
 }
 
 // Basic getters
-inline glm::vec3 Transform::GetLocalPosition()
+glm::vec3 Transform::GetLocalPosition()
 {
-	return this->position;
+	return TransformHierarchy::Instance().GetLocalPosition(node);
 }
-inline glm::vec3 Transform::GetLocalRotation()
+glm::vec3 Transform::GetLocalRotation()
 {
-	return this->rotation;
+	return quat2euler(TransformHierarchy::Instance().GetLocalRotation(node)) / DEG2RAD;
 }
-inline glm::vec3 Transform::GetLocalScale()
+glm::vec3 Transform::GetLocalScale()
 {
-	return this->scale;
+	return TransformHierarchy::Instance().GetLocalScale(node);
 }
 
 // Absolute getters
 glm::vec3 Transform::GetAbsolutePosition()
 {
-	glm::vec3 absPos = this->position;
-	for (Transform* p = this->parent; p != nullptr; p = p->parent)
-		absPos += p->position;
-	return absPos;
+	return TransformHierarchy::Instance().GetWorldPosition(node);
 }
 
 void Transform::SetAbsolutePosition(glm::vec3 newPosition)
 {
-	// Computes the new abs position with the displacement from the current abs position.
-	glm::vec3 displacement = newPosition - GetAbsolutePosition();
-	position += displacement;
+	TransformHierarchy::Instance().SetWorldPosition(node, newPosition);
 }
 
 glm::vec3 Transform::GetAbsoluteRotation()
 {
-	glm::vec3 absRot = this->rotation;
-	for (Transform* p = this->parent; p != nullptr; p = p->parent)
-		absRot += p->rotation;
-	return absRot;
+	return quat2euler(GetAbsoluteRotationQuaternion()) / DEG2RAD;
 }
 
 glm::fquat Transform::GetAbsoluteRotationQuaternion()
 {
-	return euler2quat(GetAbsoluteRotation() * DEG2RAD);
+	return TransformHierarchy::Instance().GetWorldRotation(node);
 }
 
 void Transform::SetAbsoluteRotation(glm::vec3 newRotation)
 {
-	glm::vec3 displacement = newRotation - GetAbsoluteRotation();
-	rotation += displacement;
+	SetAbsoluteRotation(euler2quat(newRotation * DEG2RAD));
+}
+
+void Transform::SetAbsoluteRotation(glm::fquat newRotation)
+{
+	TransformHierarchy::Instance().SetWorldRotation(node, newRotation);
 }
 
 glm::vec3 Transform::GetAbsoluteScale()
 {
-	glm::vec3 absScale = { this->scale.x, this->scale.y, this->scale.z };
-	for (Transform* p = this->parent; p != nullptr; p = p->parent)
-		absScale = { absScale.x * p->scale.x, absScale.y * p->scale.y, absScale.z * p->scale.z };
-	return absScale;
+	return TransformHierarchy::Instance().GetWorldScale(node);
 }
 
 // Local setters
-inline void Transform::SetLocalPosition(const glm::vec3 newPos)
+void Transform::SetLocalPosition(const glm::vec3 newPos)
+{
+	TransformHierarchy::Instance().SetLocalPosition(node, newPos);
+}
+void Transform::SetLocalRotation(const glm::vec3 newRot)
 {
-	this->position = newPos;
+	SetLocalRotation(euler2quat(newRot * DEG2RAD));
 }
-inline void Transform::SetLocalRotation(const glm::vec3 newRot)
+void Transform::SetLocalRotation(const glm::fquat newRot)
 {
-	this->rotation = newRot;
+	TransformHierarchy::Instance().SetLocalRotation(node, newRot);
 }
-inline void Transform::SetLocalScale(const glm::vec3 newScale)
+void Transform::SetLocalScale(const glm::vec3 newScale)
 {
-	this->scale = newScale;
+	TransformHierarchy::Instance().SetLocalScale(node, newScale);
 }
 
+// Rotates about x, then y, then z (the inverse of quat2euler).
 glm::fquat euler2quat(glm::vec3 euler)
 {
-	glm::fquat xQuat(1, 0, 0, euler.x);
-	glm::fquat yQuat(0, 1, 0, euler.y);
-	glm::fquat zQuat(0, 0, 1, euler.z);
-	return xQuat * yQuat * zQuat;
+	const glm::vec3 c = glm::cos(euler * 0.5f);
+	const glm::vec3 s = glm::sin(euler * 0.5f);
+	return glm::fquat(
+		c.x * c.y * c.z + s.x * s.y * s.z,
+		s.x * c.y * c.z - c.x * s.y * s.z,
+		c.x * s.y * c.z + s.x * c.y * s.z,
+		c.x * c.y * s.z - s.x * s.y * c.z);
 }
 
 glm::vec3 quat2euler(glm::fquat q)
@@ -0,0 +1,368 @@
+#include "TransformHierarchy.hpp"
+
+// The world matrices are multiplied with SSE where available (always on x64).
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define TRANSFORM_SIMD
+#include <xmmintrin.h>
+#endif
+
+// Node flags.
+// The local pose changed since the last Update.
+#define TRANSFORM_DIRTY 0x1
+// The node has been removed and waits to be compacted away.
+#define TRANSFORM_REMOVED 0x2
+// The previous pose of the node has been stored.
+#define TRANSFORM_HAS_PREVIOUS 0x4
+// The world pose changed since the previous poses were stored.
+#define TRANSFORM_MOVED 0x8
+
+// Builds the matrix that scales, rotates and translates.
+static inline glm::mat4 ComposeMatrix(const glm::vec3& position, const glm::fquat& rotation,
+	const glm::vec3& scale)
+{
+	glm::mat4 matrix = glm::mat4_cast(rotation);
+	matrix[0] *= scale.x;
+	matrix[1] *= scale.y;
+	matrix[2] *= scale.z;
+	matrix[3] = glm::vec4(position, 1.0f);
+	return matrix;
+}
+
+// Computes a * b.
+static inline void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+{
+#ifdef TRANSFORM_SIMD
+	// Each column of the result is the combination of the columns of a weighted by a column of b.
+	const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+	const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+	const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+	const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+	for (int column = 0; column < 4; column++)
+	{
+		const float* weights = &b[column][0];
+		__m128 sum = _mm_mul_ps(a0, _mm_set1_ps(weights[0]));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(weights[1])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(weights[2])));
+		sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(weights[3])));
+		_mm_storeu_ps(&result[column][0], sum);
+	}
+#else
+	result = a * b;
+#endif
+}
+
+TransformHierarchy::TransformHierarchy()
+{
+}
+
+TransformHierarchy& TransformHierarchy::Instance()
+{
+	static TransformHierarchy instance;
+	return instance;
+}
+
+unsigned int TransformHierarchy::Add(unsigned int parent, glm::vec3 position, glm::fquat rotation,
+	glm::vec3 scale)
+{
+	unsigned int id;
+	if (!freeIds.empty())
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else
+	{
+		id = (unsigned int)indices.size();
+		indices.push_back(TRANSFORM_NO_NODE);
+	}
+
+	const unsigned int index = (unsigned int)parents.size();
+	parents.push_back(parent != TRANSFORM_NO_NODE ? indices[parent] : TRANSFORM_NO_NODE);
+	localPositions.push_back(position);
+	localRotations.push_back(rotation);
+	localScales.push_back(scale);
+	worldMatrices.push_back(glm::mat4());
+	worldRotations.push_back(glm::fquat());
+	worldScales.push_back(glm::vec3(1.0f));
+	previousPositions.push_back(glm::vec3());
+	previousRotations.push_back(glm::fquat());
+	flags.push_back(TRANSFORM_DIRTY);
+	dirtyCount++;
+	ids.push_back(id);
+	indices[id] = index;
+	return id;
+}
+
+void TransformHierarchy::Remove(unsigned int node)
+{
+	const unsigned int index = indices[node];
+	flags[index] |= TRANSFORM_REMOVED;
+	ids[index] = TRANSFORM_NO_NODE;
+	indices[node] = TRANSFORM_NO_NODE;
+	freeIds.push_back(node);
+	removedCount++;
+}
+
+void TransformHierarchy::Detach(unsigned int node)
+{
+	const unsigned int index = indices[node];
+	parents[index] = TRANSFORM_NO_NODE;
+	MarkDirty(index);
+}
+
+unsigned int TransformHierarchy::GetParent(unsigned int node) const
+{
+	const unsigned int parent = ParentOf(indices[node]);
+	return parent != TRANSFORM_NO_NODE ? ids[parent] : TRANSFORM_NO_NODE;
+}
+
+glm::vec3 TransformHierarchy::GetLocalPosition(unsigned int node) const { return localPositions[indices[node]]; }
+glm::fquat TransformHierarchy::GetLocalRotation(unsigned int node) const { return localRotations[indices[node]]; }
+glm::vec3 TransformHierarchy::GetLocalScale(unsigned int node) const { return localScales[indices[node]]; }
+
+void TransformHierarchy::SetLocalPosition(unsigned int node, glm::vec3 position)
+{
+	const unsigned int index = indices[node];
+	localPositions[index] = position;
+	MarkDirty(index);
+}
+
+void TransformHierarchy::SetLocalRotation(unsigned int node, glm::fquat rotation)
+{
+	const unsigned int index = indices[node];
+	localRotations[index] = rotation;
+	MarkDirty(index);
+}
+
+void TransformHierarchy::SetLocalScale(unsigned int node, glm::vec3 scale)
+{
+	const unsigned int index = indices[node];
+	localScales[index] = scale;
+	MarkDirty(index);
+}
+
+glm::mat4 TransformHierarchy::GetWorldMatrix(unsigned int node) const { return WorldMatrixAt(indices[node]); }
+glm::fquat TransformHierarchy::GetWorldRotation(unsigned int node) const { return WorldRotationAt(indices[node]); }
+glm::vec3 TransformHierarchy::GetWorldScale(unsigned int node) const { return WorldScaleAt(indices[node]); }
+
+glm::vec3 TransformHierarchy::GetWorldPosition(unsigned int node) const
+{
+	return glm::vec3(WorldMatrixAt(indices[node])[3]);
+}
+
+void TransformHierarchy::SetWorldPosition(unsigned int node, glm::vec3 position)
+{
+	const unsigned int parent = ParentOf(indices[node]);
+	if (parent == TRANSFORM_NO_NODE)
+		SetLocalPosition(node, position);
+	else
+		SetLocalPosition(node, glm::vec3(glm::inverse(WorldMatrixAt(parent)) * glm::vec4(position, 1.0f)));
+}
+
+void TransformHierarchy::SetWorldRotation(unsigned int node, glm::fquat rotation)
+{
+	const unsigned int parent = ParentOf(indices[node]);
+	if (parent == TRANSFORM_NO_NODE)
+		SetLocalRotation(node, rotation);
+	else
+		SetLocalRotation(node, glm::inverse(WorldRotationAt(parent)) * rotation);
+}
+
+bool TransformHierarchy::IsDirty(unsigned int node) const { return IsStale(indices[node]); }
+
+void TransformHierarchy::Update()
+{
+	if (removedCount > 0)
+		Compact();
+	// The clean nodes have clean parents, so nothing needs recomputing.
+	updatedCount = 0;
+	if (dirtyCount == 0)
+		return;
+
+	const size_t count = parents.size();
+	updated.assign(count, 0);
+	for (size_t i = 0; i < count; i++)
+	{
+		// A node is recomputed if it changed or if its parent has been recomputed.
+		const unsigned int parent = parents[i];
+		if ((flags[i] & TRANSFORM_DIRTY) == 0 && (parent == TRANSFORM_NO_NODE || !updated[parent]))
+			continue;
+
+		const glm::mat4 local = ComposeMatrix(localPositions[i], localRotations[i], localScales[i]);
+		if (parent == TRANSFORM_NO_NODE)
+		{
+			worldMatrices[i] = local;
+			worldRotations[i] = localRotations[i];
+			worldScales[i] = localScales[i];
+		}
+		else
+		{
+			MultiplyMatrices(worldMatrices[parent], local, worldMatrices[i]);
+			worldRotations[i] = worldRotations[parent] * localRotations[i];
+			worldScales[i] = worldScales[parent] * localScales[i];
+		}
+		flags[i] &= ~TRANSFORM_DIRTY;
+		updated[i] = 1;
+		updatedCount++;
+		if ((flags[i] & TRANSFORM_MOVED) == 0)
+		{
+			flags[i] |= TRANSFORM_MOVED;
+			movedNodes.push_back(ids[i]);
+		}
+	}
+	dirtyCount = 0;
+}
+
+void TransformHierarchy::StorePreviousPoses()
+{
+	// The other nodes are still at the pose stored last time.
+	for (size_t i = 0; i < movedNodes.size(); i++)
+	{
+		// The node may have been removed, and its ID reused by a node not yet updated.
+		const unsigned int index = indices[movedNodes[i]];
+		if (index == TRANSFORM_NO_NODE || (flags[index] & TRANSFORM_MOVED) == 0)
+			continue;
+		previousPositions[index] = glm::vec3(worldMatrices[index][3]);
+		previousRotations[index] = worldRotations[index];
+		flags[index] = (flags[index] & ~TRANSFORM_MOVED) | TRANSFORM_HAS_PREVIOUS;
+	}
+	movedNodes.clear();
+}
+
+glm::mat4 TransformHierarchy::GetInterpolatedMatrix(unsigned int node, float alpha) const
+{
+	const unsigned int index = indices[node];
+	const glm::mat4 current = WorldMatrixAt(index);
+	if ((flags[index] & TRANSFORM_HAS_PREVIOUS) == 0 || alpha >= 1.0f)
+		return current;
+	const glm::vec3 position(current[3]);
+	const glm::fquat rotation = WorldRotationAt(index);
+	if (position == previousPositions[index] && rotation == previousRotations[index])
+		return current;
+	return ComposeMatrix(glm::mix(previousPositions[index], position, alpha),
+		glm::normalize(glm::slerp(previousRotations[index], rotation, alpha)), WorldScaleAt(index));
+}
+
+size_t TransformHierarchy::GetCount() const { return parents.size() - removedCount; }
+
+size_t TransformHierarchy::GetUpdatedCount() const { return updatedCount; }
+
+size_t TransformHierarchy::GetNodeSize()
+{
+	// One element of each array with an entry per node.
+	const TransformHierarchy* node = NULL;
+	return sizeof(node->parents[0]) + sizeof(node->localPositions[0]) + sizeof(node->localRotations[0]) 
+		+ sizeof(node->localScales[0]) + sizeof(node->worldMatrices[0]) + sizeof(node->worldRotations[0]) 
+		+ sizeof(node->worldScales[0]) + sizeof(node->previousPositions[0]) + sizeof(node->previousRotations[0]) 
+		+ sizeof(node->flags[0]) + sizeof(node->ids[0]) + sizeof(node->indices[0]) + sizeof(node->updated[0]);
+}
+
+void TransformHierarchy::MarkDirty(unsigned int index)
+{
+	if ((flags[index] & TRANSFORM_DIRTY) == 0)
+	{
+		flags[index] |= TRANSFORM_DIRTY;
+		dirtyCount++;
+	}
+}
+
+unsigned int TransformHierarchy::ParentOf(unsigned int index) const
+{
+	const unsigned int parent = parents[index];
+	return parent != TRANSFORM_NO_NODE && (flags[parent] & TRANSFORM_REMOVED) == 0 ? parent : TRANSFORM_NO_NODE;
+}
+
+bool TransformHierarchy::IsStale(unsigned int index) const
+{
+	for (;;)
+	{
+		if (flags[index] & TRANSFORM_DIRTY)
+			return true;
+		const unsigned int parent = parents[index];
+		if (parent == TRANSFORM_NO_NODE)
+			return false;
+		// The cached values are relative to the removed parent.
+		if (flags[parent] & TRANSFORM_REMOVED)
+			return true;
+		index = parent;
+	}
+}
+
+glm::mat4 TransformHierarchy::WorldMatrixAt(unsigned int index) const
+{
+	if (!IsStale(index))
+		return worldMatrices[index];
+	const glm::mat4 local = ComposeMatrix(localPositions[index], localRotations[index], localScales[index]);
+	const unsigned int parent = ParentOf(index);
+	return parent != TRANSFORM_NO_NODE ? WorldMatrixAt(parent) * local : local;
+}
+
+glm::fquat TransformHierarchy::WorldRotationAt(unsigned int index) const
+{
+	if (!IsStale(index))
+		return worldRotations[index];
+	const unsigned int parent = ParentOf(index);
+	return parent != TRANSFORM_NO_NODE ? WorldRotationAt(parent) * localRotations[index] : localRotations[index];
+}
+
+glm::vec3 TransformHierarchy::WorldScaleAt(unsigned int index) const
+{
+	if (!IsStale(index))
+		return worldScales[index];
+	const unsigned int parent = ParentOf(index);
+	return parent != TRANSFORM_NO_NODE ? WorldScaleAt(parent) * localScales[index] : localScales[index];
+}
+
+void TransformHierarchy::Compact()
+{
+	// The parents come first, so they have been moved (or removed) before their children.
+	const size_t count = parents.size();
+	std::vector<unsigned int> newIndices(count);
+	unsigned int kept = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (flags[i] & TRANSFORM_REMOVED)
+		{
+			if (flags[i] & TRANSFORM_DIRTY)
+				dirtyCount--;
+			newIndices[i] = TRANSFORM_NO_NODE;
+			continue;
+		}
+
+		unsigned int parent = parents[i] != TRANSFORM_NO_NODE ? newIndices[parents[i]] : TRANSFORM_NO_NODE;
+		unsigned char nodeFlags = flags[i];
+		// The children of a removed node become roots.
+		if (parents[i] != TRANSFORM_NO_NODE && parent == TRANSFORM_NO_NODE && (nodeFlags & TRANSFORM_DIRTY) == 0)
+		{
+			nodeFlags |= TRANSFORM_DIRTY;
+			dirtyCount++;
+		}
+		parents[kept] = parent;
+		localPositions[kept] = localPositions[i];
+		localRotations[kept] = localRotations[i];
+		localScales[kept] = localScales[i];
+		worldMatrices[kept] = worldMatrices[i];
+		worldRotations[kept] = worldRotations[i];
+		worldScales[kept] = worldScales[i];
+		previousPositions[kept] = previousPositions[i];
+		previousRotations[kept] = previousRotations[i];
+		flags[kept] = nodeFlags;
+		ids[kept] = ids[i];
+		indices[ids[kept]] = kept;
+		newIndices[i] = kept;
+		kept++;
+	}
+
+	parents.resize(kept);
+	localPositions.resize(kept);
+	localRotations.resize(kept);
+	localScales.resize(kept);
+	worldMatrices.resize(kept);
+	worldRotations.resize(kept);
+	worldScales.resize(kept);
+	previousPositions.resize(kept);
+	previousRotations.resize(kept);
+	flags.resize(kept);
+	ids.resize(kept);
+	removedCount = 0;
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 
 #include <GL/glew.h>
@@ -15,6 +17,15 @@
 
 #include "PaintableComponent.h"
 #include "StainSet.h"
+#include "Benchmarks.hpp"
+#include "ShaderCache.hpp"
+#include "HeadlessContext.hpp"
+#include "ShotScript.hpp"
+#include "Profiler.hpp"
+#include "TextureStreamer.hpp"
+#include "AssetRegistry.hpp"
+#include "FixedTimestep.hpp"
+#include "Scene.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -27,17 +38,28 @@
 #define SCREEN_WIDTH 1920	
 #define SCREEN_HEIGHT 1080
 
+// Frames between two prints of the profiler's averages.
+#define PROFILE_PRINT_INTERVAL 600
+
 // Callback for errors.
 static void error_callback(int error, const char* description);
 // Callback for keyboard input.
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 // Callback for mouse input.
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+// Callback for framebuffer resizing.
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 
 // Texture-loading function.
 GLint LoadTexture(const char* path);
 // Processes input
 void ApplyPlayerCameraMovements(GLfloat deltaTime);
+// Updates physics, player and components.
+void SimulateFrame(GLfloat deltaTime);
+// Renders the scripted sequence off-screen and reports frame times and paint coverage.
+void RunHeadless(const ShotScript& script, int width, int height);
+// Prints the profiler's averages and exports the trace, if requested.
+void ReportProfile(const char* tracePath);
 
 // Pressed keys.
 bool keys[1024];
@@ -54,12 +76,19 @@ ShaderSet* SHADERS;
 // The physics component.
 PhysicsModule *physicsModule;
 
+// Splits the frames in the fixed ticks physics and gameplay are simulated by.
+FixedTimestep simulationClock;
+
 // Projection and view matrices used in the rendering.
 glm::mat4 projection, view;
 
 // The mouse pointer's position.
 float cursorX, cursorY;
 
+// The framebuffer size notified by the last resize, applied at the beginning of the next frame.
+int framebufferWidth, framebufferHeight;
+bool framebufferResized = false;
+
 Model* paintBallModel;
 
 // The gaussian kernel with linear layout.
@@ -67,86 +96,130 @@ GLfloat* gaussKernel = (GLfloat*)malloc(sizeof(GLfloat) * 49);
 
 int main(int argc, char *argv[])
 {
-	//Set the error callback  
-	glfwSetErrorCallback(error_callback);
-
-	//Initialize GLFW  
-	if (!glfwInit())
-	{
-		std::exit(EXIT_FAILURE);
-	}
-
-	//Set the GLFW window creation hints - these are optional  
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4); //Request a specific OpenGL version  
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2); //Request a specific OpenGL version  
-	glfwWindowHint(GLFW_SAMPLES, 4); //Request 4x antialiasing  
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  
-	glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
+	// In headless mode the scene is rendered off-screen at the requested resolution,
+	// following a scripted sequence of camera movements and shots.
+	bool headless = HasArgument(argc, argv, "--headless");
+	int renderWidth = SCREEN_WIDTH, renderHeight = SCREEN_HEIGHT;
+	if (GetArgumentValue(argc, argv, "--width") != nullptr)
+		renderWidth = atoi(GetArgumentValue(argc, argv, "--width"));
+	if (GetArgumentValue(argc, argv, "--height") != nullptr)
+		renderHeight = atoi(GetArgumentValue(argc, argv, "--height"));
+
+	// Profiles CPU and GPU times, recording them for a Chrome trace if a path is given.
+	const char* tracePath = GetArgumentValue(argc, argv, "--trace");
+	Profiler::Instance().enabled = HasArgument(argc, argv, "--profile") || tracePath != nullptr;
+	Profiler::Instance().recordTrace = tracePath != nullptr;
+
+	// The simulation runs at a fixed rate (60 or 120 ticks per second), whatever the frame rate.
+	if (GetArgumentValue(argc, argv, "--tick-rate") != nullptr)
+		simulationClock.SetRate(atoi(GetArgumentValue(argc, argv, "--tick-rate")));
 
 	//Declare a window object  
-	GLFWwindow* window;
-
-	// Create a window and create its OpenGL context
-	// Fullscreen
-	//window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Paint Game", glfwGetPrimaryMonitor(), NULL);
-	// Window
-	window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Paint Game", NULL, NULL);
-
-	// Hides mouse cursor.
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+	GLFWwindow* window = nullptr;
+	HeadlessContext headlessContext;
 
-	//If the window couldn't be created  
-	if (!window)
+	if (headless)
 	{
-		fprintf(stderr, "Failed to open GLFW window.\n");
-		glfwTerminate();
-		std::exit(EXIT_FAILURE);
+		if (!headlessContext.Create())
+			std::exit(EXIT_FAILURE);
+	}
+	else
+	{
+		//Set the error callback  
+		glfwSetErrorCallback(error_callback);
+
+		//Initialize GLFW  
+		if (!glfwInit())
+		{
+			std::exit(EXIT_FAILURE);
+		}
+
+		//Set the GLFW window creation hints - these are optional  
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4); //Request a specific OpenGL version  
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2); //Request a specific OpenGL version  
+		glfwWindowHint(GLFW_SAMPLES, 4); //Request 4x antialiasing  
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);  
+		glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
+
+		// Create a window and create its OpenGL context
+		// Fullscreen
+		//window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Paint Game", glfwGetPrimaryMonitor(), NULL);
+		// Window
+		window = glfwCreateWindow(renderWidth, renderHeight, "Paint Game", NULL, NULL);
+
+		//If the window couldn't be created  
+		if (!window)
+		{
+			fprintf(stderr, "Failed to open GLFW window.\n");
+			glfwTerminate();
+			std::exit(EXIT_FAILURE);
+		}
+
+		// Hides mouse cursor.
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+
+		//This function makes the context of the specified window current on the calling thread.   
+		glfwMakeContextCurrent(window);
+
+		// Rendering is decoupled from the simulation: without vsync it runs as fast as it can.
+		if (HasArgument(argc, argv, "--uncapped"))
+			glfwSwapInterval(0);
+
+		//Sets the input callbacks.  
+		glfwSetKeyCallback(window, key_callback);
+		glfwSetCursorPosCallback(window, mouse_callback);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+		// The scene is rendered at the framebuffer size, which may differ from the window size.
+		glfwGetFramebufferSize(window, &renderWidth, &renderHeight);
 	}
-
-	//This function makes the context of the specified window current on the calling thread.   
-	glfwMakeContextCurrent(window);
-
-	//Sets the input callbacks.  
-	glfwSetKeyCallback(window, key_callback);
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	//Initialize GLEW  
 	GLenum err = glewInit();
 
 	//If GLEW hasn't initialized  
-	if (err != GLEW_OK)
+	// Without a GLX display only the window-system extensions are missing: the headless
+	// EGL context has loaded all the OpenGL entry points.
+	if (err != GLEW_OK && !(headless && err == GLEW_ERROR_NO_GLX_DISPLAY))
 	{
 		fprintf(stderr, "Error: %s\n", glewGetErrorString(err));
 		return -1;
 	}
 
-	// Retrieves the frame buffer size.
-	int viewportWidth, viewportHeight;
-	glfwGetFramebufferSize(window, &viewportWidth, &viewportHeight);
-
 	// Initializes the rendering engine and the shader set.
-	renderingEngine = new RenderingEngine(&playerController);
+	renderingEngine = new RenderingEngine(&playerController, renderWidth, renderHeight);
+	renderingEngine->presentToScreen = !headless;
+	// Scales the scene resolution to hold the target frame rate, measuring the GPU time.
+	if (HasArgument(argc, argv, "--dynamic-resolution"))
+	{
+		renderingEngine->dynamicResolution = true;
+		Profiler::Instance().enabled = true;
+		const char* targetFps = GetArgumentValue(argc, argv, "--target-fps");
+		if (targetFps != nullptr && atof(targetFps) > 0.0)
+			renderingEngine->targetFrameTime = 1000.0 / atof(targetFps);
+	}
+	// Draws the full meshes at any distance.
+	if (HasArgument(argc, argv, "--no-lod"))
+		renderingEngine->lodPixelError = 0.0f;
 	SHADERS = new ShaderSet();
+	renderingEngine->shaders = SHADERS;
 	physicsModule = new PhysicsModule();
-
-	// Loads the models
-	//Model scenery("../../Project/ProgettoPGTR/Models/SplatoonTestScenery.obj");
-	Model floorModel(CUBE_OBJ_PATH);
-	Model wallModel(CUBE_OBJ_PATH);
-	Model towerModel(CYLINDER_OBJ_PATH);
-	Model bunnyModel(BUNNY_OBJ_PATH);
-	Model sphereModel(SPHERE_OBJ_PATH);
-	paintBallModel = new Model(SPHERE_OBJ_PATH);
-
-	// Loads the scenery's texture.
-	GLuint crackedTexture = LoadTexture("Textures/Floor.png");
-	GLuint asphaltTexture = LoadTexture("Textures/Asphalt.jpg");
-	GLuint asphaltNormalMap = LoadTexture("Textures/Asphalt-NormalMap.jpg");
-	GLint brickWallTexture = LoadTexture("Textures/BrickWall.jpg");
-	GLint brickWallNormalMap = LoadTexture("Textures/BrickWall-NormalMap.jpg");
-	GLint woodBoxNormalMap = LoadTexture("Textures/WoodBox-NormalMap.jpg");
-	GLint perlinNoiseTex = LoadTexture("Textures/PerlinNoise2.png");
+	physicsModule->gameObjects = &renderingEngine->gameObjects;
+	renderingEngine->physics = physicsModule;
+	ShaderCache::Instance().PrintReport();
+
+	// Physics uses primitive shapes: no model needs to keep its vertices in system memory.
+	// The heavy meshes get simplified levels of detail, picked by their size on screen.
+	const unsigned int meshFlags = MESH_PACK_VERTICES | MESH_OPTIMIZE_CACHE | MESH_OPTIMIZE_OVERDRAW
+		| MESH_GENERATE_LODS;
+	AssetRegistry& assets = AssetRegistry::Instance();
+
+	// The textures are streamed in the background: the names are valid right away and the images
+	// appear when decoded.
+	TextureStreamer& textureStreamer = TextureStreamer::Instance();
+	GLint perlinNoiseTex = assets.AcquireTexture("Textures/PerlinNoise2.png", TEXTURE_USAGE_DATA);
+	// The drops are read back by the stain set: they are loaded synchronously.
 	StainSet* stainSet = new StainSet(perlinNoiseTex);
 	stainSet->AddPaintDropTexture(LoadTexture("Textures/Drop0.png"));
 	stainSet->AddPaintDropTexture(LoadTexture("Textures/Drop1.png"));
@@ -159,80 +232,26 @@ int main(int argc, char *argv[])
 	stainSet->AddPaintDropTexture(LoadTexture("Textures/Drop8.png"));
 	stainSet->StartProceduralGenerationThread();
 
-	GLint uiTex = LoadTexture("Textures/Cursor.png");
+	// The arena is described by a scene file, compiled on first load: another one can be given
+	// with --scene. The registry imports each model once: the paint balls share the sphere.
+	const char* scenePath = GetArgumentValue(argc, argv, "--scene");
+	Scene scene;
+	if (!scene.Load(scenePath != nullptr ? scenePath : SCENE_DEFAULT_PATH, renderingEngine, physicsModule, 
+		SHADERS, stainSet, perlinNoiseTex, meshFlags))
+		std::exit(EXIT_FAILURE);
+	paintBallModel = assets.AcquireModel(SPHERE_OBJ_PATH, meshFlags);
+
+	// The UI is color keyed on black: it is not compressed.
+	GLint uiTex = assets.AcquireTexture("Textures/Cursor.png", TEXTURE_USAGE_DATA);
 	renderingEngine->uiTexture = uiTex;
-	glm::vec3 pointLightPosition(0, 5, 5);
-
-	// Wall materials.
-	Material wallMaterial(&SHADERS->availableShaders[SHADER_BLINN_PHONG]);
-	PaintableBlinnPhongTexturingShaderParamSet wallMatParams;
-	wallMatParams.diffuseTexture = brickWallTexture;
-	wallMatParams.normalMap = brickWallNormalMap;
-	wallMatParams.perlinNoise = perlinNoiseTex;
-	wallMatParams.shininess = 5.0f;
-	wallMatParams.specularColor = glm::vec3(1.f, 1.f, 1.f);
-	wallMatParams.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	wallMatParams.pointLightPosition = pointLightPosition;
-	wallMatParams.repeat = glm::vec2(50.f, 50.f);
-	wallMaterial.shaderParams = &wallMatParams;
-
-	Material wall2Material(&SHADERS->availableShaders[SHADER_BLINN_PHONG]),
-		wall3Material(&SHADERS->availableShaders[SHADER_BLINN_PHONG]),
-		wall4Material(&SHADERS->availableShaders[SHADER_BLINN_PHONG]);
-	wall2Material.shaderParams = &wallMatParams.Clone();
-	wall3Material.shaderParams = &wallMatParams.Clone();
-	wall4Material.shaderParams = &wallMatParams.Clone();
-
-	// Floor material.
-	Material floorMaterial(&SHADERS->availableShaders[SHADER_BLINN_PHONG]);
-	PaintableBlinnPhongTexturingShaderParamSet floorMatParams;
-	floorMatParams.diffuseTexture = asphaltTexture;
-	floorMatParams.normalMap = asphaltNormalMap;
-	floorMatParams.perlinNoise = perlinNoiseTex;
-	floorMatParams.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	floorMatParams.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	floorMatParams.pointLightPosition = pointLightPosition;
-	floorMatParams.repeat = glm::vec2(50.f, 50.f);
-	floorMaterial.shaderParams = &floorMatParams;
-
-	Material upMaterial(&SHADERS->availableShaders[SHADER_BLINN_PHONG]);
-	upMaterial.shaderParams = &floorMatParams.Clone();
-
-	// Tower material.
-	Material towerMaterial(&SHADERS->availableShaders[SHADER_BLINN_PHONG]);
-	PaintableBlinnPhongTexturingShaderParamSet towerMatParams;
-	towerMatParams.diffuseTexture = crackedTexture;
-	towerMatParams.perlinNoise = perlinNoiseTex;
-	towerMatParams.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	towerMatParams.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	towerMatParams.pointLightPosition = pointLightPosition;
-	towerMatParams.repeat = glm::vec2(5.f, 20.f);
-	towerMaterial.shaderParams = &towerMatParams;
-
-	// Sphere material.
-	Material sphereMaterial(&SHADERS->availableShaders[SHADER_BLINN_PHONG]);
-	PaintableBlinnPhongTexturingShaderParamSet sphereMatParams;
-	//sphereMatParams.diffuseTexture = crackedTexture;
-	sphereMatParams.diffuseColor = glm::vec3(1.0f, 0.0f, 0.0f);
-	sphereMatParams.Ks = 0.1f;
-	sphereMatParams.perlinNoise = perlinNoiseTex;
-	sphereMatParams.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	sphereMatParams.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	sphereMatParams.pointLightPosition = glm::vec3(0, 5, -5);
-	sphereMatParams.repeat = glm::vec2(10.f, 10.f);
-	sphereMaterial.shaderParams = &sphereMatParams;
-
-	// Bunny material.
-	Material bunnyMaterial(&SHADERS->availableShaders[SHADER_BLINN_PHONG]);
-	PaintableBlinnPhongTexturingShaderParamSet bunnyMatParams;
-	bunnyMatParams.diffuseColor = glm::vec3(1.0f, 0.0f, 0.0f);
-	bunnyMatParams.perlinNoise = perlinNoiseTex;
-	bunnyMatParams.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	bunnyMatParams.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	bunnyMatParams.pointLightPosition = pointLightPosition;
-	bunnyMatParams.repeat = glm::vec2(10.f, 10.f);
-	bunnyMatParams.shininess = 5.0f;
-	bunnyMaterial.shaderParams = &bunnyMatParams;
+	glm::vec3 pointLightPosition = scene.GetLightPosition();
+
+	// The main light casts the shadows. A directional sun, with cascaded shadows, replaces it
+	// for open scenes.
+	if (HasArgument(argc, argv, "--sun"))
+		renderingEngine->shadows->SetDirectionalLight(glm::vec3(-0.3f, -1.0f, -0.4f));
+	else if (!HasArgument(argc, argv, "--no-shadows"))
+		renderingEngine->shadows->SetPointLight(pointLightPosition);
 
 	// Paintball material.
 	Material paintBallMaterial(&SHADERS->availableShaders[SHADER_LAMBERT]);
@@ -244,175 +263,172 @@ int main(int argc, char *argv[])
 	paintBallMaterial.shaderParams = &pbMatParams;
 	playerController.SetPaintMaterial(&paintBallMaterial);
 
-	// Wood box material.
-	Material woodBox1Material(&SHADERS->availableShaders[SHADER_BLINN_PHONG]);
-	PaintableBlinnPhongTexturingShaderParamSet woodBoxParams;
-	woodBoxParams.diffuseColor = glm::vec3(153.f / 255.f, 102.f / 255.f, 51.f / 255.f);
-	woodBoxParams.normalMap = woodBoxNormalMap;
-	woodBoxParams.perlinNoise = perlinNoiseTex;
-	woodBoxParams.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	woodBoxParams.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	woodBoxParams.pointLightPosition = pointLightPosition;
-	woodBoxParams.repeat = glm::vec2(3.f, 3.f);
-	woodBoxParams.shininess = 5.0f;
-	woodBoxParams.Ka = 0.1f;
-	woodBoxParams.Kd = 0.8f;
-	woodBox1Material.shaderParams = &woodBoxParams;
-
-	Material woodBox2Material(&SHADERS->availableShaders[SHADER_BLINN_PHONG]),
-		woodBox3Material(&SHADERS->availableShaders[SHADER_BLINN_PHONG]);
-	woodBox2Material.shaderParams = &woodBoxParams.Clone();
-	woodBox3Material.shaderParams = &woodBoxParams.Clone();
-
-	GameObject *floor = renderingEngine->AddGameObject("Floor", &floorModel, 
-		glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec3(10, 0.01, 10), nullptr, &floorMaterial);
-	GameObject *wall1 = renderingEngine->AddGameObject("Wall1", &wallModel, 
-		glm::vec3(0, 5, 9), glm::vec3(0, 0, 0), glm::vec3(10, 5, 1), nullptr, &wallMaterial);
-	GameObject *wall2 = renderingEngine->AddGameObject("Wall2", &wallModel,
-		glm::vec3(-9, 5, 0), glm::vec3(0, 0, 0), glm::vec3(1, 5, 10), nullptr, &wall2Material);
-	GameObject *wall3 = renderingEngine->AddGameObject("Wall3", &wallModel,
-		glm::vec3(9, 5, 0), glm::vec3(0, 0, 0), glm::vec3(1, 5, 10), nullptr, &wall3Material);
-	GameObject *wall4 = renderingEngine->AddGameObject("Wall4", &wallModel,
-		glm::vec3(0, 5, -9), glm::vec3(0, 0, 3.14f / 2.0f), glm::vec3(5, 9, 1), 
-		nullptr, &wall4Material);
-	GameObject *sphere = renderingEngine->AddGameObject("Sphere", &sphereModel, glm::vec3(-4, 1.5, -6),
-		glm::vec3(0, 0, 0), glm::vec3(2, 2, 2), nullptr, &sphereMaterial);
-	GameObject *tower = renderingEngine->AddGameObject("Tower", &towerModel, glm::vec3(0, 4.5, -6),
-		glm::vec3(0, 0, 0), glm::vec3(2, 10, 2), nullptr, &towerMaterial);
-	GameObject *box1 = renderingEngine->AddGameObject("Box1", &wallModel, glm::vec3(5, 1, 5),
-		glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), nullptr, &woodBox1Material);
-	GameObject *box2 = renderingEngine->AddGameObject("Box2", &wallModel, glm::vec3(5, 3, 6),
-		glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), nullptr, &woodBox2Material);
-	GameObject *box3 = renderingEngine->AddGameObject("Box3", &wallModel, glm::vec3(5, 1, 7),
-		glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), nullptr, &woodBox3Material);
-
-	GameObject* up = renderingEngine->AddGameObject("Up", &floorModel, glm::vec3(0, 10.0f, 0),
-		glm::vec3(0, 0, 0), glm::vec3(10, 0.01, 10), nullptr, &upMaterial);
-	GameObject* bunny = renderingEngine->AddGameObject("Bunny", &bunnyModel, glm::vec3(4, 1.5, -6),
-		glm::vec3(0, 0, 0), glm::vec3(0.5f, 0.5f, 0.5f), nullptr, &bunnyMaterial);
-
-	// Physics initialization.
-	Transform* floorTr = floor->GetTransform();
-	Transform* wall1Tr = wall1->GetTransform();
-	Transform* wall2Tr = wall2->GetTransform();
-	Transform* wall3Tr = wall3->GetTransform();
-	Transform* wall4Tr = wall4->GetTransform();
-	Transform* box1Tr = box1->GetTransform(), *box2Tr = box2->GetTransform(),
-		*box3Tr = box3->GetTransform(), *bunnyTr = bunny->GetTransform();
-	Transform* sphereTr = sphere->GetTransform();
-	Transform* towerTr = tower->GetTransform();
-	btRigidBody* planeRb = physicsModule->createRigidBody(2, glm::vec3(0, -0.01, 0), 
-		floorTr->GetAbsoluteScale(), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	floor->AddComponent(new RigidbodyComponent(floor, physicsModule, planeRb));
-	btRigidBody* upRb = physicsModule->createRigidBody(0, glm::vec3(0, 10, 0),
-		glm::vec3(20, 0.5, 20), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	up->AddComponent(new RigidbodyComponent(up, physicsModule, upRb));
-	btRigidBody* wall1Rb = physicsModule->createRigidBody(0, wall1Tr->GetAbsolutePosition(),
-		wall1Tr->GetAbsoluteScale(), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	wall1->AddComponent(new RigidbodyComponent(wall1, physicsModule, wall1Rb));
-	btRigidBody* wall2Rb = physicsModule->createRigidBody(0, wall2Tr->GetAbsolutePosition(),
-		wall2Tr->GetAbsoluteScale(), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	wall2->AddComponent(new RigidbodyComponent(wall2, physicsModule, wall2Rb));
-	btRigidBody* wall3Rb = physicsModule->createRigidBody(0, wall3Tr->GetAbsolutePosition(),
-		wall3Tr->GetAbsoluteScale(), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	wall3->AddComponent(new RigidbodyComponent(wall3, physicsModule, wall3Rb));
-	btRigidBody* wall4Rb = physicsModule->createRigidBody(0, wall4Tr->GetAbsolutePosition(),
-		wall4Tr->GetAbsoluteScale(), glm::vec3(0, 0, 3.14f / 2.0f), 0, 0.3, 0.3);
-	wall4->AddComponent(new RigidbodyComponent(wall4, physicsModule, wall4Rb));
-	btRigidBody* sphereRb = physicsModule->createRigidBody(1, sphereTr->GetAbsolutePosition(),
-		sphereTr->GetAbsoluteScale(), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	sphere->AddComponent(new RigidbodyComponent(sphere, physicsModule, sphereRb));
-	btRigidBody* towerRb = physicsModule->createRigidBody(3, towerTr->GetAbsolutePosition(),
-		glm::vec3(2.f, 10.f, 2.f), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	tower->AddComponent(new RigidbodyComponent(tower, physicsModule, towerRb));
-
-	btRigidBody* box1Rb = physicsModule->createRigidBody(0, box1Tr->GetAbsolutePosition(),
-		box1Tr->GetAbsoluteScale(), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	box1->AddComponent(new RigidbodyComponent(box1, physicsModule, box1Rb));
-	btRigidBody* box2Rb = physicsModule->createRigidBody(0, box2Tr->GetAbsolutePosition(),
-		box2Tr->GetAbsoluteScale(), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	box2->AddComponent(new RigidbodyComponent(box2, physicsModule, box2Rb));
-	btRigidBody* box3Rb = physicsModule->createRigidBody(0, box3Tr->GetAbsolutePosition(),
-		box3Tr->GetAbsoluteScale(), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	box3->AddComponent(new RigidbodyComponent(box3, physicsModule, box3Rb));
-	btRigidBody* bunnyRb = physicsModule->createRigidBody(0, bunnyTr->GetAbsolutePosition(),
-		glm::vec3(2.5f, 1.5, 1), glm::vec3(0, 0, 0), 0, 0.3, 0.3);
-	bunny->AddComponent(new RigidbodyComponent(bunny, physicsModule, bunnyRb));
-	GLfloat maxFrameRate = 1.0f / 60.0f;
-
 	//Set blue as background color  
 	glClearColor(0.0f, 0.0f, 1.0f, 0.75f);
 
-	// The bunny autonomously moves along a line.
-	sphere->AddComponent(new SelfMovingComponent(sphere, glm::vec3(0, 0, 4), 0.25f));
-
 	// Enables depth buffer.
 	glEnable(GL_DEPTH_TEST);
 
 	// Creates projection matrix.
 	// Projection matrix: angolo FOV angle, aspect ratio, near plane and far plane.
-	projection = glm::perspective(45.0f, (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 10000.0f);
-
-	// Sets the wall as paintable.
-	wall1->AddComponent(new PaintableComponent(wall1, 
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 600));
-	wall2->AddComponent(new PaintableComponent(wall2,
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 600));
-	wall3->AddComponent(new PaintableComponent(wall3,
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 600));
-	wall4->AddComponent(new PaintableComponent(wall4,
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 600));
-	floor->AddComponent(new PaintableComponent(floor, 
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 1024));
-	sphere->AddComponent(new PaintableComponent(sphere, 
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 256));
-	tower->AddComponent(new PaintableComponent(tower, 
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 256));
-
-	box1->AddComponent(new PaintableComponent(box1,
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 150));
-	box2->AddComponent(new PaintableComponent(box2,
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 150));
-	box3->AddComponent(new PaintableComponent(box3,
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 150));
-	up->AddComponent(new PaintableComponent(up,
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 800));
-	bunny->AddComponent(new PaintableComponent(bunny,
-		&SHADERS->availableShaders[SHADER_PAINTMAP], stainSet, 200));
+	projection = glm::perspective(45.0f, (float)renderWidth / (float)renderHeight, 0.1f, 10000.0f);
+
+	// Benchmarks and headless runs are measured with the final textures.
+	if (headless || HasArgument(argc, argv, "--bench-draw") || HasArgument(argc, argv, "--bench-lights"))
+		textureStreamer.Finish();
+
+	// Cleared by the benchmarks whose checks fail, so that the run exits with a failure status.
+	bool checksPassed = true;
+
+	// Measures the CPU cost of the draw calls, then quits.
+	if (HasArgument(argc, argv, "--bench-draw"))
+	{
+		// The models are shared with the scene, if it uses them.
+		const Shader& blinnPhong = SHADERS->availableShaders[SHADER_BLINN_PHONG];
+		BenchmarkMeshDraw("Cube", assets.AcquireModel(CUBE_OBJ_PATH, meshFlags), blinnPhong, 10000);
+		BenchmarkMeshDraw("Sphere", paintBallModel, blinnPhong, 10000);
+		BenchmarkMeshDraw("Bunny", assets.AcquireModel(BUNNY_OBJ_PATH, meshFlags), blinnPhong, 10000);
+		if (window != nullptr)
+			glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	// Measures the load time of each model with and without the mesh cache, and of all of them
+	// imported sequentially and in parallel, then quits.
+	if (HasArgument(argc, argv, "--bench-models"))
+	{
+		const std::vector<std::string> modelPaths = { CUBE_OBJ_PATH, CYLINDER_OBJ_PATH, SPHERE_OBJ_PATH, 
+			BUNNY_OBJ_PATH };
+		for (size_t i = 0; i < modelPaths.size(); i++)
+			checksPassed = BenchmarkModelLoad(modelPaths[i], meshFlags) && checksPassed;
+		BenchmarkParallelModelLoad(modelPaths, meshFlags);
+		if (window != nullptr)
+			glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	// Measures the cost of the tiled lighting as the number of lights grows, then quits.
+	if (HasArgument(argc, argv, "--bench-lights"))
+	{
+		const int lightCounts[] = { 1, 64, 512 };
+		for (int i = 0; i < 3; i++)
+			BenchmarkLights(renderingEngine, playerController.GetViewMatrix(), projection, 
+				lightCounts[i], 200);
+		if (window != nullptr)
+			glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	// Checks the component and gameobject pools, the phase dispatch and the job system, then measures the component update of large scenes, per object,
+	// per type and in parallel, then quits.
+	if (HasArgument(argc, argv, "--bench-components"))
+	{
+		checksPassed = BenchmarkComponentPool(1000, 100000) && checksPassed;
+		checksPassed = BenchmarkGameObjectPool(100000) && checksPassed;
+		checksPassed = BenchmarkPhaseDispatch(10000) && checksPassed;
+		checksPassed = BenchmarkJobSystem(1000, 16, 1000000) && checksPassed;
+		checksPassed = BenchmarkComponentUpdate(renderingEngine, physicsModule, 10000, 100) && checksPassed;
+		checksPassed = BenchmarkParallelComponentUpdate(renderingEngine, physicsModule, 50000, 100) && checksPassed;
+		if (window != nullptr)
+			glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	// Checks the parsing, the compilation and the validation of the scenes, then quits.
+	if (HasArgument(argc, argv, "--bench-scene"))
+	{
+		checksPassed = BenchmarkScene(100000) && checksPassed;
+		if (window != nullptr)
+			glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	// Checks that the transforms follow the bodies after the physics step, then quits.
+	if (HasArgument(argc, argv, "--bench-physics"))
+	{
+		checksPassed = BenchmarkPhysicsSync(renderingEngine, physicsModule, 600) && checksPassed;
+		if (window != nullptr)
+			glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	// Measures the end-of-frame destruction of objects with bodies, then quits. The broadphase of
+	// the arena holds a few hundred bodies.
+	if (HasArgument(argc, argv, "--bench-destruction"))
+	{
+		checksPassed = BenchmarkDestruction(renderingEngine, physicsModule, 400) && checksPassed;
+		if (window != nullptr)
+			glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	// Checks the ticks of the fixed timestep and the interpolation between them, then quits.
+	if (HasArgument(argc, argv, "--bench-timestep"))
+	{
+		checksPassed = BenchmarkFixedTimestep() && checksPassed;
+		checksPassed = BenchmarkInterpolation(100000) && checksPassed;
+		if (window != nullptr)
+			glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	// Measures the update of a deep transform hierarchy, then quits.
+	if (HasArgument(argc, argv, "--bench-transforms"))
+	{
+		checksPassed = BenchmarkTransformEdits(2000, 20) && checksPassed;
+		checksPassed = BenchmarkTransformRemoval(10000, 10) && checksPassed;
+		checksPassed = BenchmarkTransformHierarchy(100000, 8, 100) && checksPassed;
+		if (window != nullptr)
+			glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+
+	if (headless)
+	{
+		// Runs the given script, or a turn around the arena shooting at the walls.
+		ShotScript script;
+		const char* scriptPath = GetArgumentValue(argc, argv, "--script");
+		if (scriptPath == nullptr || !script.Load(scriptPath))
+		{
+			const char* frames = GetArgumentValue(argc, argv, "--frames");
+			script.CreateDefault(frames != nullptr ? atoi(frames) : 600);
+		}
+		RunHeadless(script, renderWidth, renderHeight);
+		ReportProfile(tracePath);
+
+		renderingEngine->lights->Delete();
+		renderingEngine->shadows->Delete();
+		AssetRegistry::Instance().PrintReport();
+		TextureStreamer::Instance().Shutdown();
+		SHADERS->Delete();
+		headlessContext.Destroy();
+		std::exit(checksPassed ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
 
 	// Main Loop
 	// Check if the ESC key had been pressed or if the window had been closed
 	GLfloat lastFrameTime = 0.0f, deltaTime;
 	GLfloat sceneryMaterial[] = { 1.0f, 1.0f, 0.0f };
+	unsigned long frameCount = 0;
 	while (!glfwWindowShouldClose(window))
 	{
+		Profiler::Instance().BeginFrame();
+
 		//Clear color buffer  
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		//Get and organize events, like keyboard and mouse input, window resizing, etc...  
 		glfwPollEvents();
 
+		// Recreates the render targets when the window has been resized.
+		if (framebufferResized)
+		{
+			framebufferResized = false;
+			renderingEngine->Resize(framebufferWidth, framebufferHeight);
+			if (framebufferWidth > 0 && framebufferHeight > 0)
+				projection = glm::perspective(45.0f, (float)framebufferWidth / (float)framebufferHeight, 
+					0.1f, 10000.0f);
+		}
+
 		GLfloat currentFrameTime = (GLfloat)glfwGetTime();
 		deltaTime = currentFrameTime - lastFrameTime;
 		lastFrameTime = currentFrameTime;
-		float frameRate = 1.0f / deltaTime;
-		//std::cout << frameRate << std::endl;
 
-		// Updates the physics simulation.
-		physicsModule->dynamicsWorld->stepSimulation((deltaTime < maxFrameRate ? deltaTime : maxFrameRate), 10);
-		physicsModule->PerformCollisionDetection();
-
-		// Moves the main character.
-		ApplyPlayerCameraMovements(deltaTime);
-
-		// Updates all the components.
-		renderingEngine->UpdateComponents(deltaTime);
-		
-		// Destroys the gameobjects that need to be destroyed.
-		renderingEngine->DestroyGameObjects();
+		SimulateFrame(deltaTime);
 
-		// Resets the viewport.
-		glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+		// Uploads the next mips of the textures being loaded.
+		textureStreamer.Update();
 
 		// Main rendering routine.
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -420,18 +436,30 @@ int main(int argc, char *argv[])
 
 		//Swaps buffers  
 		glfwSwapBuffers(window);
+
+		Profiler::Instance().EndFrame();
+		if (Profiler::Instance().enabled && ++frameCount % PROFILE_PRINT_INTERVAL == 0)
+		{
+			Profiler::Instance().PrintAverages();
+			renderingEngine->PrintDestructionReport();
+		}
 	}  
 
+	ReportProfile(tracePath);
+
 	// Destroys all the used shaders.
-	for (int i = 0; i < SHADERS->availableShaders.size(); i++)
-		SHADERS->availableShaders[i].Delete();
+	renderingEngine->lights->Delete();
+	renderingEngine->shadows->Delete();
+	AssetRegistry::Instance().PrintReport();
+	TextureStreamer::Instance().Shutdown();
+	SHADERS->Delete();
 
 	//Close OpenGL window and terminate GLFW  
 	glfwDestroyWindow(window);
 	//Finalize and clean up GLFW  
 	glfwTerminate();
 
-	std::exit(EXIT_SUCCESS);
+	std::exit(checksPassed ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
 //Define an error callback  
@@ -451,8 +479,14 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 	if (action == GLFW_PRESS)
 	{
 		if (key == GLFW_KEY_SPACE && !keys[key])
-			playerController.Shoot(paintBallModel, renderingEngine, physicsModule,
-				cursorX / SCREEN_WIDTH, cursorY / SCREEN_HEIGHT, projection);
+		{
+			// The cursor is in window coordinates, which follow the resizes.
+			int windowWidth, windowHeight;
+			glfwGetWindowSize(window, &windowWidth, &windowHeight);
+			if (windowWidth > 0 && windowHeight > 0)
+				playerController.Shoot(paintBallModel, renderingEngine, physicsModule,
+					cursorX / windowWidth, cursorY / windowHeight, projection);
+		}
 		keys[key] = true;
 
 		if (key == GLFW_KEY_E)
@@ -462,6 +496,13 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 		keys[key] = false;
 }
 
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+	framebufferWidth = width;
+	framebufferHeight = height;
+	framebufferResized = true;
+}
+
 static void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 {
 	GLfloat xoffset = (GLfloat)xpos - lastX;
@@ -477,6 +518,136 @@ static void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 	playerController.ProcessMouseMovement(xoffset, yoffset, true);
 }
 
+void SimulateFrame(GLfloat deltaTime)
+{
+	// Physics and the gameplay components are simulated in fixed ticks: a frame runs as many as
+	// the time elapsed requires, up to FIXED_TIMESTEP_MAX_TICKS.
+	const int ticks = simulationClock.Advance(deltaTime);
+	const GLfloat physicsStep = simulationClock.GetStep();
+	for (int tick = 0; tick < ticks; tick++)
+	{
+		// The poses reached by the previous tick are the ones the frame interpolates from.
+		renderingEngine->UpdateTransforms();
+		renderingEngine->StorePreviousTransforms();
+
+		// Lets the components drive their bodies.
+		{
+			ScopedCpuTimer timer("Fixed step");
+			renderingEngine->UpdateComponents(COMPONENT_FIXED_STEP, physicsStep);
+		}
+
+		// Updates the physics simulation by a single step.
+		{
+			ScopedCpuTimer timer("Physics step");
+			physicsModule->dynamicsWorld->stepSimulation(physicsStep, 0);
+		}
+		{
+			ScopedCpuTimer timer("Physics sync");
+			physicsModule->SyncTransforms();
+			renderingEngine->UpdateComponents(COMPONENT_POST_PHYSICS, physicsStep);
+		}
+		{
+			ScopedCpuTimer timer("Collision detection");
+			physicsModule->PerformCollisionDetection();
+		}
+	}
+	// The objects are rendered between the last two ticks, by how far the frame is past the last one.
+	renderingEngine->SetInterpolation(simulationClock.GetAlpha());
+
+	// Moves the main character.
+	ApplyPlayerCameraMovements(deltaTime);
+
+	// Updates the components called once per frame.
+	{
+		ScopedCpuTimer timer("Component update");
+		renderingEngine->UpdateComponents(COMPONENT_VARIABLE_STEP, deltaTime);
+	}
+
+	// Fades the splash lights.
+	renderingEngine->lights->Update(deltaTime);
+	
+	// Destroys the gameobjects that need to be destroyed.
+	{
+		ScopedCpuTimer timer("Destruction");
+		renderingEngine->DestroyGameObjects();
+	}
+
+	// Recomputes the matrices of the transforms moved during the frame.
+	{
+		ScopedCpuTimer timer("Transform update");
+		renderingEngine->UpdateTransforms();
+	}
+}
+
+void RunHeadless(const ShotScript& script, int width, int height)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	// The simulation advances by a constant step, so that runs are reproducible.
+	const GLfloat deltaTime = 1.0f / 60.0f;
+	std::vector<double> frameTimes;
+	frameTimes.reserve(script.frameCount);
+
+	for (int frame = 0; frame < script.frameCount; frame++)
+	{
+		Profiler::Instance().BeginFrame();
+		Clock::time_point begin = Clock::now();
+
+		glm::vec3 position;
+		float yaw, pitch;
+		script.GetCameraPose(frame, position, yaw, pitch);
+		playerController.SetPose(position, yaw, pitch);
+		if (script.IsShotFrame(frame))
+			playerController.Shoot(paintBallModel, renderingEngine, physicsModule, 0.5f, 0.5f, projection);
+
+		SimulateFrame(deltaTime);
+		renderingEngine->RenderAll(playerController.GetViewMatrix(), projection);
+
+		// Waits for the GPU, so that the frame time includes rendering.
+		glFinish();
+		frameTimes.push_back(std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+		Profiler::Instance().EndFrame();
+	}
+
+	std::cout << "[BENCHMARK] Headless " << width << "x" << height << ": " << script.frameCount 
+		<< " frames, " << script.GetShotCount() << " shots" << std::endl;
+	if (!frameTimes.empty())
+	{
+		double total = 0.0;
+		for (size_t i = 0; i < frameTimes.size(); i++)
+			total += frameTimes[i];
+		std::vector<double> sorted = frameTimes;
+		std::sort(sorted.begin(), sorted.end());
+		std::cout << "[BENCHMARK] Frame time: avg " << total / frameTimes.size() << " ms, min " 
+			<< sorted.front() << " ms, p95 " << sorted[sorted.size() * 95 / 100] << " ms, max " 
+			<< sorted.back() << " ms" << std::endl;
+	}
+	if (renderingEngine->dynamicResolution)
+		std::cout << "[BENCHMARK] Final render scale: " << renderingEngine->GetRenderScale() * 100.0f 
+			<< "%" << std::endl;
+
+	// The coverage of each paint map detects regressions of the paint splats.
+	const std::vector<GameObject*>& gameObjects = renderingEngine->GetGameObjects();
+	for (size_t i = 0; i < gameObjects.size(); i++)
+	{
+		PaintableComponent* paintable = gameObjects[i]->GetComponent<PaintableComponent>();
+		if (paintable != nullptr)
+			std::cout << "[BENCHMARK] Paint coverage " << gameObjects[i]->GetName() << ": " 
+				<< paintable->ComputePaintCoverage() * 100.0f << "%" << std::endl;
+	}
+}
+
+void ReportProfile(const char* tracePath)
+{
+	if (!Profiler::Instance().enabled)
+		return;
+
+	Profiler::Instance().PrintAverages();
+	renderingEngine->shadows->PrintReport();
+	renderingEngine->PrintDestructionReport();
+	if (tracePath != nullptr && Profiler::Instance().ExportChromeTrace(tracePath))
+		std::cout << "Trace written to " << tracePath << std::endl;
+}
+
 void ApplyPlayerCameraMovements(GLfloat deltaTime)
 {
 	if (keys[GLFW_KEY_W])